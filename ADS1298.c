@@ -8,13 +8,47 @@
 /* INCLUDE FILES															 */
 /*****************************************************************************/
 #include "CommADS1298.h"
-#include "ADS1298.h"			
+#include "ADS1298.h"
+#include "LogicAnalyzer.h"
+#include "Profiler.h"
+#include "Stats.h"
+
+/*****************************************************************************/
+/* DEFINITIONS  															 */
+/*****************************************************************************/
+
+/* Assert and release the CS line of a device descriptor */
+#define ADS1298_CS_LOW(dev)		CommADS1298_CS_PORT &= ~((dev)->csMask)
+#define ADS1298_CS_HIGH(dev)	CommADS1298_CS_PORT |= (dev)->csMask
 
 /*****************************************************************************/
 /* CONSTANTS    															 */
 /*****************************************************************************/
-static unsigned char frameSize1;
-static unsigned char frameSize2;
+
+/* Device table, one entry per ADS1298 on the bus: CS line, DRDY line, no
+ * frame until the channels are set, empty shadows and status word */
+static ADS1298_Device devices[ADS1298_DEVICE_COUNT] = {
+	{ CommADS1298_CS1_MASK, ADS1298_DRDY1_MASK, 0, 0, {0}, {0} }, // device 1
+	{ CommADS1298_CS2_MASK, ADS1298_DRDY2_MASK, 0, 0, {0}, {0} }  // device 2
+};
+static unsigned char drdyActiveMask = 0; // DRDY lines of the devices with a channel on
+
+static unsigned char statusChanges = 0; // bit (device - 1) set when a status changed
+static unsigned char stateMismatches = 0; // broadcasts after which the devices disagreed
+static unsigned char drdyVerified = 0; // the RDATAC verification waited for the DRDY of the next frame
+
+/* Channel change requested while converting, applied at the next frame boundary */
+static unsigned char pendingChannels[ADS1298_DEVICE_COUNT];
+static unsigned char channelsPending = 0;
+static unsigned char layoutChanged = 0; // set when the frame layout changed since the last call
+
+/* CONFIG2 and CH1SET of each device saved while calibrating */
+static unsigned char calibrationSave[ADS1298_DEVICE_COUNT][2];
+
+/* Frame integrity counters */
+static unsigned int headerErrors = 0;	// frames dropped because of a corrupted header
+static unsigned char recoveryFrames = 0;	// frames lost in the resynchronization in progress
+static unsigned char maxRecoveryFrames = 0;	// longest resynchronization seen, in frames
 
 /*****************************************************************************/
 /* FUNCTIONS																 */
@@ -32,8 +66,115 @@ void ADS1298_WriteSingleOpCode(unsigned char writeVal) {
 }
 
 /***************************************************************************//**
- * @brief	Writes data to the registers of the ADS1298. 
+ * @brief	Writes a single opcode to several ADS1298 at once by asserting
+ *          their CS lines together. The selected devices receive the opcode on
+ *          the same SCLK edge, so RDATAC or START take effect in the same
+ *          sample on every device. Only for opcodes that return no data, the
+ *          byte shifted in while the DOUT lines are shared is discarded.
+ *
+ * @param	deviceMask - Bit (device - 1) set for every device to write to,
+ *                       ADS1298_ALL_DEVICES for every device on the bus.
+ * @param	opCode - Char denoting the opcode you want to write.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_BroadcastOpCode(unsigned char deviceMask, unsigned char opCode) {
+	unsigned char csMask = 0;
+	unsigned char i;
+
+	/* Collect the CS lines of the selected devices */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		if (deviceMask & (0x01 << i)) { csMask |= devices[i].csMask; }
+	}
+
+	CommADS1298_CS_PORT &= ~csMask;
+	ADS1298_WriteSingleOpCode(opCode);
+	CommADS1298_CS_PORT |= csMask;
+}
+
+/***************************************************************************//**
+ * @brief	Verifies that the devices reached the same state after a broadcast
+ *          opcode. After RDATAC or START the DRDY lines of the devices must
+ *          fall within ADS1298_DRDY_SKEW_POLLS polls of each other. After any
+ *          other opcode the devices are in SDATAC mode and must report the
+ *          same ID and CONFIG1 registers.
+ *
+ * @param	deviceMask - Bit (device - 1) set for every device to verify.
+ * @param	opCode - Opcode that was broadcast.
+ *
+ * @return	1 - devices are consistent, 0 - devices disagree or timed out.
+*******************************************************************************/
+unsigned char ADS1298_VerifyState(unsigned char deviceMask, unsigned char opCode) {
+	unsigned char regVals[2], firstVals[2];
+	unsigned char drdyMask = 0;
+	unsigned char first = 1;
+	unsigned char i;
+	unsigned int polls;
+
+	if ((opCode == ADS1298_RDATAC) || (opCode == ADS1298_START)) {
+		for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+			if (deviceMask & (0x01 << i)) { drdyMask |= devices[i].drdyMask; }
+		}
+
+		/* Wait for the first DRDY_NOT line to go low */
+		for (polls = 0; (ADS1298_DRDY_PORT & drdyMask) == drdyMask; polls = polls + 1) {
+			if (polls == ADS1298_VERIFY_TIMEOUT) { stateMismatches = stateMismatches + 1; return 0; }
+		}
+
+		/* Every other DRDY_NOT line has to follow in the same sample */
+		for (polls = 0; (ADS1298_DRDY_PORT & drdyMask) != 0; polls = polls + 1) {
+			if (polls == ADS1298_DRDY_SKEW_POLLS) { stateMismatches = stateMismatches + 1; return 0; }
+		}
+		
+		/* The frame is still to read, its DRDY is not a miss */
+		drdyVerified = 1;
+		return 1;
+	}
+
+	/* Compare the ID and CONFIG1 registers of the selected devices */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		if ((deviceMask & (0x01 << i)) == 0) { continue; }
+
+		ADS1298_ReadRegisters(i + 1, ADS1298_ID, 2, regVals);
+		if (first) {
+			firstVals[0] = regVals[0];
+			firstVals[1] = regVals[1];
+			first = 0;
+		} else if ((regVals[0] != firstVals[0]) || (regVals[1] != firstVals[1])) {
+			stateMismatches = stateMismatches + 1;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the number of broadcasts after which the devices disagreed.
+ *
+ * @param	None.
+ *
+ * @return	Number of failed state verifications.
+*******************************************************************************/
+unsigned char ADS1298_GetStateMismatches() {
+	return stateMismatches;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the descriptor of a device.
+ *
+ * @param	device - Device number, from 1 to ADS1298_DEVICE_COUNT.
+ *
+ * @return	Pointer to the device descriptor.
+*******************************************************************************/
+ADS1298_Device* ADS1298_GetDevice(unsigned char device) {
+	return &devices[device - 1];
+}
+
+/***************************************************************************//**
+ * @brief	Writes data to the registers of the ADS1298 and keeps a copy in the
+ *          shadow registers of the device.
  * 
+ * @param	device - Device number, from 1 to ADS1298_DEVICE_COUNT.
  * @param 	address - Char denoting the initial address to write to.
  * @param 	writeNum - Char denoting the number of registers to write.
  * @param 	regVals - Pointer to the array containing the values to write.
@@ -45,28 +186,30 @@ void ADS1298_WriteRegisters(unsigned char device,
 							unsigned char writeNum, 
 							unsigned char* regVals) {
 	unsigned char writeOpCode[2] = {0, 0};
+	ADS1298_Device* dev = &devices[device - 1];
+	unsigned char i;
 	
 	/* Define the opcode */
 	writeOpCode[0] = ADS1298_WREG + address;
 	writeOpCode[1] = writeNum - 1;
 	
 	/* Write the opcode and register values */
-    if (device == 1) {
-		CommADS1298_CS1_PIN = 0;
-		CommADS1298_Write(writeOpCode, 2);
-		CommADS1298_Write(regVals, writeNum);
-		CommADS1298_CS1_PIN = 1;
-	} else if (device == 2) {
-		CommADS1298_CS2_PIN = 0;
-		CommADS1298_Write(writeOpCode, 2);
-		CommADS1298_Write(regVals, writeNum);
-		CommADS1298_CS2_PIN = 1;
+	ADS1298_CS_LOW(dev);
+	CommADS1298_Write(writeOpCode, 2);
+	CommADS1298_Write(regVals, writeNum);
+	ADS1298_CS_HIGH(dev);
+	
+	/* Update the shadow registers */
+	for (i = 0; i < writeNum; i = i + 1) {
+		dev->registers[address + i] = regVals[i];
 	}
 }
 
 /***************************************************************************//**
- * @brief	Reads data from the registers of the ADS1298. 
+ * @brief	Reads data from the registers of the ADS1298. The shadow registers
+ *          of the device are refreshed with the values read.
  * 
+ * @param	device - Device number, from 1 to ADS1298_DEVICE_COUNT.
  * @param	address - Char denoting the initial address to read from.
  * @param	writeNum - Char denoting the number of registers to read.
  * @param	regVals - Pointer to the array storing the read register data.
@@ -78,22 +221,22 @@ void ADS1298_ReadRegisters(unsigned char device,
 						   unsigned char readNum, 
 						   unsigned char* regVals) {
 	unsigned char readOpCode[2] = {0, 0};
+	ADS1298_Device* dev = &devices[device - 1];
+	unsigned char i;
 	
 	/* Define the opcode */
 	readOpCode[0] = (unsigned char) ADS1298_RREG + address;
 	readOpCode[1] = readNum - 1;
 	
 	/* Write the opcode and read the register values */
-	if (device == 1) {
-		CommADS1298_CS1_PIN = 0;
-		CommADS1298_Write(readOpCode, 2);
-		CommADS1298_Read(regVals, readNum);
-		CommADS1298_CS1_PIN = 1;
-	} else if (device == 2) {
-		CommADS1298_CS2_PIN = 0;
-		CommADS1298_Write(readOpCode, 2);
-		CommADS1298_Read(regVals, readNum);
-		CommADS1298_CS2_PIN = 1;
+	ADS1298_CS_LOW(dev);
+	CommADS1298_Write(readOpCode, 2);
+	CommADS1298_Read(regVals, readNum);
+	ADS1298_CS_HIGH(dev);
+	
+	/* Update the shadow registers */
+	for (i = 0; i < readNum; i = i + 1) {
+		dev->registers[address + i] = regVals[i];
 	}
 }
 
@@ -125,31 +268,41 @@ unsigned char ADS1298_PowerUp() {
     ADS1298_RESET_PIN = 1;
     for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
     
-	/* Reset the device by issuing the RESET opcode */
-    /*change*/
-    CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RESET);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RESET);
-	CommADS1298_CS2_PIN = 1;
+	/* Reset the devices by issuing the RESET opcode */
+    ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_RESET);
     for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
     
     /* Stop the read data continuously mode (SDATAC) */
-    /*change*/
-	CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-	CommADS1298_CS2_PIN = 1;
+    ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
     for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
     
     /* Stop the data conversion (STOP) */
     ADS1298_START_PIN = 0;
     for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
     
-	return 1;
+	/* The registers went back to their defaults */
+	ADS1298_RefreshShadows();
+	
+	/* Check that every device came out of the reset the same way */
+	return ADS1298_VerifyState(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
+}
+
+/***************************************************************************//**
+ * @brief	Reads the whole register map of every device into its shadow
+ *          registers. Called after every reset, so that a write compared to
+ *          the shadows is never skipped on stale values. The devices must be
+ *          in SDATAC mode.
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_RefreshShadows() {
+	unsigned char i;
+	
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		ADS1298_ReadRegisters(i + 1, ADS1298_ID, ADS1298_REGISTER_COUNT, devices[i].registers);
+	}
 }
 
 /***************************************************************************//**
@@ -163,13 +316,7 @@ unsigned char ADS1298_PowerDown() {
     unsigned char i;
     
 	/* Stop the read data continuously mode (SDATAC) */
-    /*change*/
-	CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-	CommADS1298_CS2_PIN = 1;
+    ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
     for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
 	
 	/* Stop the data conversion (STOP) */
@@ -185,151 +332,463 @@ unsigned char ADS1298_PowerDown() {
 
 /***************************************************************************//**
  * @brief	Computes the size of a single frame of data in bytes for each 
- *          device. Every frame has a 24 bit status word. 
+ *          device. Every frame has a 24 bit status word. The channel data of
+ *          each device is placed after the one of the previous devices. The
+ *          channel settings are taken from the shadow registers, so no RREG
+ *          is needed and it can run while the devices are converting.
  * 
  * @param	None.
  * 
  * @return	None.
 *******************************************************************************/
 void ADS1298_ComputeFrameSize() {
-	unsigned char i;
-    unsigned char numCh1 = 0; // number of channels active in device 1
-	unsigned char numCh2 = 0; // number of channels active in device 2
-    unsigned char chRegVals[16];
-    
-    /* Read the register values containing the channel settings */
-    ADS1298_ReadRegisters(1, ADS1298_CH1SET, 8, chRegVals);
-	ADS1298_ReadRegisters(2, ADS1298_CH1SET, 8, chRegVals + 8);
+	unsigned char i, j;
+    unsigned char numCh; // number of channels read from the device
+    unsigned char offset = 0;
+    unsigned char* chRegVals;
+    ADS1298_Device* dev;
     
-    /* Iterate through the channel values to see which ones are powered down */
-    for (i = 0; i < 16; i = i + 1) {
-        if ((chRegVals[i] & 0b10000000) == 0x00) { // if not powered down, increment
-			if ((i >= 0) && (i < 8))  { numCh1 = i + 1; } 
-			if ((i >= 8) && (i < 16)) { numCh2 = i - 7; }
-        }
-    }
+    drdyActiveMask = 0;
     
-    /* Calculate the frame size */
-	if (numCh1 > 0) { frameSize1 = (numCh1 * 3) + 3; } // each channel spits out 24 bits of data and status word is 24 bits
-	else { frameSize1 = 0; } // if there are no channels active, set frame size to 0
-	if (numCh2 > 0) { frameSize2 = (numCh2 * 3) + 3; }
-	else { frameSize2 = 0; }
+	/* Iterate through the devices */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		dev = &devices[i];
+		
+		/* Channel settings as last written to the device */
+		chRegVals = dev->registers + ADS1298_CH1SET;
+		
+		/* Iterate through the channel values to see which ones are powered down */
+		numCh = 0;
+		for (j = 0; j < ADS1298_CHANNEL_COUNT; j = j + 1) {
+			if ((chRegVals[j] & ADS1298_CHSET_PD) == 0x00) { numCh = j + 1; } // if not powered down, read up to it
+		}
+		
+		/* Calculate the frame size */
+		dev->channelOffset = offset;
+		if (numCh > 0) {
+			dev->frameSize = (numCh * 3) + ADS1298_STATUS_SIZE; // each channel spits out 24 bits of data and status word is 24 bits
+			drdyActiveMask |= dev->drdyMask;
+			offset = offset + (numCh * 3);
+		} else {
+			dev->frameSize = 0; // if there are no channels active, set frame size to 0
+		}
+	}
 }
 
 /***************************************************************************//**
- * @brief	Turns the specified channels on and off.
+ * @brief	Writes the CHnSET registers of every device for the specified
+ *          channels. Devices whose shadow registers already hold the values
+ *          are skipped. The devices must be in SDATAC mode.
  * 
- * @param	Pointer to 2 character array storing information on which channels
- *          to turn on and turn off.
+ * @param	channels - 1 byte per device, bit (7 - n) set to turn channel
+ *                     (n + 1) on.
  * 
  * @return	None.
 *******************************************************************************/
-void ADS1298_SetChannels(unsigned char* channels) {
+void ADS1298_WriteChannels(unsigned char* channels) {
     unsigned char writeVals[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-	unsigned char i, j;
+	unsigned char i, j, changed;
 	
-	/* Iterate through the 2 devices */
-	for (i = 0; i < 2; i = i + 1) {
+	/* Iterate through the devices */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		changed = 0;
 		
 		/* Iterate through the 8 channels of one device */
-		for (j = 0; j < 8; j = j + 1) {
+		for (j = 0; j < ADS1298_CHANNEL_COUNT; j = j + 1) {
 			/* Define the register values for the channel settings */
 			if (((channels[i] >> (7 - j)) & 0x01) == 0x01) { // turn channel on
 				writeVals[j] = ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST;
 			} else { // turn channel off
 				writeVals[j] = ADS1298_CHSET_PD | ADS1298_CHSET_MUX_SHORT;
 			}
+			if (writeVals[j] != devices[i].registers[ADS1298_CH1SET + j]) { changed = 1; }
 		}
 		
 		/* Send the register values */
-		ADS1298_WriteRegisters(i + 1, ADS1298_CH1SET, 8, writeVals);
+		if (changed) { ADS1298_WriteRegisters(i + 1, ADS1298_CH1SET, ADS1298_CHANNEL_COUNT, writeVals); }
 	}
+}
+
+/***************************************************************************//**
+ * @brief	Turns the specified channels on and off. Conversions must be
+ *          stopped, use ADS1298_RequestChannels while streaming.
+ * 
+ * @param	Pointer to ADS1298_DEVICE_COUNT character array storing information
+ *          on which channels to turn on and turn off.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_SetChannels(unsigned char* channels) {
+	/* Send the register values */
+	ADS1298_WriteChannels(channels);
 	
 	/* Compute the new frame size */
 	ADS1298_ComputeFrameSize();
 }
 
 /***************************************************************************//**
- * @brief	Starts continuous data conversions.
+ * @brief	Requests a channel change while the devices are converting. The
+ *          change is applied by ADS1298_ReadFrame right after the next frame
+ *          is read, so the conversions are never stopped.
+ * 
+ * @param	channels - 1 byte per device denoting the channels to turn on.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_RequestChannels(unsigned char* channels) {
+	unsigned char i;
+	
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		pendingChannels[i] = channels[i];
+	}
+	channelsPending = 1;
+}
+
+/***************************************************************************//**
+ * @brief	Applies a requested channel change between two DRDY periods. The
+ *          frame of the current period has been read, so the devices leave
+ *          RDATAC mode, take the new CHnSET values and go back to RDATAC
+ *          before the next DRDY. The START line stays high, the conversions
+ *          keep their timing and the next frame is read with the new layout.
+ *          A newly enabled channel needs a few samples for its digital filter
+ *          to settle.
  * 
  * @param	None.
  * 
  * @return	None.
 *******************************************************************************/
-void ADS1298_StartConversion() {
+void ADS1298_ApplyChannels() {
+	unsigned char i;
+	
+	channelsPending = 0;
+	
+	/* Registers can only be written outside of RDATAC mode */
+	ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
+	for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+	
+	ADS1298_WriteChannels(pendingChannels);
+	
+	ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_RDATAC);
+	
+	/* Swap the layout used by the following frames */
+	ADS1298_ComputeFrameSize();
+	layoutChanged = 1;
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether the frame layout changed since the last call. The
+ *          next frame read is the first one with the new layout.
+ * 
+ * @param	None.
+ * 
+ * @return	1 - layout changed, 0 - layout unchanged.
+*******************************************************************************/
+unsigned char ADS1298_GetLayoutChange() {
+	unsigned char changed = layoutChanged;
+	
+	layoutChanged = 0;
+	return changed;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the channels turned on in a device from its shadow registers.
+ * 
+ * @param	device - Device number, from 1 to ADS1298_DEVICE_COUNT.
+ * 
+ * @return	Bit (7 - n) set if channel (n + 1) is on.
+*******************************************************************************/
+unsigned char ADS1298_GetChannels(unsigned char device) {
+	unsigned char* chRegVals = devices[device - 1].registers + ADS1298_CH1SET;
+	unsigned char channels = 0;
+	unsigned char j;
+	
+	for (j = 0; j < ADS1298_CHANNEL_COUNT; j = j + 1) {
+		if ((chRegVals[j] & ADS1298_CHSET_PD) == 0x00) { channels |= (0x80 >> j); }
+	}
+	
+	return channels;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the data rate set in CONFIG1, from the registers last written.
+ *          The devices are written the same CONFIG1.
+ * 
+ * @param	None.
+ * 
+ * @return	Data rate in SPS.
+*******************************************************************************/
+unsigned int ADS1298_GetDataRate() {
+	unsigned char config1 = devices[0].registers[ADS1298_CONFIG1];
+	unsigned int rate = (config1 & ADS1298_CONFIG1_HR) ? 32000 : 16000;
+	
+	return rate >> (config1 & 0x07);
+}
+
+/***************************************************************************//**
+ * @brief	Starts continuous data conversions on every device at once. If the
+ *          START pin is not driving the conversions, the START opcode is
+ *          broadcast as well so that all the devices start in the same sample.
+ * 
+ * @param	None.
+ * 
+ * @return	1 - devices started together, 0 - devices are out of step.
+*******************************************************************************/
+unsigned char ADS1298_StartConversion() {
 	/* Issue the RDATAC command to read data continuously */
-    /*change*/
-    CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RDATAC);
-	CommADS1298_CS2_PIN = 1;
+	ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_RDATAC);
+	
+	/* Issue the START opcode if the START pin is low */
+	if (!ADS1298_START_PIN) { ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_START); }
+	
+	return ADS1298_VerifyState(ADS1298_ALL_DEVICES, ADS1298_RDATAC);
 }
 
 /***************************************************************************//**
- * @brief	Stops continuous data conversions.
+ * @brief	Stops continuous data conversions on every device at once.
  * 
  * @param	None.
  * 
- * @return	None.
+ * @return	1 - devices stopped together, 0 - devices are out of step.
 *******************************************************************************/
-void ADS1298_StopConversion() {
+unsigned char ADS1298_StopConversion() {
 	/* Issue the SDATAC opcode to stop reading data */
-    /*change*/
-    CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-	CommADS1298_CS2_PIN = 1;
+	ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
+	
+	/* Issue the STOP opcode if the START pin is low */
+	if (!ADS1298_START_PIN) { ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_STOP); }
+	
+	return ADS1298_VerifyState(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
 }
 
 /***************************************************************************//**
- * @brief	Reads a single frame of data from the implant.
- * 
+ * @brief	Reads a single frame of data from the implant. The status word at
+ *          the start of the frame is decoded and kept, only the channel data
+ *          is written to the buffer. A frame whose header does not start with
+ *          0b1100 is dropped and the device is resynchronized. A requested
+ *          channel change is applied once the frame has been read.
+ *
  * @param	pDataBuffer - Pointer to the array storing the streamed data.
- * 
- * @return	None.
+ *
+ * @return	Number of channel data bytes written to pDataBuffer, 0 if no
+ *          channel is on, or ADS1298_FRAME_GAP if the frame was dropped.
 *******************************************************************************/
-void ADS1298_ReadFrame(unsigned char* pDataBuffer) {
-	/* Wait for the DRDY_NOT line to go low */
-	while (ADS1298_DRDY1_NOT || ADS1298_DRDY2_NOT);
+unsigned char ADS1298_ReadFrame(unsigned char* pDataBuffer) {
+	unsigned char header[ADS1298_STATUS_SIZE];
+	unsigned char i, length = 0;
+	ADS1298_Device* dev;
+
+	/* No device converts, there is no DRDY to wait for */
+	if (drdyActiveMask == 0) {
+		if (channelsPending) { ADS1298_ApplyChannels(); }
+		return 0;
+	}
 	
-	/* If frame size for device 1 is 0, do not read from device 1 */
-	if (frameSize1 != 0) { // device 1
+	PROFILER_START(PROFILER_READ_FRAME);
+	
+	/* DRDY already low, the frame waited and the next one may be lost,
+	 * unless the DRDY was the one the start was verified on */
+	if (drdyVerified) {
+		drdyVerified = 0;
+	} else if (!(ADS1298_DRDY_PORT & drdyActiveMask)) {
+		STATS_COUNT(STATS_DRDY_MISSES);
+	}
+	
+	/* Wait for the DRDY_NOT lines of the active devices to go low */
+	while (ADS1298_DRDY_PORT & drdyActiveMask);
+	LogicAnalyzer_TRACE(TRACE_DRDY);
+	LogicAnalyzer_TRACE(TRACE_READ);
+
+	/* Iterate through the devices */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		dev = &devices[i];
+
+		/* If frame size for the device is 0, do not read from it */
+		if (dev->frameSize == 0) { continue; }
 
 		/* Bring the CS pin low */
-		CommADS1298_CS1_PIN = 0;
+		ADS1298_CS_LOW(dev);
 
-		/* Read all the data in the frame */
-		CommADS1298_Read(pDataBuffer, 3); // read the header
-		CommADS1298_Read(pDataBuffer, frameSize1 - 3); // overwrite the header
+		/* Read the header and drop the frame if it is out of sync */
+		CommADS1298_Read(header, ADS1298_STATUS_SIZE);
+		if ((header[0] & ADS1298_STATUS_SYNC_MASK) != ADS1298_STATUS_SYNC) {
+			ADS1298_CS_HIGH(dev);
+			ADS1298_Resync(i + 1);
+			LogicAnalyzer_TRACE(TRACE_READ | TRACE_EXIT);
+			PROFILER_STOP(PROFILER_READ_FRAME);
+			return ADS1298_FRAME_GAP;
+		}
 
-		/* Increment the address of pDataBuffer */
-		pDataBuffer = pDataBuffer + (frameSize1 - 3);
+		/* Read the channel data in the frame */
+		CommADS1298_Read(pDataBuffer + dev->channelOffset, dev->frameSize - ADS1298_STATUS_SIZE);
 
 		/* Bring the CS pin high */
-		CommADS1298_CS1_PIN = 1;
+		ADS1298_CS_HIGH(dev);
 
-	/* If frame size for device 2 is 0, do not read from device 2 */
-	} else if (frameSize2 != 0) { // device 2
+		/* Keep the lead-off and GPIO state from the header */
+		ADS1298_DecodeStatus(i + 1, header);
+		length = length + (dev->frameSize - ADS1298_STATUS_SIZE);
+	}
 
-		/* Bring the CS pin low */
-		CommADS1298_CS2_PIN = 0;
+	ADS1298_EndResync();
+	
+	/* The DRDY period just started, there is time to change the layout */
+	if (channelsPending) { ADS1298_ApplyChannels(); }
+	
+	STATS_COUNT(STATS_FRAMES);
+	LogicAnalyzer_TRACE(TRACE_READ | TRACE_EXIT);
+	PROFILER_STOP(PROFILER_READ_FRAME);
+	return length;
+}
 
-		/* Read all the data in the frame */
-		CommADS1298_Read(pDataBuffer, 3); // read the header
-		CommADS1298_Read(pDataBuffer, frameSize2 - 3); // overwrite the header
+/***************************************************************************//**
+ * @brief	Resynchronizes a device after a corrupted status header. A lost or
+ *          extra SCLK edge shifts every following sample, so the data read is
+ *          restarted with SDATAC then RDATAC. If the header is still corrupted
+ *          after ADS1298_RESYNC_MAX_FRAMES frames the conversions are restarted
+ *          with the START pin, which bounds the recovery time.
+ *
+ * @param	device - Device number that returned the corrupted header.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_Resync(unsigned char device) {
+	ADS1298_Device* dev = &devices[device - 1];
+	unsigned char i;
 
-		/* Increment the address of pDataBuffer */
-		pDataBuffer = pDataBuffer + (frameSize2 - 3);
+	headerErrors = headerErrors + 1;
+	recoveryFrames = recoveryFrames + 1;
 
-		/* Bring the CS pin high */
-		CommADS1298_CS2_PIN = 1;
+	/* Restart the conversions if the opcodes did not recover the device */
+	if (recoveryFrames % ADS1298_RESYNC_MAX_FRAMES == 0) {
+		ADS1298_START_PIN = 0;
+		for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+		ADS1298_START_PIN = 1;
+		return;
+	}
+
+	/* Stop and restart the read data continuously mode */
+	ADS1298_CS_LOW(dev);
+	ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
+	ADS1298_CS_HIGH(dev);
+	for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+	ADS1298_CS_LOW(dev);
+	ADS1298_WriteSingleOpCode(ADS1298_RDATAC);
+	ADS1298_CS_HIGH(dev);
+}
+
+/***************************************************************************//**
+ * @brief	Closes the resynchronization in progress, if any, once a frame with
+ *          a valid header has been read and records how many frames it took.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_EndResync() {
+	if (recoveryFrames != 0) {
+		if (recoveryFrames > maxRecoveryFrames) { maxRecoveryFrames = recoveryFrames; }
+		recoveryFrames = 0;
 	}
 }
 
+/***************************************************************************//**
+ * @brief	Gets the number of frames dropped because of a corrupted header.
+ *
+ * @param	None.
+ *
+ * @return	Number of corrupted headers since power-up.
+*******************************************************************************/
+unsigned int ADS1298_GetHeaderErrors() {
+	return headerErrors;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the longest resynchronization seen. Multiply by the sample
+ *          period set in CONFIG1 to get the recovery time.
+ *
+ * @param	None.
+ *
+ * @return	Maximum number of frames lost in a single resynchronization.
+*******************************************************************************/
+unsigned char ADS1298_GetMaxRecoveryFrames() {
+	return maxRecoveryFrames;
+}
+
+/***************************************************************************//**
+ * @brief	Decodes the 24-bit status word (1100 + LOFF_STATP + LOFF_STATN +
+ *          GPIO[7:4]) read at the start of a frame and flags the device if its
+ *          lead-off or GPIO state differs from the previous frame. This gives
+ *          continuous lead-off detection without reading LOFF_STATP/LOFF_STATN.
+ *
+ * @param	device - Device number the header was read from.
+ * @param	header - Pointer to the 3 status bytes as read from DOUT.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_DecodeStatus(unsigned char device, unsigned char* header) {
+	unsigned char loffP, loffN, gpio;
+	unsigned char* status = devices[device - 1].status;
+
+	/* Realign the nibble-shifted fields */
+	loffP = (header[0] << 4) | (header[1] >> 4);
+	loffN = (header[1] << 4) | (header[2] >> 4);
+	gpio  = header[2] & 0x0F;
+
+	/* Only flag a change, the caller forwards it as an event */
+	if ((loffP != status[ADS1298_STATUS_LOFFP]) ||
+		(loffN != status[ADS1298_STATUS_LOFFN]) ||
+		(gpio  != status[ADS1298_STATUS_GPIO])) {
+		status[ADS1298_STATUS_LOFFP] = loffP;
+		status[ADS1298_STATUS_LOFFN] = loffN;
+		status[ADS1298_STATUS_GPIO]  = gpio;
+		statusChanges |= (0x01 << (device - 1));
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Gets the devices whose status changed since the last call.
+ *
+ * @param	None.
+ *
+ * @return	Bit (device - 1) is set for every device with a new status.
+*******************************************************************************/
+unsigned char ADS1298_GetStatusChanges() {
+	unsigned char changes = statusChanges;
+
+	statusChanges = 0;
+	return changes;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the last decoded status of a device.
+ *
+ * @param	device - Device number to get the status of.
+ * @param	status - Pointer to 3 bytes receiving LOFF_STATP, LOFF_STATN and
+ *                   GPIO[7:4].
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_GetStatus(unsigned char device, unsigned char* status) {
+	ADS1298_Device* dev = &devices[device - 1];
+
+	status[ADS1298_STATUS_LOFFP] = dev->status[ADS1298_STATUS_LOFFP];
+	status[ADS1298_STATUS_LOFFN] = dev->status[ADS1298_STATUS_LOFFN];
+	status[ADS1298_STATUS_GPIO]  = dev->status[ADS1298_STATUS_GPIO];
+}
+
+/***************************************************************************//**
+ * @brief	Gets the per-channel electrode-off bits of a device. A channel is
+ *          off if either its positive or negative electrode is off.
+ *
+ * @param	device - Device number to get the lead-off state of.
+ *
+ * @return	Bit (channel - 1) set if the electrode of that channel is off.
+*******************************************************************************/
+unsigned char ADS1298_GetLeadOff(unsigned char device) {
+	return devices[device - 1].status[ADS1298_STATUS_LOFFP] |
+		   devices[device - 1].status[ADS1298_STATUS_LOFFN];
+}
+
 /***************************************************************************//**
  * @brief	Streams electrogram data from the ADS1298. You could use the START
  *          pin, but using the START opcode means less wires are needed.
@@ -341,7 +800,8 @@ void ADS1298_ReadFrame(unsigned char* pDataBuffer) {
 *******************************************************************************/
 void ADS1298_ReadData(unsigned char* pDataBuffer, 
 					  unsigned long frameCnt) {
-	unsigned char i;
+	unsigned char i, length;
+	ADS1298_Device* dev;
 	
 	/* Bring the START pin high to start converting data */
     ADS1298_START_PIN = 1;
@@ -349,44 +809,28 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
     /* If you just want to read a single frame of data */
     if (frameCnt == 1) { 
         
-        /* If frame size for device 1 is 0, do not read from device 1 */
-        if (frameSize1 != 0) {
+        /* Iterate through the devices */
+        for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+            dev = &devices[i];
+            
+            /* If frame size for the device is 0, do not read from it */
+            if (dev->frameSize == 0) { continue; }
             
             /* Bring the CS pin low */
-            CommADS1298_CS1_PIN = 0;
-
-            /* Wait for the DRDY_NOT line to go low */
-            while (ADS1298_DRDY1_NOT);
-
-            /* Issue the RDATA opcode to read a single frame of data */
-            ADS1298_WriteSingleOpCode(ADS1298_RDATA);
-
-            /* Read the data in the frame */
-            CommADS1298_Read(pDataBuffer, frameSize1);
-
-            /* Issue the STOP opcode to stop converting data */
-            ADS1298_WriteSingleOpCode(ADS1298_STOP);
-
-            /* Exit from the current device by bringing CS high */
-            CommADS1298_CS1_PIN = 1;
-
-        /* If frame size for device 2 is 0, do not read from device 2 */
-        } else if (frameSize2 != 0) {
-
-            /* Bring the CS pin low */
-            CommADS1298_CS2_PIN = 0;
+            ADS1298_CS_LOW(dev);
 
             /* Wait for the DRDY_NOT line to go low */
-            while (ADS1298_DRDY2_NOT);
+            while (ADS1298_DRDY_PORT & dev->drdyMask);
 
             /* Issue the RDATA opcode to read a single frame of data */
             ADS1298_WriteSingleOpCode(ADS1298_RDATA);
 
             /* Read the data in the frame */
-            CommADS1298_Read(pDataBuffer, frameSize2);
+            CommADS1298_Read(pDataBuffer, dev->frameSize);
+            pDataBuffer = pDataBuffer + dev->frameSize;
 
             /* Exit from the current device by bringing CS high */
-            CommADS1298_CS2_PIN = 1;
+            ADS1298_CS_HIGH(dev);
         }
         
         /* Bring the START pin low to stop the data conversions */
@@ -395,62 +839,18 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
     }
     
     /* Issue the RDATAC command to read data continuously */
-    /*change*/
-    CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_RDATAC);
-	CommADS1298_CS2_PIN = 1;
+    ADS1298_StartConversion();
     
     /* Iterate through the specified number of frames */
 	for (i = 0; i < frameCnt; i = i + 1) {
-		
-        /* Wait for the DRDY_NOT line to go low */
-        while (ADS1298_DRDY1_NOT || ADS1298_DRDY2_NOT);
-        
-        /* If frame size for device 1 is 0, do not read from device 1 */
-        if (frameSize1 != 0) { // device 1
-
-            /* Bring the CS pin low */
-            CommADS1298_CS1_PIN = 0;
-
-            /* Read all the data in the frame */
-            CommADS1298_Read(pDataBuffer, 3); // read the header
-            CommADS1298_Read(pDataBuffer, frameSize1 - 3); // overwrite the header
-
-            /* Increment the address of pDataBuffer */
-            pDataBuffer = pDataBuffer + (frameSize1 - 3);
-
-            /* Bring the CS pin high */
-            CommADS1298_CS1_PIN = 1;
-
-        /* If frame size for device 2 is 0, do not read from device 2 */
-        } else if (frameSize2 != 0) { // device 2
-
-            /* Bring the CS pin low */
-            CommADS1298_CS2_PIN = 0;
-
-            /* Read all the data in the frame */
-            CommADS1298_Read(pDataBuffer, 3); // read the header
-            CommADS1298_Read(pDataBuffer, frameSize2 - 3); // overwrite the header
 
-            /* Increment the address of pDataBuffer */
-            pDataBuffer = pDataBuffer + (frameSize2 - 3);
-
-            /* Bring the CS pin high */
-            CommADS1298_CS2_PIN = 1;
-        }
+        /* Read the frame and increment the address of pDataBuffer */
+        length = ADS1298_ReadFrame(pDataBuffer);
+        if (length != ADS1298_FRAME_GAP) { pDataBuffer = pDataBuffer + length; }
 	}
     
     /* Issue the SDATAC opcode to stop reading data */
-    /*change*/
-    CommADS1298_CS1_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-    CommADS1298_CS1_PIN = 1;
-    CommADS1298_CS2_PIN = 0;
-    ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
-	CommADS1298_CS2_PIN = 1;
+    ADS1298_StopConversion();
     for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
     
     /* Bring the START pin low to stop the data conversions */
@@ -462,10 +862,70 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
  * 
  * @param	None.
  * 
- * @return	Total frame size (sum of the frame sizes from both devices).
+ * @return	Total frame size (sum of the frame sizes from all the devices).
 *******************************************************************************/
 unsigned long ADS1298_GetFrameSize() {
-	return (frameSize1 + frameSize2);
+	unsigned long frameSize = 0;
+	unsigned char i;
+	
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		frameSize = frameSize + devices[i].frameSize;
+	}
+	
+	return frameSize;
+}
+
+/***************************************************************************//**
+ * @brief	Drives channel 1 of every device with the internal test signal so
+ *          that the relay can measure the sample skew between devices. The
+ *          square wave (fCLK / 2^20) is generated inside each device, so its
+ *          edges land in the same sample on every device only if they convert
+ *          together. Conversions must be stopped (SDATAC) before calling.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_EnterCalibration() {
+	unsigned char writeVal;
+	unsigned char i;
+
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+
+		/* Save the registers overwritten by the calibration */
+		calibrationSave[i][0] = devices[i].registers[ADS1298_CONFIG2];
+		calibrationSave[i][1] = devices[i].registers[ADS1298_CH1SET];
+
+		/* Generate the test signal internally */
+		writeVal = ADS1298_CONFIG2_WCTCHOPCONST | ADS1298_CONFIG2_INTTEST | ADS1298_CONFIG2_TESTAMP | ADS1298_CONFIG2_TESTFREQ_AC20;
+		ADS1298_WriteRegisters(i + 1, ADS1298_CONFIG2, 1, &writeVal);
+
+		/* Route the test signal to channel 1 */
+		writeVal = ADS1298_CHSET_GAIN_1 | ADS1298_CHSET_MUX_TEST;
+		ADS1298_WriteRegisters(i + 1, ADS1298_CH1SET, 1, &writeVal);
+	}
+
+	/* Channel 1 of every device is now part of the frame */
+	ADS1298_ComputeFrameSize();
+}
+
+/***************************************************************************//**
+ * @brief	Restores the registers saved by ADS1298_EnterCalibration.
+ *          Conversions must be stopped (SDATAC) before calling.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ExitCalibration() {
+	unsigned char i;
+
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		ADS1298_WriteRegisters(i + 1, ADS1298_CONFIG2, 1, &calibrationSave[i][0]);
+		ADS1298_WriteRegisters(i + 1, ADS1298_CH1SET, 1, &calibrationSave[i][1]);
+	}
+
+	ADS1298_ComputeFrameSize();
 }
 
 /***************************************************************************//**
@@ -481,6 +941,7 @@ unsigned char ADS1298_RegistersForTesting(unsigned char* channels) {
                                    0, 0, 0, 0, 0, \
 								   0, 0, 0, 0, 0, \
 								   0, 0, 0, 0, 0};
+	unsigned char i;
 	
 	/* Define the common register values to write*/
 	/* CONFIG1    */ writeVals[0]  = ADS1298_CONFIG1_HR | ADS1298_CONFIG1_DR_2K; // 0x84
@@ -503,8 +964,9 @@ unsigned char ADS1298_RegistersForTesting(unsigned char* channels) {
 	/* WCT2       */ writeVals[24] = 0x00;
 	
     /* Write the standard configuration registers */
-    ADS1298_WriteRegisters(1, ADS1298_CONFIG1, 4, writeVals);
-    ADS1298_WriteRegisters(2, ADS1298_CONFIG1, 4, writeVals);
+    for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+        ADS1298_WriteRegisters(i + 1, ADS1298_CONFIG1, 4, writeVals);
+    }
     
 	/* Set the channels */
 	ADS1298_SetChannels(channels);
@@ -512,10 +974,71 @@ unsigned char ADS1298_RegistersForTesting(unsigned char* channels) {
 	return 1;
 }
 
+/***************************************************************************//**
+ * @brief Restores the ADS1298 registers from saved register images with one
+ *        WREG burst per device. The default register values of
+ *        ADS1298_Initialize are skipped, the frame layout is computed from
+ *        the images.
+ * 
+ * @param images - ADS1298_DEVICE_COUNT images of the registers from CONFIG1 to
+ *                 WCT2, one after the other.
+ * @param warm - 1 if the supplies of the devices stayed up (watchdog reset),
+ *               the power-up wait is then skipped.
+ * 
+ * @return 1 - restore success, 0 - restore failed
+*******************************************************************************/
+unsigned char ADS1298_Restore(unsigned char* images, unsigned char warm) {
+	unsigned char status = 0;
+	unsigned char id;
+	unsigned int i;
+	
+	if (warm) {
+		/* Only reset the devices, their supplies and clock are stable. PWDN
+		 * is latched high before the pin is driven, so that the devices are
+		 * never powered down */
+		status = CommADS1298_InitializeSpi();
+		if (!status) { return 0; }
+		ADS1298_PWR_PIN = 1;
+		ADS1298_PWR_DIR = 0;
+		ADS1298_START_PIN = 0;
+		ADS1298_START_DIR = 0;
+		ADS1298_RESET_PIN = 0;
+		ADS1298_RESET_DIR = 0;
+		for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
+		ADS1298_RESET_PIN = 1;
+		for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
+		ADS1298_BroadcastOpCode(ADS1298_ALL_DEVICES, ADS1298_SDATAC);
+		for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+		
+		/* The burst below rewrites every other shadow, only check that each
+		 * device answers with its ID */
+		for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+			ADS1298_ReadRegisters(i + 1, ADS1298_ID, 1, &id);
+			if ((id & ADS1298_ID_DEVID) != ADS1298_ID_ADS129X) { return 0; }
+		}
+	} else {
+		status = CommADS1298_Initialize();
+		if (!status) { return 0; }
+		status = ADS1298_PowerUp();
+		if (!status) { return 0; }
+	}
+	
+	/* Write every register of each device in one burst */
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		ADS1298_WriteRegisters(i + 1, ADS1298_CONFIG1, ADS1298_REGISTER_COUNT - 1,
+							   images + (i * (ADS1298_REGISTER_COUNT - 1)));
+	}
+	
+	/* Compute the frame size from the shadow registers */
+	ADS1298_ComputeFrameSize();
+	
+	return 1;
+}
+
 /***************************************************************************//**
  * @brief Initialize the ADS1298 registers. 
  * 
- * @param channels - 2 bytes (16 bits) denoting the channels we want to turn on.
+ * @param channels - 1 byte per device denoting the channels we want to turn on.
  * 
  * @return 1 - initialization success, 0 - initialization failed
 *******************************************************************************/
@@ -534,6 +1057,10 @@ unsigned char ADS1298_Initialize(unsigned char* channels) {
 	status = ADS1298_RegistersForTesting(channels);
 	if (!status) { return 0; }
 	
+	/* Read the whole map back, the registers not written keep their reset
+	 * values (GPIO 0x0F, reserved bits) in the image saved */
+	ADS1298_RefreshShadows();
+	
     /* Compute the frame size */
     ADS1298_ComputeFrameSize();
     
@@ -72,6 +72,7 @@
 /******************************************************************************/
 #define ADS1298_ID_DEVID		(0b111u << 5) // Device ID mask
 #define ADS1298_ID_CHID			(0b111u << 0) // Channel ID mask
+#define ADS1298_ID_ADS129X		(0b100u << 5) // Device ID of the ADS129x family
 
 /******************************************************************************/
 /* ADS1298 Configuration Register 1											  */
@@ -352,6 +353,49 @@
 #define ADS1298_WCT2_WCTC_CH4POS		(0b110u << 0)	//	110 = Channel 4 positive input connected to WCTC amplifier
 #define ADS1298_WCT2_WCTC_CH4NEG		(0b111u << 0)	//	111 = Channel 4 negative input connected to WCTC amplifier
 
+/******************************************************************************/
+/* ADS1298 Status Word (1100 + LOFF_STATP + LOFF_STATN + GPIO[7:4])			  */
+/******************************************************************************/
+#define ADS1298_STATUS_SIZE			3		// status word is 24 bits at the start of every frame
+#define ADS1298_STATUS_LOFFP		0		// index of LOFF_STATP in a decoded status
+#define ADS1298_STATUS_LOFFN		1		// index of LOFF_STATN in a decoded status
+#define ADS1298_STATUS_GPIO			2		// index of GPIO[7:4] (right-aligned) in a decoded status
+#define ADS1298_STATUS_SYNC_MASK	0xF0	// top nibble of the first status byte
+#define ADS1298_STATUS_SYNC			0xC0	//	1100 = frame is in sync
+
+/******************************************************************************/
+/* ADS1298 Frame Integrity													  */
+/******************************************************************************/
+#define ADS1298_FRAME_GAP			0xFF	// ADS1298_ReadFrame dropped a corrupted frame
+#define ADS1298_RESYNC_MAX_FRAMES	4		// frames before SDATAC/RDATAC escalates to a START restart
+
+/******************************************************************************/
+/* ADS1298 DEVICE TABLE														  */
+/******************************************************************************/
+
+/* Number of ADS1298 chips sharing the SPI bus and the START line. To add a
+ * device, define its CS and DRDY pins and masks in CommADS1298.h and add an
+ * entry to the device table in ADS1298.c.
+ */
+#define ADS1298_DEVICE_COUNT		2
+#define ADS1298_CHANNEL_COUNT		8		// channels per device
+#define ADS1298_REGISTER_COUNT		26		// registers from ID to WCT2
+#define ADS1298_ALL_DEVICES			((0b1u << ADS1298_DEVICE_COUNT) - 1) // device mask of the whole bus
+
+/* Broadcast state verification */
+#define ADS1298_VERIFY_TIMEOUT		5000	// DRDY polls before a device is declared stuck
+#define ADS1298_DRDY_SKEW_POLLS		8		// DRDY polls allowed between the first and last device
+
+/* Descriptor of a single ADS1298 on the bus */
+typedef struct {
+	unsigned char csMask;			// CS line in CommADS1298_CS_PORT
+	unsigned char drdyMask;			// DRDY line in ADS1298_DRDY_PORT
+	unsigned char frameSize;		// bytes per frame (status word included), 0 if no channel is on
+	unsigned char channelOffset;	// offset of the device channel data in a read frame
+	unsigned char registers[ADS1298_REGISTER_COUNT];	// shadow of the device registers
+	unsigned char status[ADS1298_STATUS_SIZE];			// last decoded status word
+} ADS1298_Device;
+
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
 /******************************************************************************/
@@ -359,6 +403,18 @@
 /* Writes a single opcode to a ADS1298 chip */
 void ADS1298_WriteSingleOpCode(unsigned char writeVals);
 
+/* Writes a single opcode to several ADS1298 chips at once */
+void ADS1298_BroadcastOpCode(unsigned char deviceMask, unsigned char opCode);
+
+/* Verifies that the ADS1298 chips agree after a broadcast opcode */
+unsigned char ADS1298_VerifyState(unsigned char deviceMask, unsigned char opCode);
+
+/* Gets the number of failed state verifications */
+unsigned char ADS1298_GetStateMismatches(void);
+
+/* Gets the descriptor of a ADS1298 chip */
+ADS1298_Device* ADS1298_GetDevice(unsigned char device);
+
 /* Writes values to the registers of the ADS1298 */
 void ADS1298_WriteRegisters(unsigned char device, 
 							unsigned char address, 
@@ -376,21 +432,66 @@ unsigned char ADS1298_PowerUp(void);
 						
 /* Powers down the ADS1298 chip */
 unsigned char ADS1298_PowerDown(void);
+
+/* Reads the register map of the ADS1298 chips into their shadows */
+void ADS1298_RefreshShadows(void);
 						
 /* Computes the frame size for each ADS1298 chip */
 void ADS1298_ComputeFrameSize(void);
 
+/* Writes the CHnSET registers of the ADS1298 chips */
+void ADS1298_WriteChannels(unsigned char* channels);
+
 /* Sets the channels for the ADS1298 chip */
 void ADS1298_SetChannels(unsigned char* channels);
 
+/* Requests a channel change while converting */
+void ADS1298_RequestChannels(unsigned char* channels);
+
+/* Applies a requested channel change between two frames */
+void ADS1298_ApplyChannels(void);
+
+/* Tells whether the frame layout changed */
+unsigned char ADS1298_GetLayoutChange(void);
+
+/* Gets the channels turned on in a ADS1298 chip */
+unsigned char ADS1298_GetChannels(unsigned char device);
+
+/* Gets the data rate set in CONFIG1 */
+unsigned int ADS1298_GetDataRate(void);
+
 /* Start data conversions */
-void ADS1298_StartConversion(void);
+unsigned char ADS1298_StartConversion(void);
 
 /* Stop data conversions */
-void ADS1298_StopConversion(void);
+unsigned char ADS1298_StopConversion(void);
 
 /* Read a single frame of data */
-void ADS1298_ReadFrame(unsigned char* pDataBuffer);
+unsigned char ADS1298_ReadFrame(unsigned char* pDataBuffer);
+
+/* Resynchronizes a device after a corrupted status header */
+void ADS1298_Resync(unsigned char device);
+
+/* Closes a resynchronization after a valid frame */
+void ADS1298_EndResync(void);
+
+/* Gets the number of corrupted status headers */
+unsigned int ADS1298_GetHeaderErrors(void);
+
+/* Gets the longest resynchronization in frames */
+unsigned char ADS1298_GetMaxRecoveryFrames(void);
+
+/* Decodes the status word at the start of a frame */
+void ADS1298_DecodeStatus(unsigned char device, unsigned char* header);
+
+/* Gets the devices whose lead-off or GPIO state changed */
+unsigned char ADS1298_GetStatusChanges(void);
+
+/* Gets the decoded status of a device */
+void ADS1298_GetStatus(unsigned char device, unsigned char* status);
+
+/* Gets the electrode-off bits of a device */
+unsigned char ADS1298_GetLeadOff(unsigned char device);
 
 /* Reads data from the ADS1298 */
 void ADS1298_ReadData(unsigned char* pDataBuffer,
@@ -399,9 +500,18 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
 /* Gets the total frame size */
 unsigned long ADS1298_GetFrameSize(void);
 
+/* Routes the internal test signal to channel 1 of every device */
+void ADS1298_EnterCalibration(void);
+
+/* Restores the registers changed for the calibration */
+void ADS1298_ExitCalibration(void);
+
 /* Sets the registers for testing */
 unsigned char ADS1298_RegistersForTesting(unsigned char* channels);
 
+/* Restores the ADS1298 registers from saved images */
+unsigned char ADS1298_Restore(unsigned char* images, unsigned char warm);
+
 /* Initializes the ADS1298 */
 unsigned char ADS1298_Initialize(unsigned char* channels);
 
@@ -0,0 +1,273 @@
+/***************************************************************************//**
+ *   @file   Arq.c
+ *   @brief  Implementation of the selective-repeat ARQ of the records sent to
+ *           the relay. A copy of every record sent stays in RAM until the
+ *           relay acknowledges it, and only the records the relay missed are
+ *           sent again. New records never wait for the acknowledgements: when
+ *           the window is full the oldest record is given up.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Arq.h"
+
+/*****************************************************************************/
+/* DEFINITIONS																 */
+/*****************************************************************************/
+#define ARQ_WAITING					0		// sent, not acknowledged yet
+#define ARQ_ACKED					1		// received by the relay
+#define ARQ_REPEAT					2		// missed by the relay, to send again
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+/* Records copied in link sequence order, one array per bank for C18 */
+#if defined(__18CXX)
+#pragma udata ArqBank0
+#endif
+static unsigned char bank0[ARQ_BANK_SIZE];
+#if defined(__18CXX)
+#pragma udata ArqBank1
+#endif
+static unsigned char bank1[ARQ_BANK_SIZE];
+#if defined(__18CXX)
+#pragma udata
+#endif
+
+static unsigned char* banks[ARQ_BANKS] = {bank0, bank1};
+static unsigned int offset[ARQ_WINDOW];				// per link sequence number modulo the window
+static unsigned char length[ARQ_WINDOW];
+static unsigned char state[ARQ_WINDOW];
+static unsigned char sentTick[ARQ_WINDOW];
+static unsigned char sentOrder[ARQ_WINDOW];			// value of sends at the last sending
+static unsigned char enabled = 0;
+static unsigned char oldest = 0, next = 0;			// link sequence numbers kept: oldest to next - 1
+static unsigned int head = 0, used = 0;
+static unsigned int readIndex = 0;
+static unsigned char elapsed = 0;
+static unsigned char sends = 0;
+static Arq_Stats stats;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Enables the ARQ, empties the window and clears the counters.
+ *
+ * @param	enable - 1 to send the records through the ARQ, 0 to send them once.
+ *
+ * @return	None.
+*******************************************************************************/
+void Arq_Configure(unsigned char enable) {
+	enabled = enable;
+	oldest = 0;
+	next = 0;
+	head = 0;
+	used = 0;
+	stats.sent = 0;
+	stats.repeated = 0;
+	stats.lost = 0;
+	stats.rejected = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether the records are sent through the ARQ.
+ *
+ * @param	None.
+ *
+ * @return	1 - enabled, 0 - disabled.
+*******************************************************************************/
+unsigned char Arq_IsEnabled() {
+	return enabled;
+}
+
+/***************************************************************************//**
+ * @brief	Counts the time for the retransmission time-out, called once per
+ *          frame read. A record sent ARQ_TIMEOUT frames ago and still not
+ *          acknowledged is sent again, which covers a lost acknowledgement
+ *          and a loss at the end of a burst.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Arq_Tick() {
+	unsigned char seq, slot;
+	
+	elapsed = elapsed + 1;
+	for (seq = oldest; seq != next; seq = seq + 1) {
+		slot = seq % ARQ_WINDOW;
+		if ((state[slot] == ARQ_WAITING) && ((unsigned char)(elapsed - sentTick[slot]) >= ARQ_TIMEOUT)) {
+			state[slot] = ARQ_REPEAT;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Frees the oldest record of the window, counted as lost if the
+ *          relay did not acknowledge it.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Arq_Release() {
+	unsigned char slot = oldest % ARQ_WINDOW;
+	
+	if (state[slot] != ARQ_ACKED) { stats.lost = stats.lost + 1; }
+	used = used - length[slot];
+	oldest = oldest + 1;
+}
+
+/***************************************************************************//**
+ * @brief	Opens a record in the window, giving up the oldest records if the
+ *          window or the buffer is full. Its bytes are then kept with
+ *          Arq_StoreByte as they are sent.
+ *
+ * @param	size - Number of bytes of the record, header included, at most
+ *                 ARQ_BUFFER_SIZE.
+ *
+ * @return	Link sequence number of the record.
+*******************************************************************************/
+unsigned char Arq_Begin(unsigned char size) {
+	unsigned char slot;
+	
+	while ((oldest != next) && (((unsigned char)(next - oldest) >= ARQ_WINDOW) ||
+								(used + size > ARQ_BUFFER_SIZE))) {
+		Arq_Release();
+	}
+	
+	slot = next % ARQ_WINDOW;
+	offset[slot] = head;
+	length[slot] = size;
+	state[slot] = ARQ_WAITING;
+	sentTick[slot] = elapsed;
+	sentOrder[slot] = sends;
+	sends = sends + 1;
+	used = used + size;
+	stats.sent = stats.sent + 1;
+	next = next + 1;
+	
+	return next - 1;
+}
+
+/***************************************************************************//**
+ * @brief	Keeps a byte of the record opened.
+ *
+ * @param	data - Byte sent.
+ *
+ * @return	None.
+*******************************************************************************/
+void Arq_StoreByte(unsigned char data) {
+	banks[head >> 8][head & 0xFF] = data;
+	head = (head + 1) & (ARQ_BUFFER_SIZE - 1);
+}
+
+/***************************************************************************//**
+ * @brief	Takes an acknowledgement of the relay. The records still missing
+ *          that were sent before a record received are marked to send again,
+ *          a record sent again after it may still be on its way. The
+ *          acknowledged records at the start of the window are freed.
+ *
+ * @param	expected - Next link sequence number the relay expects, all the
+ *                     records before it were received.
+ * @param	received - Bit i set if record expected + 1 + i was received.
+ *
+ * @return	None.
+*******************************************************************************/
+void Arq_Acknowledge(unsigned char expected, unsigned int received) {
+	unsigned char window = next - oldest;
+	unsigned char seq, slot, latest, found, i;
+	
+	/* Ignore an acknowledgement older than the window */
+	if ((unsigned char)(expected - oldest) > window) {
+		stats.rejected = stats.rejected + 1;
+		return;
+	}
+	
+	for (seq = oldest; seq != expected; seq = seq + 1) { state[seq % ARQ_WINDOW] = ARQ_ACKED; }
+	
+	/* Records received out of order, and the last of them sent */
+	found = 0;
+	latest = 0;
+	for (i = 0; i < ARQ_WINDOW - 1; i = i + 1) {
+		seq = expected + 1 + i;
+		if ((unsigned char)(seq - oldest) >= window) { break; }
+		if (!(received & (1u << i))) { continue; }
+		
+		slot = seq % ARQ_WINDOW;
+		state[slot] = ARQ_ACKED;
+		if (!found || ((unsigned char)(sentOrder[slot] - latest) < 128)) { latest = sentOrder[slot]; }
+		found = 1;
+	}
+	if (!found) { return; }
+	
+	/* What is missing and was sent before it was lost */
+	for (seq = expected; seq != next; seq = seq + 1) {
+		slot = seq % ARQ_WINDOW;
+		if ((state[slot] == ARQ_WAITING) && ((unsigned char)(latest - sentOrder[slot] - 1) < 127)) {
+			state[slot] = ARQ_REPEAT;
+		}
+	}
+	
+	while ((oldest != next) && (state[oldest % ARQ_WINDOW] == ARQ_ACKED)) { Arq_Release(); }
+}
+
+/***************************************************************************//**
+ * @brief	Selects the oldest record to send again, if it fits. Its bytes are
+ *          then read with Arq_ReadByte.
+ *
+ * @param	room - Bytes the record may take in the radio ring.
+ * @param	seq - Receives the link sequence number of the record.
+ * @param	size - Receives the number of bytes of the record.
+ *
+ * @return	1 - record selected, 0 - nothing to send again.
+*******************************************************************************/
+unsigned char Arq_SelectRepeat(unsigned char room, unsigned char* seq, unsigned char* size) {
+	unsigned char s, slot;
+	
+	for (s = oldest; s != next; s = s + 1) {
+		slot = s % ARQ_WINDOW;
+		if (state[slot] != ARQ_REPEAT) { continue; }
+		if (length[slot] > room) { return 0; }
+		
+		state[slot] = ARQ_WAITING;
+		sentTick[slot] = elapsed;
+		sentOrder[slot] = sends;
+		sends = sends + 1;
+		readIndex = offset[slot];
+		*seq = s;
+		*size = length[slot];
+		stats.repeated = stats.repeated + 1;
+		return 1;
+	}
+	
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief	Reads the next byte of the record selected.
+ *
+ * @param	None.
+ *
+ * @return	Byte of the record.
+*******************************************************************************/
+unsigned char Arq_ReadByte() {
+	unsigned char data = banks[readIndex >> 8][readIndex & 0xFF];
+	
+	readIndex = (readIndex + 1) & (ARQ_BUFFER_SIZE - 1);
+	return data;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the counters.
+ *
+ * @param	result - Receives the counters.
+ *
+ * @return	None.
+*******************************************************************************/
+void Arq_GetStats(Arq_Stats* result) {
+	*result = stats;
+}
@@ -0,0 +1,64 @@
+/***************************************************************************//**
+ *   @file   Arq.h
+ *   @brief  Header file of the selective-repeat ARQ of the records sent to the
+ *           relay.
+*******************************************************************************/
+#ifndef _ARQ_H_
+#define _ARQ_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+/* The copies of the records not acknowledged take ARQ_BUFFER_SIZE bytes in
+ * two 256-byte RAM banks, ARQ0 and ARQ1 in the linker script */
+#define ARQ_BANKS					2
+#define ARQ_BANK_SIZE				256
+#if (ARQ_BANKS * ARQ_BANK_SIZE) != ARQ_BUFFER_SIZE
+#error "ARQ_BUFFER_SIZE does not match the banks of the copies"
+#endif
+
+/* Counters of the ARQ */
+typedef struct {
+	unsigned int sent;				// records sent the first time
+	unsigned int repeated;			// retransmissions
+	unsigned int lost;				// records given up before an acknowledgement
+	unsigned int rejected;			// acknowledgements outside of the window
+} Arq_Stats;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Enables the ARQ and empties the window */
+void Arq_Configure(unsigned char enable);
+
+/* Tells whether the records are sent through the ARQ */
+unsigned char Arq_IsEnabled(void);
+
+/* Counts the time for the retransmission time-out */
+void Arq_Tick(void);
+
+/* Opens a record in the window and gets its link sequence number */
+unsigned char Arq_Begin(unsigned char size);
+
+/* Keeps a byte of the record opened */
+void Arq_StoreByte(unsigned char data);
+
+/* Takes an acknowledgement bitmap of the relay */
+void Arq_Acknowledge(unsigned char next, unsigned int received);
+
+/* Selects the next record to send again */
+unsigned char Arq_SelectRepeat(unsigned char room, unsigned char* seq, unsigned char* size);
+
+/* Reads the next byte of the record selected */
+unsigned char Arq_ReadByte(void);
+
+/* Gets the counters */
+void Arq_GetStats(Arq_Stats* stats);
+
+#endif /* _ARQ_H_ */
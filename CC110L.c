@@ -9,11 +9,13 @@
 /******************************************************************************/
 #include "CommCC110L.h"
 #include "CC110L.h"
+#include "Profiler.h"
+#include "Stats.h"
 
 /******************************************************************************/
 /* DEFINITIONS  															  */
 /******************************************************************************/
-#define MAX_TX_SIZE     64
+#define MAX_TX_SIZE     160	// holds an ENVELOPE record of 16 channels
 #define MAX_RC_SIZE     64
 
 /******************************************************************************/
@@ -21,6 +23,7 @@
 /******************************************************************************/
 unsigned char TX_BUFFER[MAX_TX_SIZE], RC_BUFFER[MAX_RC_SIZE];
 unsigned char TX_HEAD, TX_TAIL, RC_HEAD, RC_TAIL;
+unsigned int TX_OVERFLOWS = 0;
 
 /******************************************************************************/
 /* FUNCTIONS																  */
@@ -85,8 +88,12 @@ void CC110L_RC_WriteBuffer(unsigned char data) {
 	/* Increment the head of the buffer */
 	RC_HEAD = CC110L_IncrementIndex(RC_HEAD, MAX_RC_SIZE);
 	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (RC_HEAD == RC_TAIL) { RC_TAIL = CC110L_IncrementIndex(RC_TAIL, MAX_RC_SIZE); }
+	/* If you have reached the tail, increment the tail of the buffer, the
+	 * oldest byte is lost */
+	if (RC_HEAD == RC_TAIL) {
+		RC_TAIL = CC110L_IncrementIndex(RC_TAIL, MAX_RC_SIZE);
+		STATS_COUNT(STATS_RC_OVERRUNS);
+	}
 }
 
 /***************************************************************************//**
@@ -167,6 +174,8 @@ void CC110L_RC_Clear() {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_WriteBuffer(unsigned char data) {
+	PROFILER_START(PROFILER_TX_WRITE);
+	
 	/* Temporarily disable interrupts */
 	INTERRUPT_GLOBAL = 0;
 	
@@ -177,10 +186,14 @@ void CC110L_TX_WriteBuffer(unsigned char data) {
 	TX_HEAD = CC110L_IncrementIndex(TX_HEAD, MAX_TX_SIZE);
 	
 	/* If you have reached the tail, increment the tail of the buffer */
-	if (TX_HEAD == TX_TAIL) { TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_RC_SIZE); }
+	if (TX_HEAD == TX_TAIL) {
+		TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_TX_SIZE);
+		TX_OVERFLOWS = TX_OVERFLOWS + 1;
+	}
 	
 	/* Re-enable the interrupts */
 	INTERRUPT_GLOBAL = 1;
+	PROFILER_STOP(PROFILER_TX_WRITE);
 }
 
 /***************************************************************************//**
@@ -315,6 +328,61 @@ void CC110L_TX_Clear() {
 	TX_HEAD = TX_TAIL = 0; // reset the head and the tail to the beginning of the buffer
 }
 
+/***************************************************************************//**
+ * @brief Gets the number of bytes waiting in the TX buffer.
+ *
+ * @param None.
+ * 
+ * @return Bytes written and not sent yet.
+*******************************************************************************/
+unsigned char CC110L_TX_GetCount() {
+	unsigned char head, tail;
+	
+	/* Read both indexes at once, the tail moves in the interrupt */
+	INTERRUPT_GLOBAL = 0;
+	head = TX_HEAD;
+	tail = TX_TAIL;
+	INTERRUPT_GLOBAL = 1;
+	
+	return (head >= tail) ? (head - tail) : (head + MAX_TX_SIZE - tail);
+}
+
+/***************************************************************************//**
+ * @brief Gets the number of bytes that can be written to the TX buffer
+ *        without overwriting the oldest bytes.
+ *
+ * @param None.
+ * 
+ * @return Free bytes, one slot is kept empty to tell a full buffer from an
+ *         empty one.
+*******************************************************************************/
+unsigned char CC110L_TX_GetFree() {
+	return (MAX_TX_SIZE - 1) - CC110L_TX_GetCount();
+}
+
+/***************************************************************************//**
+ * @brief Gets the number of bytes the TX buffer holds.
+ *
+ * @param None.
+ * 
+ * @return Capacity of the TX buffer.
+*******************************************************************************/
+unsigned char CC110L_TX_GetSize() {
+	return MAX_TX_SIZE - 1;
+}
+
+/***************************************************************************//**
+ * @brief Gets the number of bytes overwritten in the TX buffer before they
+ *        were sent.
+ *
+ * @param None.
+ * 
+ * @return Bytes overwritten since the initialization.
+*******************************************************************************/
+unsigned int CC110L_TX_GetOverflows() {
+	return TX_OVERFLOWS;
+}
+
 /******************************************************************************/
 /* General Functions Part 2													  */
 /******************************************************************************/
@@ -332,21 +400,25 @@ void CC110L_ClearAll() {
 }
 
 /***************************************************************************//**
- * @brief Interrupt service routing for EUSART communication.
+ * @brief Interrupt service routine of the SPI link with the relay. The relay
+ *        clocks one byte each way: the byte received is kept in the RC buffer
+ *        for the command decoder, and the next byte of the TX buffer is
+ *        loaded for the next exchange, or a FILL byte (0x00) if there is none.
  *
  * @param None.
  * 
  * @return None.
 *******************************************************************************/
 void CC110L_ISR() {
-    if (CommCC110L_SSPINTERRUPT & CommCC110L_SSPINT_ENABLE) {
-        CC110L_TX_WriteBuffer(0x41);
-        CC110L_TX_WriteBuffer(0x52);
-        CC110L_TX_WriteBuffer(0x73);
-        CC110L_TX_SendByte();
-        CC110L_TX_SendByte();
-        CC110L_TX_SendByte();
+    if (CommCC110L_SSPINTERRUPT && CommCC110L_SSPINT_ENABLE) {
+        CommCC110L_SSPINTERRUPT = 0;
+        CC110L_RC_WriteBuffer(CommCC110L_DATABUFFER);
         
-        LATBbits.LATB7 = !LATBbits.LATB7;
+        if (TX_HEAD != TX_TAIL) {
+            CommCC110L_DATABUFFER = TX_BUFFER[TX_TAIL];
+            TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_TX_SIZE);
+        } else {
+            CommCC110L_DATABUFFER = 0x00;
+        }
     }
 }
\ No newline at end of file
@@ -402,6 +402,18 @@ unsigned char CC110L_TX_isDataAvailable();
 /* Resets the TX buffer */
 void CC110L_TX_Clear();
 
+/* Gets the number of bytes waiting in the TX buffer */
+unsigned char CC110L_TX_GetCount();
+
+/* Gets the number of bytes that can be written without overwriting */
+unsigned char CC110L_TX_GetFree();
+
+/* Gets the number of bytes the TX buffer holds */
+unsigned char CC110L_TX_GetSize();
+
+/* Gets the number of bytes overwritten before being sent */
+unsigned int CC110L_TX_GetOverflows();
+
 /******************************************************************************/
 /* General Functions Part 2													  */
 /******************************************************************************/
@@ -0,0 +1,284 @@
+/***************************************************************************//**
+ *   @file   Capture.c
+ *   @brief  Implementation of the pre-trigger capture ring of the frames. The
+ *           frames go round a ring in RAM and only the window around a
+ *           trigger is sent at full resolution, the radio is idle between
+ *           events.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Capture.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+
+/* C18 keeps an array within a bank, the ring is split in one array per bank */
+#if defined(__18CXX)
+#pragma udata CaptureBank0
+#endif
+static unsigned char bank0[CAPTURE_BANK_SIZE];
+#if CAPTURE_BANKS > 1
+#if defined(__18CXX)
+#pragma udata CaptureBank1
+#endif
+static unsigned char bank1[CAPTURE_BANK_SIZE];
+#endif
+#if CAPTURE_BANKS > 2
+#if defined(__18CXX)
+#pragma udata CaptureBank2
+#endif
+static unsigned char bank2[CAPTURE_BANK_SIZE];
+#endif
+#if CAPTURE_BANKS > 3
+#if defined(__18CXX)
+#pragma udata CaptureBank3
+#endif
+static unsigned char bank3[CAPTURE_BANK_SIZE];
+#endif
+#if defined(__18CXX)
+#pragma udata
+#endif
+
+static unsigned char* banks[CAPTURE_BANKS] = {
+	bank0
+#if CAPTURE_BANKS > 1
+	, bank1
+#endif
+#if CAPTURE_BANKS > 2
+	, bank2
+#endif
+#if CAPTURE_BANKS > 3
+	, bank3
+#endif
+};
+
+static unsigned char state = CAPTURE_ARMED;
+static unsigned char frameLength = 0;	// bytes per frame, 0 until the first frame
+static unsigned int capacity = 0;		// frames held by the ring
+static unsigned int head = 0;			// slot of the next frame stored
+static unsigned int stored = 0;			// frames in the ring
+
+/* Window, as configured and as fitted to the ring */
+static unsigned int preWanted = 0, postWanted = 0;
+static unsigned int preFrames = 0, postFrames = 0;
+static unsigned char enabled = 0;		// CAPTURE_TRIGGER_*
+static unsigned char cause = 0;
+static unsigned int windowPre = 0;		// pre-trigger frames of the window, fewer after a reset
+static unsigned int remaining = 0;		// post-trigger frames to store, then frames to read out
+static unsigned int readSlot = 0;
+static unsigned long frameIndex = 0;	// frames offered to the ring since Capture_Configure
+static unsigned long triggerIndex = 0;	// index of the trigger frame of the window
+
+/* Threshold trigger */
+static unsigned char thresholdChannel = 0;
+static long thresholdLevel = 0;			// 0 disables the trigger
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Sets the window kept around a trigger and the triggers enabled,
+ *          then empties the ring. The window is cut to the ring, the
+ *          post-trigger frames first.
+ *
+ * @param	pre - Frames kept before the trigger, the trigger frame included.
+ * @param	post - Frames stored after the trigger.
+ * @param	triggers - CAPTURE_TRIGGER_* enabled.
+ *
+ * @return	None.
+*******************************************************************************/
+void Capture_Configure(unsigned int pre, unsigned int post, unsigned char triggers) {
+	preWanted = pre;
+	postWanted = post;
+	enabled = triggers;
+	frameLength = 0;
+	frameIndex = 0;
+	Capture_Reset();
+}
+
+/***************************************************************************//**
+ * @brief	Sets the level of the threshold trigger.
+ *
+ * @param	channel - Channel of the frame compared, from 0.
+ * @param	level - Absolute sample value triggering a capture, 0 disables
+ *                  the trigger.
+ *
+ * @return	None.
+*******************************************************************************/
+void Capture_SetThreshold(unsigned char channel, long level) {
+	thresholdChannel = channel;
+	thresholdLevel = level;
+}
+
+/***************************************************************************//**
+ * @brief	Empties the ring and arms it. The window is fitted to the ring for
+ *          the frame length.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Capture_Reset() {
+	state = CAPTURE_ARMED;
+	head = 0;
+	stored = 0;
+	remaining = 0;
+	capacity = (frameLength != 0) ? (CAPTURE_BYTES / frameLength) : 0;
+	
+	preFrames = (preWanted > capacity) ? capacity : preWanted;
+	postFrames = (postWanted > capacity - preFrames) ? (capacity - preFrames) : postWanted;
+}
+
+/***************************************************************************//**
+ * @brief	Copies bytes to or from the ring, crossing the banks.
+ *
+ * @param	slot - Slot of the frame in the ring.
+ * @param	frame - Frame to copy.
+ * @param	write - 1 copies the frame to the ring, 0 from the ring.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Capture_Copy(unsigned int slot, unsigned char* frame, unsigned char write) {
+	unsigned int position = slot * frameLength;
+	unsigned char* bank = banks[position >> 8];
+	unsigned char offset = (unsigned char) position;
+	unsigned char i;
+	
+	for (i = 0; i < frameLength; i = i + 1) {
+		if (write) { bank[offset] = frame[i]; } else { frame[i] = bank[offset]; }
+		offset = offset + 1;
+		if (offset == 0) { position = position + CAPTURE_BANK_SIZE; bank = banks[position >> 8]; }
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Stores a frame in the ring, unless the window is read out. A new
+ *          frame length (layout change) empties the ring. The threshold
+ *          trigger is checked on the frame. Every frame is counted, stored or
+ *          not, so that the trigger index follows the time.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	length - Number of bytes in the frame.
+ *
+ * @return	None.
+*******************************************************************************/
+void Capture_AddFrame(unsigned char* frame, unsigned char length) {
+	unsigned char* bytes;
+	long x;
+	
+	frameIndex = frameIndex + 1;
+	if (state == CAPTURE_UPLOAD) { return; }
+	if (length != frameLength) {
+		frameLength = length;
+		Capture_Reset();
+	}
+	if (capacity == 0) { return; }
+	
+	Capture_Copy(head, frame, 1);
+	head = (head + 1 == capacity) ? 0 : head + 1;
+	if (stored < capacity) { stored = stored + 1; }
+	
+	if (state == CAPTURE_POST) {
+		remaining = remaining - 1;
+		if (remaining == 0) {
+			/* Freeze the window, oldest frame first */
+			remaining = windowPre + postFrames;
+			readSlot = (head >= remaining) ? (head - remaining) : (head + capacity - remaining);
+			state = CAPTURE_UPLOAD;
+		}
+		return;
+	}
+	
+	/* Threshold trigger */
+	if ((thresholdLevel != 0) && ((thresholdChannel * 3) + 3 <= length)) {
+		bytes = frame + (thresholdChannel * 3);
+		x = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+		if (bytes[0] & 0x80) { x = x - 0x1000000L; }
+		if ((x >= thresholdLevel) || (x <= -thresholdLevel)) { Capture_Trigger(CAPTURE_CAUSE_THRESHOLD); }
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Freezes the window around the last frame stored. The post-trigger
+ *          frames are stored first, then the window is read out.
+ *
+ * @param	newCause - CAPTURE_CAUSE_*.
+ *
+ * @return	1 - window started, 0 - trigger disabled or a window is already
+ *          in progress.
+*******************************************************************************/
+unsigned char Capture_Trigger(unsigned char newCause) {
+	if ((state != CAPTURE_ARMED) || (stored == 0)) { return 0; }
+	if ((enabled & (0x01 << (newCause - 1))) == 0) { return 0; }
+	
+	cause = newCause;
+	triggerIndex = frameIndex - 1;
+	windowPre = (stored < preFrames) ? stored : preFrames;
+	if (postFrames != 0) {
+		remaining = postFrames;
+		state = CAPTURE_POST;
+	} else {
+		remaining = windowPre;
+		readSlot = (head >= remaining) ? (head - remaining) : (head + capacity - remaining);
+		state = CAPTURE_UPLOAD;
+	}
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the state of the ring.
+ *
+ * @param	None.
+ *
+ * @return	CAPTURE_ARMED, CAPTURE_POST or CAPTURE_UPLOAD.
+*******************************************************************************/
+unsigned char Capture_GetState() {
+	return state;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the cause, the size and the trigger of the window uploaded, as
+ *          sent in the TRIGGER record.
+ *
+ * @param	window - Receives the cause, the pre-trigger and the post-trigger
+ *                   frames (2 bytes each, MSB first), then the index of the
+ *                   trigger frame (4 bytes, MSB first). The index counts the
+ *                   frames offered to the ring since Capture_Configure.
+ *
+ * @return	None.
+*******************************************************************************/
+void Capture_GetWindow(unsigned char* window) {
+	window[0] = cause;
+	window[1] = (unsigned char) (windowPre >> 8);
+	window[2] = (unsigned char) windowPre;
+	window[3] = (unsigned char) (postFrames >> 8);
+	window[4] = (unsigned char) postFrames;
+	window[5] = (unsigned char) (triggerIndex >> 24);
+	window[6] = (unsigned char) (triggerIndex >> 16);
+	window[7] = (unsigned char) (triggerIndex >> 8);
+	window[8] = (unsigned char) triggerIndex;
+}
+
+/***************************************************************************//**
+ * @brief	Reads the next frame of the window uploaded. The ring is emptied
+ *          and armed again after the last one.
+ *
+ * @param	frame - Receives the frame.
+ *
+ * @return	Number of bytes in the frame, 0 if no window is uploaded.
+*******************************************************************************/
+unsigned char Capture_ReadFrame(unsigned char* frame) {
+	if ((state != CAPTURE_UPLOAD) || (remaining == 0)) { return 0; }
+	
+	Capture_Copy(readSlot, frame, 0);
+	readSlot = (readSlot + 1 == capacity) ? 0 : readSlot + 1;
+	remaining = remaining - 1;
+	if (remaining == 0) { Capture_Reset(); }
+	
+	return frameLength;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************//**
+ *   @file   Capture.h
+ *   @brief  Header file of the pre-trigger capture ring of the frames.
+*******************************************************************************/
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* The ring takes whole RAM banks, one udata section per bank. Each bank must
+ * be free in the linker script, lower CAPTURE_BANKS when the other modules
+ * grow (see the RAM budget in Implant.h). 2 banks hold 10 frames of 16
+ * channels, 21 frames of 8 channels.
+ */
+#ifndef CAPTURE_BANKS
+#define CAPTURE_BANKS				2		// 1 to 4
+#endif
+#define CAPTURE_BANK_SIZE			256
+#define CAPTURE_BYTES				(CAPTURE_BANKS * CAPTURE_BANK_SIZE)
+
+/* Triggers enabled by Capture_Configure, bit (cause - 1) */
+#define CAPTURE_TRIGGER_COMMAND		(0x01 << (CAPTURE_CAUSE_COMMAND - 1))
+#define CAPTURE_TRIGGER_BEAT		(0x01 << (CAPTURE_CAUSE_BEAT - 1))
+#define CAPTURE_TRIGGER_LEADOFF		(0x01 << (CAPTURE_CAUSE_LEADOFF - 1))
+#define CAPTURE_TRIGGER_THRESHOLD	(0x01 << (CAPTURE_CAUSE_THRESHOLD - 1))
+
+/* States of the ring */
+#define CAPTURE_ARMED				0x00	// frames go round the ring
+#define CAPTURE_POST				0x01	// triggered, storing the post-trigger frames
+#define CAPTURE_UPLOAD				0x02	// window frozen, frames read out
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Sets the window kept around a trigger and the triggers enabled */
+void Capture_Configure(unsigned int pre, unsigned int post, unsigned char triggers);
+
+/* Sets the level of the threshold trigger */
+void Capture_SetThreshold(unsigned char channel, long level);
+
+/* Empties the ring and arms it */
+void Capture_Reset(void);
+
+/* Stores a frame in the ring */
+void Capture_AddFrame(unsigned char* frame, unsigned char length);
+
+/* Freezes the window around the last frame stored */
+unsigned char Capture_Trigger(unsigned char cause);
+
+/* Gets the state of the ring */
+unsigned char Capture_GetState(void);
+
+/* Gets the cause, the size and the trigger index of the window uploaded */
+void Capture_GetWindow(unsigned char* window);
+
+/* Reads the next frame of the window uploaded */
+unsigned char Capture_ReadFrame(unsigned char* frame);
+
+#endif /* _CAPTURE_H_ */
@@ -44,9 +44,12 @@
 /* Include Files                                                              */
 /******************************************************************************/
 #include "CommADS1298.h"
+#include "Supervisor.h"
+#include "Profiler.h"
 
 /***************************************************************************//**
- * @brief Initializes the SPI communication peripheral for the ADS1298 chip.
+ * @brief Initializes the SPI communication peripheral for the ADS1298 chip
+ *        and drives the START, RESET and PWDN pins low, RESET high.
  *
  * @param None.
  *
@@ -54,6 +57,31 @@
 *******************************************************************************/
 unsigned char CommADS1298_Initialize() {
 	
+	/* SPI peripheral and lines */
+	CommADS1298_InitializeSpi();
+    
+	/* Properly configure the other pins */
+	ADS1298_START_PIN = 0;  //initialize state of start pins  pdw 11/12/19
+    ADS1298_START_DIR = 0; // START is output
+    ADS1298_RESET_PIN = 1;  // initialize state of reset pins pdw 11/12/19
+	ADS1298_RESET_DIR = 0; // RESET is output
+    ADS1298_PWR_PIN = 0;  //initialize state of power down pins pdw 11/12/19
+	ADS1298_PWR_DIR = 0; // PWRDN on ADS1298 is output from PIC
+
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Initializes the SPI communication peripheral for the ADS1298 chip
+ *        and its SPI, CS and DRDY lines only. The START, RESET and PWDN pins
+ *        are left alone, so the devices keep running.
+ *
+ * @param None.
+ *
+ * @return 0 - Initialization failed, 1 - Initialization succeeded.
+*******************************************************************************/
+unsigned char CommADS1298_InitializeSpi() {
+	
 	/* Re-initialize the SSP1 control register 1 and the status register */
 	SSP1CON1 = 0x00; // SSP control register 1
 	SSP1STAT = 0x00; // SSP status register
@@ -91,14 +119,6 @@ unsigned char CommADS1298_Initialize() {
     
 	CommADS1298_CS1_DIR = 0; // CS on ADS1298 is output from PIC (device 1)
 	CommADS1298_CS2_DIR = 0; // CS on ADS1298 is output from PIC (device 2)
-    
-	/* Properly configure the other pins */
-	ADS1298_START_PIN = 0;  //initialize state of start pins  pdw 11/12/19
-    ADS1298_START_DIR = 0; // START is output
-    ADS1298_RESET_PIN = 1;  // initialize state of reset pins pdw 11/12/19
-	ADS1298_RESET_DIR = 0; // RESET is output
-    ADS1298_PWR_PIN = 0;  //initialize state of power down pins pdw 11/12/19
-	ADS1298_PWR_DIR = 0; // PWRDN on ADS1298 is output from PIC
 
 	return 1;
 }
@@ -138,12 +158,15 @@ unsigned char CommADS1298_Read(unsigned char* data,
 {
     unsigned char i;
     
+    PROFILER_START(PROFILER_COMM_READ);
     for(i = 0; i < bytesNumber; i++) {  
+        SUPERVISOR_STALL_POINT(); // hang here when testing the watchdog restart
         CommADS1298_DATABUFFER = 0x00; // write 0's to the data buffer to shift bits in
         while (!CommADS1298_BUFFERFULL); // while transmission has yet to be completed, wait
         *data++ = CommADS1298_DATABUFFER; 
         CommADS1298_INTERRUPT = 0; // reset the interrupt flag
     }
+    PROFILER_STOP(PROFILER_COMM_READ);
     
     return bytesNumber;
 }
\ No newline at end of file
@@ -92,6 +92,16 @@
 #define ADS1298_DRDY2_ANSEL		ANSELAbits.ANSA1    // DRDY pin analog select bit
 #define ADS1298_DRDY2_NOT		PORTAbits.RA1       // DRDY pin (input)
 
+/* Define the CS and DRDY lines of each device as bits of one port, so that
+ * several devices can be selected or polled with a single access */
+#define CommADS1298_CS_PORT			LATA                // port holding every CS line
+#define CommADS1298_CS1_MASK		(0b1u << 2)         // CS (device 1) on RA2
+#define CommADS1298_CS2_MASK		(0b1u << 3)         // CS (device 2) on RA3
+
+#define ADS1298_DRDY_PORT			PORTA               // port holding every DRDY line
+#define ADS1298_DRDY1_MASK			(0b1u << 0)         // DRDY (device 1) on RA0
+#define ADS1298_DRDY2_MASK			(0b1u << 1)         // DRDY (device 2) on RA1
+
 #define ADS1298_START_DIR		TRISAbits.RA4       // RESET pin direction
 #define ADS1298_START_PIN   	LATAbits.LATA4      // RESET pin (output)
 
@@ -108,6 +118,9 @@
 /* Initializes the SPI communication peripheral. */
 unsigned char CommADS1298_Initialize();
 
+/* Initializes the SPI communication peripheral, leaving the control pins alone. */
+unsigned char CommADS1298_InitializeSpi();
+
 /* Writes data to SPI. */
 unsigned char CommADS1298_Write(unsigned char* data,
 								unsigned char bytesNumber);
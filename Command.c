@@ -0,0 +1,137 @@
+/***************************************************************************//**
+ *   @file   Command.c
+ *   @brief  Implementation of the decoder of the commands sent by the relay.
+ *           The bytes of the RC ring are framed into commands and every
+ *           command is run by the handler set for its opcode. A command with
+ *           a wrong check byte or length is dropped whole, the decoder then
+ *           waits for the next COMMAND_SYNC.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Command.h"
+
+/*****************************************************************************/
+/* DEFINITIONS																 */
+/*****************************************************************************/
+#define COMMAND_WAIT_SYNC			0
+#define COMMAND_WAIT_OPCODE			1
+#define COMMAND_WAIT_LENGTH			2
+#define COMMAND_WAIT_PAYLOAD		3
+#define COMMAND_WAIT_CHECK			4
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static Command_Handler handlers[COMMAND_OPCODES];
+static unsigned char lengths[COMMAND_OPCODES];
+static unsigned char payload[COMMAND_MAX_PAYLOAD];
+static unsigned char state = COMMAND_WAIT_SYNC;
+static unsigned char opcode = 0, length = 0, count = 0;
+static unsigned char check = 0;		// XOR of the bytes after COMMAND_SYNC
+static unsigned int errors = 0;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Removes the handlers of every opcode and waits for the next
+ *          COMMAND_SYNC.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Command_Initialize() {
+	unsigned char i;
+	
+	for (i = 0; i < COMMAND_OPCODES; i = i + 1) {
+		handlers[i] = 0;
+		lengths[i] = 0;
+	}
+	state = COMMAND_WAIT_SYNC;
+	errors = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Sets the handler of an opcode.
+ *
+ * @param	opcode - Opcode of the command, COMMAND_*.
+ * @param	length - Bytes of the payload of the command.
+ * @param	handler - Function running the command.
+ *
+ * @return	1 - handler set, 0 - opcode or length out of range.
+*******************************************************************************/
+unsigned char Command_SetHandler(unsigned char opcode, unsigned char length, Command_Handler handler) {
+	if ((opcode >= COMMAND_OPCODES) || (length > COMMAND_MAX_PAYLOAD)) { return 0; }
+	
+	handlers[opcode] = handler;
+	lengths[opcode] = length;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Decodes the next byte received from the relay. The command it
+ *          completes is run, unless its check byte is wrong or its opcode
+ *          has no handler or another payload length.
+ *
+ * @param	data - Byte read from the RC ring.
+ *
+ * @return	1 - a command was run, 0 - no command completed or dropped.
+*******************************************************************************/
+unsigned char Command_AddByte(unsigned char data) {
+	switch (state) {
+		case COMMAND_WAIT_SYNC:
+			if (data == COMMAND_SYNC) { state = COMMAND_WAIT_OPCODE; }
+			return 0;
+			
+		case COMMAND_WAIT_OPCODE:
+			opcode = data;
+			check = data;
+			state = COMMAND_WAIT_LENGTH;
+			return 0;
+			
+		case COMMAND_WAIT_LENGTH:
+			/* A length out of range is a corrupted header, look for the next sync */
+			if (data > COMMAND_MAX_PAYLOAD) {
+				errors = errors + 1;
+				state = COMMAND_WAIT_SYNC;
+				return 0;
+			}
+			length = data;
+			count = 0;
+			check = check ^ data;
+			state = (length == 0) ? COMMAND_WAIT_CHECK : COMMAND_WAIT_PAYLOAD;
+			return 0;
+			
+		case COMMAND_WAIT_PAYLOAD:
+			payload[count] = data;
+			count = count + 1;
+			check = check ^ data;
+			if (count == length) { state = COMMAND_WAIT_CHECK; }
+			return 0;
+	}
+	
+	/* Check byte, the command is complete */
+	state = COMMAND_WAIT_SYNC;
+	if ((data != check) || (opcode >= COMMAND_OPCODES) || (handlers[opcode] == 0) || (length != lengths[opcode])) {
+		errors = errors + 1;
+		return 0;
+	}
+	handlers[opcode](payload);
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the number of commands dropped on a wrong check byte, an
+ *          opcode with no handler or a wrong length.
+ *
+ * @param	None.
+ *
+ * @return	Commands dropped since the initialization.
+*******************************************************************************/
+unsigned int Command_GetErrors() {
+	return errors;
+}
@@ -0,0 +1,36 @@
+/***************************************************************************//**
+ *   @file   Command.h
+ *   @brief  Header file of the decoder of the commands sent by the relay.
+*******************************************************************************/
+#ifndef _COMMAND_H_
+#define _COMMAND_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Runs a command, the payload has the length set with its handler */
+typedef void (*Command_Handler)(unsigned char* data);
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Removes the handlers and waits for the next command */
+void Command_Initialize(void);
+
+/* Sets the handler of an opcode */
+unsigned char Command_SetHandler(unsigned char opcode, unsigned char length, Command_Handler handler);
+
+/* Decodes the next byte received and runs the command it completes */
+unsigned char Command_AddByte(unsigned char data);
+
+/* Gets the number of commands dropped */
+unsigned int Command_GetErrors(void);
+
+#endif /* _COMMAND_H_ */
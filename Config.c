@@ -0,0 +1,148 @@
+/***************************************************************************//**
+ *   @file   Config.c
+ *   @brief  Implementation of the configuration stored in the PIC data EEPROM.
+ *           The active register images, channel masks and radio profile are
+ *           kept there so that a reset can restore them without going through
+ *           the default register values again.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Config.h"
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Reads a byte of the data EEPROM.
+ *
+ * @param	address - Address of the byte in the data EEPROM.
+ *
+ * @return	Byte read.
+*******************************************************************************/
+unsigned char Config_ReadEEPROM(unsigned char address) {
+	EEADR = address;
+	EECON1bits.EEPGD = 0;	// access the data EEPROM
+	EECON1bits.CFGS = 0;	// not the configuration registers
+	EECON1bits.RD = 1;		// data is available on the next cycle
+	
+	return EEDATA;
+}
+
+/***************************************************************************//**
+ * @brief	Writes a byte of the data EEPROM and waits for the end of the
+ *          write (about 4 ms). The byte is not written if it already holds the
+ *          value, which saves time and the endurance of the cell.
+ *
+ * @param	address - Address of the byte in the data EEPROM.
+ * @param	data - Byte to write.
+ *
+ * @return	None.
+*******************************************************************************/
+void Config_WriteEEPROM(unsigned char address, unsigned char data) {
+	unsigned char interrupts;
+	
+	if (Config_ReadEEPROM(address) == data) { return; }
+	
+	EEADR = address;
+	EEDATA = data;
+	EECON1bits.EEPGD = 0;
+	EECON1bits.CFGS = 0;
+	EECON1bits.WREN = 1;
+	
+	/* The unlock sequence must not be interrupted */
+	interrupts = INTCONbits.GIEH;
+	INTCONbits.GIEH = 0;
+	EECON2 = 0x55;
+	EECON2 = 0xAA;
+	EECON1bits.WR = 1;
+	INTCONbits.GIEH = interrupts;
+	
+	/* Wait for the write to complete */
+	while (EECON1bits.WR);
+	EECON1bits.WREN = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Computes the checksum of a configuration.
+ *
+ * @param	config - Configuration to compute the checksum of.
+ *
+ * @return	Two's complement of the sum of every byte except the checksum, so
+ *          that the bytes of a valid block add up to 0.
+*******************************************************************************/
+unsigned char Config_Checksum(Config* config) {
+	unsigned char* bytes = (unsigned char*) config;
+	unsigned char sum = 0;
+	unsigned char i;
+	
+	for (i = 0; i < sizeof(Config) - 1; i = i + 1) {
+		sum = sum + bytes[i];
+	}
+	
+	return (unsigned char) (0 - sum);
+}
+
+/***************************************************************************//**
+ * @brief	Loads the configuration from the data EEPROM.
+ *
+ * @param	config - Configuration receiving the block read.
+ *
+ * @return	1 - valid configuration loaded, 0 - blank, old or corrupted block.
+*******************************************************************************/
+unsigned char Config_Load(Config* config) {
+	unsigned char* bytes = (unsigned char*) config;
+	unsigned char i;
+	
+	for (i = 0; i < sizeof(Config); i = i + 1) {
+		bytes[i] = Config_ReadEEPROM(CONFIG_EEPROM_ADDRESS + i);
+	}
+	
+	if (config->version != CONFIG_VERSION) { return 0; }
+	if (config->checksum != Config_Checksum(config)) { return 0; }
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Saves the configuration to the data EEPROM. The version byte is
+ *          invalidated first and written last, so a reset in the middle of
+ *          the save leaves a block that Config_Load rejects.
+ *
+ * @param	config - Configuration to save, its version and checksum are set.
+ *
+ * @return	None.
+*******************************************************************************/
+void Config_Save(Config* config) {
+	unsigned char* bytes = (unsigned char*) config;
+	unsigned char i;
+	
+	config->version = CONFIG_VERSION;
+	config->checksum = Config_Checksum(config);
+	
+	/* Nothing to do if the stored block is the same */
+	for (i = 0; i < sizeof(Config); i = i + 1) {
+		if (Config_ReadEEPROM(CONFIG_EEPROM_ADDRESS + i) != bytes[i]) { break; }
+	}
+	if (i == sizeof(Config)) { return; }
+	
+	Config_WriteEEPROM(CONFIG_EEPROM_ADDRESS, CONFIG_ERASED);
+	for (i = 1; i < sizeof(Config); i = i + 1) {
+		Config_WriteEEPROM(CONFIG_EEPROM_ADDRESS + i, bytes[i]);
+	}
+	Config_WriteEEPROM(CONFIG_EEPROM_ADDRESS, config->version);
+}
+
+/***************************************************************************//**
+ * @brief	Invalidates the configuration stored in the data EEPROM, the next
+ *          boot goes through the default register values.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Config_Erase() {
+	Config_WriteEEPROM(CONFIG_EEPROM_ADDRESS, CONFIG_ERASED);
+}
@@ -0,0 +1,73 @@
+/***************************************************************************//**
+ *   @file   Config.h
+ *   @brief  Header file of the configuration stored in the PIC data EEPROM.
+*******************************************************************************/
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include <p18f46k22.h>
+#include "ADS1298.h"
+
+/******************************************************************************/
+/* CONFIGURATION BLOCK														  */
+/******************************************************************************/
+
+/* The block is stored at CONFIG_EEPROM_ADDRESS as: version, register images,
+ * channel masks, radio profile, stream flag and checksum. Bump CONFIG_VERSION whenever the
+ * layout of Config changes, an old block is then ignored at boot.
+ */
+#define CONFIG_EEPROM_ADDRESS		0x00
+#define CONFIG_VERSION				0x03
+#define CONFIG_ERASED				0xFF	// version byte of a blank or invalidated block
+
+#define CONFIG_IMAGE_SIZE			(ADS1298_REGISTER_COUNT - 1) // CONFIG1 to WCT2, ID is read-only
+
+/* Radio profile, CC110L registers written when the radio is set up and the
+ * forward error correction of the bytes sent (FEC_NONE or FEC_HAMMING) */
+#define CONFIG_RADIO_SIZE			9
+#define CONFIG_RADIO_CHANNR			0
+#define CONFIG_RADIO_FREQ2			1
+#define CONFIG_RADIO_FREQ1			2
+#define CONFIG_RADIO_FREQ0			3
+#define CONFIG_RADIO_MDMCFG4		4
+#define CONFIG_RADIO_MDMCFG3		5
+#define CONFIG_RADIO_MDMCFG2		6
+#define CONFIG_RADIO_DEVIATN		7
+#define CONFIG_RADIO_FEC			8
+
+/* Configuration restored at boot */
+typedef struct {
+	unsigned char version;
+	unsigned char registers[ADS1298_DEVICE_COUNT][CONFIG_IMAGE_SIZE];	// CONFIG1 to WCT2 of each device
+	unsigned char channels[ADS1298_DEVICE_COUNT];						// channel mask of each device
+	unsigned char radio[CONFIG_RADIO_SIZE];
+	unsigned char streaming;		// 1 - the relay left the implant streaming, resumed at a cold boot
+	unsigned char checksum;			// two's complement of the sum of the other bytes
+} Config;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Reads a byte of the data EEPROM */
+unsigned char Config_ReadEEPROM(unsigned char address);
+
+/* Writes a byte of the data EEPROM */
+void Config_WriteEEPROM(unsigned char address, unsigned char data);
+
+/* Computes the checksum of a configuration */
+unsigned char Config_Checksum(Config* config);
+
+/* Loads the configuration from the data EEPROM */
+unsigned char Config_Load(Config* config);
+
+/* Saves the configuration to the data EEPROM */
+void Config_Save(Config* config);
+
+/* Invalidates the configuration stored in the data EEPROM */
+void Config_Erase(void);
+
+#endif /* _CONFIG_H_ */
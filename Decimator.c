@@ -0,0 +1,231 @@
+/***************************************************************************//**
+ *   @file   Decimator.c
+ *   @brief  Implementation of the CIC + half-band decimator of the frames. The
+ *           ADS1298 can convert at 4 or 8 kSPS for a better anti-aliasing and
+ *           the frames are decimated to the rate sent to the relay. Integer
+ *           only, one frame at a time, with the state of every channel kept.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Decimator.h"
+#include "FixedPoint.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+
+/* C18 keeps an array within a bank, the channels are split in one array per bank */
+#if defined(__18CXX)
+#pragma udata DecimatorBank0
+#endif
+static Decimator_Channel bank0[DECIMATOR_BANK_CHANNELS];
+#if DECIMATOR_BANKS > 1
+#if defined(__18CXX)
+#pragma udata DecimatorBank1
+#endif
+static Decimator_Channel bank1[DECIMATOR_BANK_CHANNELS];
+#endif
+#if DECIMATOR_BANKS > 2
+#if defined(__18CXX)
+#pragma udata DecimatorBank2
+#endif
+static Decimator_Channel bank2[DECIMATOR_BANK_CHANNELS];
+#endif
+#if DECIMATOR_BANKS > 3
+#if defined(__18CXX)
+#pragma udata DecimatorBank3
+#endif
+static Decimator_Channel bank3[DECIMATOR_BANK_CHANNELS];
+#endif
+#if defined(__18CXX)
+#pragma udata
+#endif
+
+static Decimator_Channel* banks[DECIMATOR_BANKS] = {
+	bank0
+#if DECIMATOR_BANKS > 1
+	, bank1
+#endif
+#if DECIMATOR_BANKS > 2
+	, bank2
+#endif
+#if DECIMATOR_BANKS > 3
+	, bank3
+#endif
+};
+
+static unsigned char factor = 1;		// 1 bypasses the decimator
+static unsigned char cicRatio = 1;
+static unsigned char cicShift = 0;		// log2(cicRatio ^ DECIMATOR_CIC_ORDER), the CIC gain
+static unsigned char cicPhase = 0;
+static unsigned char hbIndex = 0;		// next slot of the half-band even lines
+static unsigned char oddIndex = 0;		// next slot of the half-band odd lines, oldest input
+static unsigned char hbPhase = 0;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Sets the decimation factor and clears the filter state.
+ *
+ * @param	newFactor - 1 (no decimation), 2 (half-band only), 4, 8 or 16
+ *                      (CIC by newFactor / 2, then half-band).
+ *
+ * @return	1 - factor set, 0 - unsupported factor.
+*******************************************************************************/
+unsigned char Decimator_SetFactor(unsigned char newFactor) {
+	switch (newFactor) {
+		case 1:  cicRatio = 1; cicShift = 0; break;
+		case 2:  cicRatio = 1; cicShift = 0; break;
+		case 4:  cicRatio = 2; cicShift = 2; break;
+		case 8:  cicRatio = 4; cicShift = 4; break;
+		case 16: cicRatio = 8; cicShift = 6; break;
+		default: return 0;
+	}
+	factor = newFactor;
+	Decimator_Reset();
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the decimation factor.
+ *
+ * @param	None.
+ *
+ * @return	Decimation factor, 1 if the decimator is bypassed.
+*******************************************************************************/
+unsigned char Decimator_GetFactor() {
+	return factor;
+}
+
+/***************************************************************************//**
+ * @brief	Clears the filter state of every channel. Called when the frame
+ *          layout changes or a frame is lost.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Decimator_Reset() {
+	Decimator_Channel* ch;
+	unsigned char i, j;
+	
+	for (i = 0; i < DECIMATOR_CHANNELS; i = i + 1) {
+		ch = &banks[i / DECIMATOR_BANK_CHANNELS][i % DECIMATOR_BANK_CHANNELS];
+		for (j = 0; j < DECIMATOR_CIC_ORDER; j = j + 1) {
+			ch->integrator[j] = 0;
+			ch->comb[j] = 0;
+		}
+		for (j = 0; j < DECIMATOR_HB_EVEN; j = j + 1) {
+			ch->even[j] = 0;
+		}
+		for (j = 0; j < DECIMATOR_HB_ODD; j = j + 1) {
+			ch->odd[j] = 0;
+		}
+	}
+	cicPhase = 0;
+	hbIndex = 0;
+	oddIndex = 0;
+	hbPhase = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a frame to the decimator. The CIC integrators run at the input
+ *          rate, the combs and the half-band filter only when they produce a
+ *          sample, so most frames cost one addition per stage and channel.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel. Replaced by
+ *                  the decimated frame when one is ready.
+ * @param	channelCount - Number of channels in the frame. The channels after
+ *                         DECIMATOR_CHANNELS keep the sample of the frame
+ *                         completing the decimated one.
+ *
+ * @return	1 - frame holds a decimated frame, 0 - no output for this frame.
+*******************************************************************************/
+unsigned char Decimator_AddFrame(unsigned char* frame, unsigned char channelCount) {
+	Decimator_Channel* ch;
+	unsigned char taps[DECIMATOR_HB_EVEN];
+	unsigned char* bytes;
+	unsigned long value, previous;
+	long x;
+	unsigned char i, j;
+	
+	if (factor == 1) { return 1; }
+	if (channelCount > DECIMATOR_CHANNELS) { channelCount = DECIMATOR_CHANNELS; }
+	
+	/* Integrators at the input rate */
+	for (i = 0; i < channelCount; i = i + 1) {
+		ch = &banks[i / DECIMATOR_BANK_CHANNELS][i % DECIMATOR_BANK_CHANNELS];
+		bytes = frame + (i * 3);
+		x = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+		if (bytes[0] & 0x80) { x = x - 0x1000000L; }
+		
+		value = (unsigned long) x;
+		for (j = 0; j < DECIMATOR_CIC_ORDER; j = j + 1) {
+			ch->integrator[j] = ch->integrator[j] + value;
+			value = ch->integrator[j];
+		}
+	}
+	
+	cicPhase = cicPhase + 1;
+	if (cicPhase < cicRatio) { return 0; }
+	cicPhase = 0;
+	
+	/* Half-band taps of the output phase from the newest input back, x[n - 2j] */
+	for (j = 0; j < DECIMATOR_HB_EVEN; j = j + 1) {
+		taps[j] = (hbIndex + DECIMATOR_HB_EVEN - j) % DECIMATOR_HB_EVEN;
+	}
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		ch = &banks[i / DECIMATOR_BANK_CHANNELS][i % DECIMATOR_BANK_CHANNELS];
+		
+		/* Combs, the differences are exact modulo 2^32 */
+		value = ch->integrator[DECIMATOR_CIC_ORDER - 1];
+		for (j = 0; j < DECIMATOR_CIC_ORDER; j = j + 1) {
+			previous = ch->comb[j];
+			ch->comb[j] = value;
+			value = (value - previous) & 0xFFFFFFFFUL;
+		}
+		if (value & 0x80000000UL) {
+			x = -(long) ((~value + 1) & 0xFFFFFFFFUL);
+		} else {
+			x = (long) value;
+		}
+		x = FixedPoint_Shift(x, cicShift);
+		
+		/* The other phase only feeds the center tap */
+		if (!hbPhase) {
+			ch->odd[oddIndex] = x;
+			continue;
+		}
+		ch->even[hbIndex] = x;
+		
+		/* Half-band output, symmetric taps added before the product. The
+		 * oldest input of the odd line is x[n-5] */
+		x = FixedPoint_Shift(ch->odd[oddIndex], 1) +
+			FixedPoint_Mul(ch->even[taps[2]] + ch->even[taps[3]], DECIMATOR_HB_C1, 15) +
+			FixedPoint_Mul(ch->even[taps[1]] + ch->even[taps[4]], DECIMATOR_HB_C3, 15) +
+			FixedPoint_Mul(ch->even[taps[0]] + ch->even[taps[5]], DECIMATOR_HB_C5, 15);
+		
+		/* Saturate back to a 24-bit sample */
+		if (x > 0x7FFFFFL) { x = 0x7FFFFFL; }
+		if (x < -0x800000L) { x = -0x800000L; }
+		bytes = frame + (i * 3);
+		bytes[0] = (unsigned char) (x >> 16);
+		bytes[1] = (unsigned char) (x >> 8);
+		bytes[2] = (unsigned char) x;
+	}
+	
+	if (hbPhase) {
+		hbIndex = (hbIndex + 1) % DECIMATOR_HB_EVEN;
+	} else {
+		oddIndex = (oddIndex + 1) % DECIMATOR_HB_ODD;
+	}
+	hbPhase = !hbPhase;
+	
+	return !hbPhase; // a half-band output was just written
+}
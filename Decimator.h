@@ -0,0 +1,67 @@
+/***************************************************************************//**
+ *   @file   Decimator.h
+ *   @brief  Header file of the CIC + half-band decimator of the frames.
+*******************************************************************************/
+#ifndef _DECIMATOR_H_
+#define _DECIMATOR_H_
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Number of channels decimated, the following ones are only downsampled (no
+ * anti-aliasing). The implant does not decimate with more channels on. Define
+ * it to the channel count of the montage when building to size the state for
+ * it, 52 bytes per channel.
+ */
+#ifndef DECIMATOR_CHANNELS
+#define DECIMATOR_CHANNELS			8		// 1 to ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT
+#endif
+#define DECIMATOR_MAX_FACTOR		16
+
+/* The state takes one udata section per RAM bank, 4 channels (208 bytes) each */
+#define DECIMATOR_BANK_CHANNELS		4
+#define DECIMATOR_BANKS				((DECIMATOR_CHANNELS + DECIMATOR_BANK_CHANNELS - 1) / DECIMATOR_BANK_CHANNELS)
+
+/* CIC stage, decimates by factor / 2 */
+#define DECIMATOR_CIC_ORDER			2		// 24-bit samples grow by 6 bits at a ratio of 8
+
+/* Half-band stage, decimates by 2. Q15 taps around the 0.5 center tap, the
+ * even taps are 0. They are fitted to flatten the droop of the CIC at a ratio
+ * of 4 (within 0.2 dB up to a quarter of the output rate) with a unity DC gain.
+ * The 11-tap delay line is split in its two phases, the inputs of the output
+ * phase go through the symmetric taps and only the center tap is kept of the
+ * other phase.
+ */
+#define DECIMATOR_HB_TAPS			11
+#define DECIMATOR_HB_EVEN			6		// inputs of the output phase, x[n] to x[n-10]
+#define DECIMATOR_HB_ODD			3		// inputs of the other phase, x[n-1] to x[n-5]
+#define DECIMATOR_HB_C1				10205
+#define DECIMATOR_HB_C3				(-2651)
+#define DECIMATOR_HB_C5				638
+
+/* Filter state of a channel */
+typedef struct {
+	unsigned long integrator[DECIMATOR_CIC_ORDER];	// wrap around, only their differences are used
+	unsigned long comb[DECIMATOR_CIC_ORDER];		// previous inputs of the comb sections
+	long even[DECIMATOR_HB_EVEN];					// half-band delay lines, circular
+	long odd[DECIMATOR_HB_ODD];
+} Decimator_Channel;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Sets the decimation factor */
+unsigned char Decimator_SetFactor(unsigned char factor);
+
+/* Gets the decimation factor */
+unsigned char Decimator_GetFactor(void);
+
+/* Clears the filter state of every channel */
+void Decimator_Reset(void);
+
+/* Adds a frame and tells whether a decimated frame is ready */
+unsigned char Decimator_AddFrame(unsigned char* frame, unsigned char channelCount);
+
+#endif /* _DECIMATOR_H_ */
@@ -0,0 +1,132 @@
+/***************************************************************************//**
+ *   @file   Envelope.c
+ *   @brief  Implementation of the min/max/mean envelope of the frames. When
+ *           the link is congested the relay keeps a live view from the
+ *           envelope of every channel, 9 bytes per channel for a window of
+ *           frames instead of 3 bytes per channel and frame.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Envelope.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static Envelope_Channel channels[ENVELOPE_MAX_CHANNELS];
+static unsigned char window = 10;		// frames per envelope, 20 ms at 500 SPS
+static unsigned char count = 0;			// frames in the current window
+static unsigned char channelTotal = 0;	// channels of the current window
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Sets the number of frames per envelope and drops the current
+ *          window.
+ *
+ * @param	frames - Frames per envelope, from 1 to ENVELOPE_MAX_WINDOW. 20 ms
+ *                   at the rate of the frames keeps the QRS visible.
+ *
+ * @return	1 - window set, 0 - invalid window.
+*******************************************************************************/
+unsigned char Envelope_SetWindow(unsigned char frames) {
+	if (frames == 0) { return 0; }
+	
+	window = frames;
+	Envelope_Reset();
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Drops the current window. Called when the frame layout changes or
+ *          a frame is lost.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Envelope_Reset() {
+	count = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a frame to the envelope of every channel and tells whether
+ *          the window is complete.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame.
+ *
+ * @return	1 - window complete, read it with Envelope_GetRecord, 0 - more
+ *          frames needed.
+*******************************************************************************/
+unsigned char Envelope_AddFrame(unsigned char* frame, unsigned char channelCount) {
+	Envelope_Channel* ch;
+	unsigned char* bytes;
+	long x;
+	unsigned char i;
+	
+	if (channelCount > ENVELOPE_MAX_CHANNELS) { channelCount = ENVELOPE_MAX_CHANNELS; }
+	if ((count != 0) && (channelCount != channelTotal)) { count = 0; }
+	channelTotal = channelCount;
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		ch = &channels[i];
+		bytes = frame + (i * 3);
+		x = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+		if (bytes[0] & 0x80) { x = x - 0x1000000L; }
+		
+		if (count == 0) {
+			ch->min = x;
+			ch->max = x;
+			ch->sum = x;
+		} else {
+			if (x < ch->min) { ch->min = x; }
+			if (x > ch->max) { ch->max = x; }
+			ch->sum = ch->sum + x;
+		}
+	}
+	
+	count = count + 1;
+	if (count < window) { return 0; }
+	count = 0;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the envelope of the last window completed.
+ *
+ * @param	out - Receives the window, the channel count, then the minimum,
+ *                maximum and mean of every channel (3 bytes each, MSB first).
+ *
+ * @return	Number of bytes written to out.
+*******************************************************************************/
+unsigned char Envelope_GetRecord(unsigned char* out) {
+	Envelope_Channel* ch;
+	unsigned char* bytes = out + 2;
+	long mean;
+	unsigned char i;
+	
+	out[0] = window;
+	out[1] = channelTotal;
+	for (i = 0; i < channelTotal; i = i + 1) {
+		ch = &channels[i];
+		mean = ch->sum / window;
+		bytes[0] = (unsigned char) (ch->min >> 16);
+		bytes[1] = (unsigned char) (ch->min >> 8);
+		bytes[2] = (unsigned char) ch->min;
+		bytes[3] = (unsigned char) (ch->max >> 16);
+		bytes[4] = (unsigned char) (ch->max >> 8);
+		bytes[5] = (unsigned char) ch->max;
+		bytes[6] = (unsigned char) (mean >> 16);
+		bytes[7] = (unsigned char) (mean >> 8);
+		bytes[8] = (unsigned char) mean;
+		bytes = bytes + 9;
+	}
+	
+	return 2 + (channelTotal * 9);
+}
@@ -0,0 +1,44 @@
+/***************************************************************************//**
+ *   @file   Envelope.h
+ *   @brief  Header file of the min/max/mean envelope of the frames.
+*******************************************************************************/
+#ifndef _ENVELOPE_H_
+#define _ENVELOPE_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define ENVELOPE_MAX_CHANNELS		16		// ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT
+#define ENVELOPE_MAX_WINDOW			255		// 24-bit sums stay within 32 bits
+
+/* Size of an ENVELOPE record with every channel */
+#define ENVELOPE_MAX_BYTES			(2 + (ENVELOPE_MAX_CHANNELS * 9))
+
+/* Envelope of a channel over the current window */
+typedef struct {
+	long min, max;
+	long sum;
+} Envelope_Channel;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Sets the number of frames per envelope */
+unsigned char Envelope_SetWindow(unsigned char frames);
+
+/* Drops the current window */
+void Envelope_Reset(void);
+
+/* Adds a frame and tells whether the window is complete */
+unsigned char Envelope_AddFrame(unsigned char* frame, unsigned char channelCount);
+
+/* Gets the envelope of the window as sent in an ENVELOPE record */
+unsigned char Envelope_GetRecord(unsigned char* out);
+
+#endif /* _ENVELOPE_H_ */
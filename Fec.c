@@ -0,0 +1,148 @@
+/***************************************************************************//**
+ *   @file   Fec.c
+ *   @brief  Implementation of the forward error correction of the radio
+ *           bytes. The bytes are coded by blocks with an interleaved
+ *           Hamming(7,4) code, 14 bytes on air for 8, which lets the relay
+ *           correct the bit errors of a noisy link without a retransmission.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Fec.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+
+/* Hamming(7,4) codeword of every nibble */
+static const unsigned char hamming[16] = {
+	0x00, 0x07, 0x19, 0x1E, 0x2A, 0x2D, 0x33, 0x34,
+	0x4B, 0x4C, 0x52, 0x55, 0x61, 0x66, 0x78, 0x7F
+};
+
+static unsigned char code = FEC_NONE;
+static unsigned char block[FEC_DATA_SIZE];
+static unsigned char count = 0;
+static unsigned char coded[FEC_CODED_SIZE];
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Selects the code and empties the block.
+ *
+ * @param	selected - FEC_NONE or FEC_HAMMING.
+ *
+ * @return	1 - code selected, 0 - unknown code, FEC_NONE selected.
+*******************************************************************************/
+unsigned char Fec_Configure(unsigned char selected) {
+	count = 0;
+	if ((selected != FEC_NONE) && (selected != FEC_HAMMING)) {
+		code = FEC_NONE;
+		return 0;
+	}
+	
+	code = selected;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the code selected.
+ *
+ * @param	None.
+ *
+ * @return	FEC_NONE or FEC_HAMMING.
+*******************************************************************************/
+unsigned char Fec_GetCode() {
+	return code;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the bytes that can be coded in the room left in the radio
+ *          ring, counting the bytes already waiting in the block.
+ *
+ * @param	room - Free bytes in the radio ring.
+ *
+ * @return	Bytes that can be added with Fec_PutByte.
+*******************************************************************************/
+unsigned char Fec_GetRoom(unsigned char room) {
+	unsigned char blocks;
+	
+	if (code == FEC_NONE) { return room; }
+	
+	blocks = room / FEC_CODED_SIZE;
+	if (blocks == 0) { return 0; }
+	return blocks * FEC_DATA_SIZE - count;
+}
+
+/***************************************************************************//**
+ * @brief	Codes the block, the codewords are spread by bit over the coded
+ *          bytes.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Fec_Encode() {
+	unsigned char word, b, k;
+	
+	for (k = 0; k < 2 * FEC_DATA_SIZE; k = k + 1) {
+		word = (k & 1) ? hamming[block[k >> 1] >> 4] : hamming[block[k >> 1] & 0x0F];
+		
+		/* Bit b of the codeword is shifted into the byte of plane b */
+		for (b = 0; b < 7; b = b + 1) {
+			coded[(b << 1) + (k >> 3)] = (coded[(b << 1) + (k >> 3)] >> 1) | (word << 7);
+			word = word >> 1;
+		}
+	}
+	count = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a byte to the block, coding the block when it is full.
+ *
+ * @param	data - Byte to send.
+ *
+ * @return	1 - a block was coded, read it with Fec_GetBlock, 0 - not yet.
+*******************************************************************************/
+unsigned char Fec_PutByte(unsigned char data) {
+	block[count] = data;
+	count = count + 1;
+	if (count < FEC_DATA_SIZE) { return 0; }
+	
+	Fec_Encode();
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Completes the block with FILL bytes, so that the bytes waiting
+ *          in it go out before the radio runs out of bytes.
+ *
+ * @param	None.
+ *
+ * @return	1 - a block was coded, read it with Fec_GetBlock, 0 - the block
+ *          was empty.
+*******************************************************************************/
+unsigned char Fec_Complete() {
+	if (count == 0) { return 0; }
+	
+	while (count < FEC_DATA_SIZE) {
+		block[count] = IMPLANT_TAG_FILL;
+		count = count + 1;
+	}
+	Fec_Encode();
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the last block coded.
+ *
+ * @param	None.
+ *
+ * @return	FEC_CODED_SIZE coded bytes.
+*******************************************************************************/
+unsigned char* Fec_GetBlock() {
+	return coded;
+}
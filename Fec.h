@@ -0,0 +1,35 @@
+/***************************************************************************//**
+ *   @file   Fec.h
+ *   @brief  Header file of the forward error correction of the radio bytes.
+*******************************************************************************/
+#ifndef _FEC_H_
+#define _FEC_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Selects the code and empties the block */
+unsigned char Fec_Configure(unsigned char selected);
+
+/* Gets the code selected */
+unsigned char Fec_GetCode(void);
+
+/* Gets the bytes that can be coded in the room left in the radio ring */
+unsigned char Fec_GetRoom(unsigned char room);
+
+/* Adds a byte to the block */
+unsigned char Fec_PutByte(unsigned char data);
+
+/* Completes the block with FILL bytes */
+unsigned char Fec_Complete(void);
+
+/* Gets the last block coded */
+unsigned char* Fec_GetBlock(void);
+
+#endif /* _FEC_H_ */
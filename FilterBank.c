@@ -0,0 +1,181 @@
+/***************************************************************************//**
+ *   @file   FilterBank.c
+ *   @brief  Implementation of the power-line notch and baseline high-pass
+ *           filter bank of the frames. Removing the 50/60 Hz interference and
+ *           the baseline wander before the encoders frees dynamic range for
+ *           the packer and lowers the residuals of the Rice coder. Integer
+ *           only, Q14/Q15 coefficients with 32-bit state.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "FilterBank.h"
+#include "FixedPoint.h"
+
+/*****************************************************************************/
+/* CONSTANTS    															 */
+/*****************************************************************************/
+
+/* Coefficients for the output rates of the decimator. The notch is 3 Hz wide
+ * at -3 dB (r = 1 - pi * 3 / rate). Above 2 kSPS the Q14 quantization moves
+ * the notch by up to 1 Hz, decimate first.
+ */
+static const FilterBank_Coefficients coefficients[] = {
+	/* rate, mains, b0,    b1,     a1,    a2,    hp    */
+	{ 250,  50, 31556,  -9751,  9744, 30344, 32356 },
+	{ 500,  50, 32156, -26015, 26010, 31544, 32562 },
+	{ 1000, 50, 32461, -30872, 30871, 32153, 32665 },
+	{ 2000, 50, 32614, -32212, 32212, 32460, 32717 },
+	{ 4000, 50, 32691, -32590, 32590, 32614, 32742 },
+	{ 8000, 50, 32729, -32704, 32704, 32691, 32755 },
+	{ 250,  60, 31556,  -1981,  1980, 30344, 32356 },
+	{ 500,  60, 32156, -23441, 23437, 31544, 32562 },
+	{ 1000, 60, 32461, -30181, 30180, 32153, 32665 },
+	{ 2000, 60, 32614, -32036, 32036, 32460, 32717 },
+	{ 4000, 60, 32691, -32546, 32546, 32614, 32742 },
+	{ 8000, 60, 32729, -32693, 32693, 32691, 32755 }
+};
+#define FILTERBANK_TABLE_SIZE		(sizeof(coefficients) / sizeof(coefficients[0]))
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+
+/* C18 keeps an array within a bank, the channels are split in one array per bank */
+#if defined(__18CXX)
+#pragma udata FilterBankBank0
+#endif
+static FilterBank_Channel bank0[FILTERBANK_BANK_CHANNELS];
+#if FILTERBANK_BANKS > 1
+#if defined(__18CXX)
+#pragma udata FilterBankBank1
+#endif
+static FilterBank_Channel bank1[FILTERBANK_BANK_CHANNELS];
+#endif
+#if defined(__18CXX)
+#pragma udata
+#endif
+
+static FilterBank_Channel* banks[FILTERBANK_BANKS] = {
+	bank0
+#if FILTERBANK_BANKS > 1
+	, bank1
+#endif
+};
+
+static const FilterBank_Coefficients* active = 0;
+static unsigned char enabled = 0;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Selects the filters for a sample rate and a power-line frequency
+ *          and clears the filter state.
+ *
+ * @param	rate - Rate of the frames filtered, in SPS, after decimation.
+ * @param	mains - Power-line frequency, 50 or 60 Hz.
+ * @param	filters - FILTERBANK_NOTCH and/or FILTERBANK_HIGHPASS, 0 bypasses
+ *                    the bank.
+ *
+ * @return	1 - filters set, 0 - no coefficients for this rate, bypassed.
+*******************************************************************************/
+unsigned char FilterBank_Configure(unsigned int rate, unsigned char mains, unsigned char filters) {
+	unsigned char i;
+	
+	active = 0;
+	enabled = 0;
+	for (i = 0; i < FILTERBANK_TABLE_SIZE; i = i + 1) {
+		if ((coefficients[i].rate == rate) && (coefficients[i].mains == mains)) { active = &coefficients[i]; }
+	}
+	if (active == 0) { return (filters == 0); }
+	
+	enabled = filters;
+	FilterBank_Reset();
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Clears the filter state of every channel. Called when the frame
+ *          layout changes or a frame is lost.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void FilterBank_Reset() {
+	FilterBank_Channel* ch;
+	unsigned char i;
+	
+	for (i = 0; i < FILTERBANK_CHANNELS; i = i + 1) {
+		ch = &banks[i / FILTERBANK_BANK_CHANNELS][i % FILTERBANK_BANK_CHANNELS];
+		ch->hx1 = 0;
+		ch->hy1 = 0;
+		ch->x1 = 0;
+		ch->x2 = 0;
+		ch->y1 = 0;
+		ch->y2 = 0;
+		ch->hpError = 0;
+		ch->a1Error = 0;
+		ch->a2Error = 0;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Filters a frame in place, the high-pass first so that the notch
+ *          does not carry the baseline. The recursive products keep their
+ *          dropped fraction bits (error feedback), the poles are close to the
+ *          unit circle.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame.
+ *
+ * @return	None.
+*******************************************************************************/
+void FilterBank_ProcessFrame(unsigned char* frame, unsigned char channelCount) {
+	FilterBank_Channel* ch;
+	unsigned char* bytes;
+	long x, y;
+	unsigned char i;
+	
+	if (enabled == 0) { return; }
+	if (channelCount > FILTERBANK_CHANNELS) { channelCount = FILTERBANK_CHANNELS; }
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		ch = &banks[i / FILTERBANK_BANK_CHANNELS][i % FILTERBANK_BANK_CHANNELS];
+		bytes = frame + (i * 3);
+		x = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+		if (bytes[0] & 0x80) { x = x - 0x1000000L; }
+		
+		/* Baseline wander high-pass */
+		if (enabled & FILTERBANK_HIGHPASS) {
+			y = x - ch->hx1 + FixedPoint_MulFeedback(ch->hy1, active->hp, 15, &ch->hpError);
+			ch->hx1 = x;
+			ch->hy1 = y;
+			x = y;
+		}
+		
+		/* Power-line notch, direct form I */
+		if (enabled & FILTERBANK_NOTCH) {
+			y = FixedPoint_Mul(x + ch->x2, active->b0, 15) +
+				FixedPoint_Mul(ch->x1, active->b1, 14) +
+				FixedPoint_MulFeedback(ch->y1, active->a1, 14, &ch->a1Error) -
+				FixedPoint_MulFeedback(ch->y2, active->a2, 15, &ch->a2Error);
+			ch->x2 = ch->x1;
+			ch->x1 = x;
+			ch->y2 = ch->y1;
+			ch->y1 = y;
+			x = y;
+		}
+		
+		/* Saturate back to a 24-bit sample */
+		if (x > 0x7FFFFFL) { x = 0x7FFFFFL; }
+		if (x < -0x800000L) { x = -0x800000L; }
+		bytes[0] = (unsigned char) (x >> 16);
+		bytes[1] = (unsigned char) (x >> 8);
+		bytes[2] = (unsigned char) x;
+	}
+}
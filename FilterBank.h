@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ *   @file   FilterBank.h
+ *   @brief  Header file of the power-line notch and baseline high-pass filter
+ *           bank of the frames.
+*******************************************************************************/
+#ifndef _FILTERBANK_H_
+#define _FILTERBANK_H_
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Number of channels filtered, the following ones pass through. Define it to
+ * the channel count of the montage when building to size the state and the
+ * loops for it, 30 bytes per channel.
+ */
+#ifndef FILTERBANK_CHANNELS
+#define FILTERBANK_CHANNELS			8		// 1 to ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT
+#endif
+
+/* The state takes one udata section per RAM bank, 8 channels (240 bytes) each */
+#define FILTERBANK_BANK_CHANNELS	8
+#define FILTERBANK_BANKS			((FILTERBANK_CHANNELS + FILTERBANK_BANK_CHANNELS - 1) / FILTERBANK_BANK_CHANNELS)
+
+/* Filters enabled by FilterBank_Configure */
+#define FILTERBANK_NOTCH			0x01	// 50 or 60 Hz notch, 3 Hz wide
+#define FILTERBANK_HIGHPASS			0x02	// 0.5 Hz baseline wander high-pass
+
+/* Coefficients for one sample rate and power-line frequency. The notch is
+ * (b0, b1, b0) / (1, -a1, a2) with b1 and a1 in Q14, b0 and a2 in Q15. The
+ * high-pass is y[n] = x[n] - x[n-1] + hp * y[n-1] with hp in Q15.
+ */
+typedef struct {
+	unsigned int rate;
+	unsigned char mains;
+	int b0, b1, a1, a2, hp;
+} FilterBank_Coefficients;
+
+/* Filter state of a channel */
+typedef struct {
+	long hx1, hy1;				// high-pass input and output of the previous sample
+	long x1, x2, y1, y2;		// notch inputs and outputs of the two previous samples
+	unsigned int hpError;		// fraction bits dropped by the recursive products
+	unsigned int a1Error, a2Error;
+} FilterBank_Channel;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Selects the filters for a sample rate and a power-line frequency */
+unsigned char FilterBank_Configure(unsigned int rate, unsigned char mains, unsigned char filters);
+
+/* Clears the filter state of every channel */
+void FilterBank_Reset(void);
+
+/* Filters a frame in place */
+void FilterBank_ProcessFrame(unsigned char* frame, unsigned char channelCount);
+
+#endif /* _FILTERBANK_H_ */
@@ -0,0 +1,80 @@
+/***************************************************************************//**
+ *   @file   FixedPoint.c
+ *   @brief  Implementation of the fixed-point helpers shared by the filters.
+ *           The samples have up to 26 bits and the coefficients 16, so their
+ *           product does not fit a C18 long. The sample is split in 16-bit
+ *           halves, each partial product fits in 32 bits.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "FixedPoint.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+#ifdef FIXEDPOINT_PROFILE
+unsigned long FixedPoint_MulCount = 0;
+#endif
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Shifts a signed value right, rounding towards minus infinity
+ *          whatever the compiler does with signed shifts.
+ *
+ * @param	x - Value to shift.
+ * @param	shift - Number of bits to shift by.
+ *
+ * @return	Shifted value.
+*******************************************************************************/
+long FixedPoint_Shift(long x, unsigned char shift) {
+	if (x < 0) { return -((-x - 1) >> shift) - 1; }
+	return x >> shift;
+}
+
+/***************************************************************************//**
+ * @brief	Multiplies a sample of up to 26 bits by a fixed-point coefficient.
+ *
+ * @param	x - Sample.
+ * @param	coefficient - Coefficient with fraction bits (Q15: 15, Q14: 14).
+ * @param	fraction - Number of fraction bits of the coefficient, 16 at most.
+ *
+ * @return	(x * coefficient) >> fraction, rounded towards minus infinity.
+*******************************************************************************/
+long FixedPoint_Mul(long x, int coefficient, unsigned char fraction) {
+	long high = FixedPoint_Shift(x, 16);
+	unsigned int low = (unsigned int) (x - (high * 65536L));
+	
+	FIXEDPOINT_COUNT_MUL();
+	return ((high * coefficient) << (16 - fraction)) + FixedPoint_Shift((long) low * coefficient, fraction);
+}
+
+/***************************************************************************//**
+ * @brief	Multiplies like FixedPoint_Mul and keeps the fraction bits it
+ *          drops, which are added to the next product. This error feedback
+ *          removes the bias and the limit cycles of recursive filters with
+ *          poles close to the unit circle.
+ *
+ * @param	x - Sample.
+ * @param	coefficient - Coefficient with fraction bits.
+ * @param	fraction - Number of fraction bits of the coefficient, 15 at most.
+ * @param	error - Fraction bits left by the previous product, updated.
+ *
+ * @return	(x * coefficient + error) >> fraction, rounded towards minus
+ *          infinity.
+*******************************************************************************/
+long FixedPoint_MulFeedback(long x, int coefficient, unsigned char fraction, unsigned int* error) {
+	long high = FixedPoint_Shift(x, 16);
+	unsigned int low = (unsigned int) (x - (high * 65536L));
+	long product;
+	
+	FIXEDPOINT_COUNT_MUL();
+	product = ((long) low * coefficient) + *error;
+	*error = (unsigned int) (product & ((0x01L << fraction) - 1));
+	
+	return ((high * coefficient) << (16 - fraction)) + FixedPoint_Shift(product, fraction);
+}
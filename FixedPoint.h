@@ -0,0 +1,35 @@
+/***************************************************************************//**
+ *   @file   FixedPoint.h
+ *   @brief  Header file of the fixed-point helpers shared by the filters.
+*******************************************************************************/
+#ifndef _FIXEDPOINT_H_
+#define _FIXEDPOINT_H_
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* The host cost report builds the filters with FIXEDPOINT_PROFILE defined to
+ * count the multiplications.
+ */
+#ifdef FIXEDPOINT_PROFILE
+extern unsigned long FixedPoint_MulCount;
+#define FIXEDPOINT_COUNT_MUL()		FixedPoint_MulCount = FixedPoint_MulCount + 1
+#else
+#define FIXEDPOINT_COUNT_MUL()
+#endif
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Shifts a signed value right, rounding towards minus infinity */
+long FixedPoint_Shift(long x, unsigned char shift);
+
+/* Multiplies a sample by a fixed-point coefficient within 32 bits */
+long FixedPoint_Mul(long x, int coefficient, unsigned char fraction);
+
+/* Multiplies with error feedback of the dropped fraction bits */
+long FixedPoint_MulFeedback(long x, int coefficient, unsigned char fraction, unsigned int* error);
+
+#endif /* _FIXEDPOINT_H_ */
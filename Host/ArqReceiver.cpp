@@ -0,0 +1,112 @@
+/***************************************************************************//**
+ *   @file   ArqReceiver.cpp
+ *   @brief  Implementation of the relay side of the selective-repeat ARQ. The
+ *           records are delivered in link sequence order. Records received
+ *           after a gap are held until the gap is filled, or until the implant
+ *           moved so far ahead that it gave up the missing ones.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "ArqReceiver.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the receiver, the implant starts at link sequence 0.
+ *
+ * @param receiver - Receiver to initialize.
+ *
+ * @return None.
+*******************************************************************************/
+void ArqReceiver_Initialize(ArqReceiver& receiver) {
+	receiver.expected = 0;
+	receiver.held.assign(ARQ_WINDOW, std::vector<unsigned char>());
+	receiver.present.assign(ARQ_WINDOW, false);
+	receiver.delivered = 0;
+	receiver.duplicates = 0;
+	receiver.skipped = 0;
+}
+
+/***************************************************************************//**
+ * @brief Delivers the record expected if it is held, or skips it, and moves
+ *        to the next link sequence number.
+ *
+ * @param receiver - Receiver to advance.
+ * @param stream - Stream the record is appended to.
+ *
+ * @return None.
+*******************************************************************************/
+static void ArqReceiver_Advance(ArqReceiver& receiver, std::vector<unsigned char>& stream) {
+	int slot = receiver.expected % ARQ_WINDOW;
+
+	if (receiver.present[slot]) {
+		stream.insert(stream.end(), receiver.held[slot].begin(), receiver.held[slot].end());
+		receiver.present[slot] = false;
+		receiver.delivered = receiver.delivered + 1;
+	} else {
+		receiver.skipped = receiver.skipped + 1;
+	}
+	receiver.expected = receiver.expected + 1;
+}
+
+/***************************************************************************//**
+ * @brief Takes an ARQ record and appends the records now in order to a
+ *        stream. A record ARQ_WINDOW or more ahead of the one expected means
+ *        that the implant gave up the records in between.
+ *
+ * @param receiver - Receiver to update.
+ * @param record - IMPLANT_TAG_ARQ record, its seq is the link sequence number.
+ * @param stream - Stream the records delivered are appended to.
+ *
+ * @return None.
+*******************************************************************************/
+void ArqReceiver_Record(ArqReceiver& receiver, const Record& record, std::vector<unsigned char>& stream) {
+	unsigned char ahead = (unsigned char)(record.seq - receiver.expected);
+	int slot = record.seq % ARQ_WINDOW;
+
+	/* Half the sequence space behind is a copy of a record delivered */
+	if (ahead >= 128) {
+		receiver.duplicates = receiver.duplicates + 1;
+		return;
+	}
+
+	while (ahead >= ARQ_WINDOW) {
+		ArqReceiver_Advance(receiver, stream);
+		ahead = ahead - 1;
+	}
+
+	if (receiver.present[slot]) {
+		receiver.duplicates = receiver.duplicates + 1;
+		return;
+	}
+	receiver.held[slot].assign(record.payload, record.payload + record.length);
+	receiver.present[slot] = true;
+
+	while (receiver.present[receiver.expected % ARQ_WINDOW]) { ArqReceiver_Advance(receiver, stream); }
+}
+
+/***************************************************************************//**
+ * @brief Builds the acknowledgement sent back to the implant: the next link
+ *        sequence number expected and the bitmap of the records held after it.
+ *
+ * @param receiver - Receiver acknowledging.
+ * @param ack - Receives the ARQ_ACK_SIZE bytes of the acknowledgement.
+ *
+ * @return None.
+*******************************************************************************/
+void ArqReceiver_GetAck(const ArqReceiver& receiver, unsigned char* ack) {
+	unsigned int received = 0;
+	int i;
+
+	for (i = 0; i < ARQ_WINDOW - 1; i = i + 1) {
+		if (receiver.present[(receiver.expected + 1 + i) % ARQ_WINDOW]) { received |= 1u << i; }
+	}
+
+	ack[0] = receiver.expected;
+	ack[1] = (unsigned char)(received >> 8);
+	ack[2] = (unsigned char)received;
+}
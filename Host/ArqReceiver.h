@@ -0,0 +1,40 @@
+/***************************************************************************//**
+ *   @file   ArqReceiver.h
+ *   @brief  Header file of the relay side of the selective-repeat ARQ.
+*******************************************************************************/
+#ifndef ARQRECEIVER_H
+#define ARQRECEIVER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <vector>
+
+#include "Record.h"
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Records received ahead of a gap, by link sequence number modulo the window */
+struct ArqReceiver {
+	unsigned char expected;					// next link sequence number to deliver
+	std::vector<std::vector<unsigned char> > held;
+	std::vector<bool> present;
+	unsigned long delivered, duplicates, skipped;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the receiver */
+void ArqReceiver_Initialize(ArqReceiver& receiver);
+
+/* Takes an ARQ record and appends the records now in order to a stream */
+void ArqReceiver_Record(ArqReceiver& receiver, const Record& record, std::vector<unsigned char>& stream);
+
+/* Builds the acknowledgement sent back to the implant */
+void ArqReceiver_GetAck(const ArqReceiver& receiver, unsigned char* ack);
+
+#endif /* ARQRECEIVER_H */
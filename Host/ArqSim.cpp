@@ -0,0 +1,244 @@
+/***************************************************************************//**
+ *   @file   ArqSim.cpp
+ *   @brief  Lossy link simulation of the selective-repeat ARQ. The implant
+ *           sources of the queues and of the ARQ are built here and driven
+ *           as Implant_StreamData and Implant_PumpRadio drive them, one
+ *           FRAME record per frame, with the relay side of ArqReceiver at the
+ *           other end of a link losing records and acknowledgements at
+ *           random.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "../TxQueue.c"
+#include "../Arq.c"
+
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "ArqReceiver.h"
+#include "ArqSim.h"
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Outcome of a run at one loss rate */
+struct ArqSim_Run {
+	unsigned long offered, delivered, dropped;	// FRAME records queued, in order at the relay, dropped by the queue
+	unsigned long linkBytes, usefulBytes;
+	unsigned char maxLatency;					// of the bulk queue, in frames
+	Arq_Stats stats;
+};
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Writes an ARQ record to the radio ring as Implant_WriteArqHeader and
+ *        Implant_PumpRecord write it.
+ *
+ * @param ring - Bytes of the radio ring.
+ * @param seq - Link sequence number.
+ * @param size - Bytes of the record carried.
+ * @param txClass - Queue of the record carried, IMPLANT_PUMP_REPEAT for a
+ *                  copy kept by the ARQ.
+ *
+ * @return None.
+*******************************************************************************/
+static void ArqSim_Write(std::deque<unsigned char>& ring, unsigned char seq, unsigned char size, unsigned char txClass) {
+	unsigned char check, data, i;
+
+	ring.push_back(IMPLANT_RECORD_SYNC);
+	ring.push_back(IMPLANT_TAG_ARQ);
+	ring.push_back(seq);
+	ring.push_back(size);
+	check = TxQueue_Crc8(TxQueue_Crc8(TxQueue_Crc8(0, IMPLANT_TAG_ARQ), seq), size);
+	for (i = 0; i < size; i = i + 1) {
+		if (txClass == ARQSIM_REPEAT) {
+			data = Arq_ReadByte();
+		} else {
+			data = TxQueue_ReadByte(txClass);
+			Arq_StoreByte(data);
+		}
+		check = TxQueue_Crc8(check, data);
+		ring.push_back(data);
+	}
+	ring.push_back(check);
+}
+
+/***************************************************************************//**
+ * @brief Moves whole records to the radio ring in the order of
+ *        Implant_PumpRadio, new records first and repeats in idle slots.
+ *
+ * @param ring - Bytes of the radio ring.
+ *
+ * @return None.
+*******************************************************************************/
+static void ArqSim_Pump(std::deque<unsigned char>& ring) {
+	unsigned char txClass, size, room, bulkRoom, seq;
+	size_t count;
+
+	while (1) {
+		count = ring.size();
+		room = (unsigned char)(ARQSIM_RING_SIZE - 1 - count);
+		bulkRoom = 0;
+		if (count == 0) {
+			bulkRoom = 0xFF;
+		} else if (count < TXQUEUE_BULK_WINDOW) {
+			bulkRoom = (unsigned char)(TXQUEUE_BULK_WINDOW - count);
+		}
+		room = (room > IMPLANT_RECORD_OVERHEAD) ? room - IMPLANT_RECORD_OVERHEAD : 0;
+		if (bulkRoom != 0xFF) { bulkRoom = (bulkRoom > IMPLANT_RECORD_OVERHEAD) ? bulkRoom - IMPLANT_RECORD_OVERHEAD : 0; }
+
+		txClass = TxQueue_Select(room, bulkRoom, &size);
+		if (txClass != TXQUEUE_NONE) {
+			ArqSim_Write(ring, Arq_Begin(size), size, txClass);
+			continue;
+		}
+
+		if ((TxQueue_GetCount(TXQUEUE_URGENT) != 0) || (TxQueue_GetCount(TXQUEUE_BULK) != 0)) { break; }
+		if (!Arq_SelectRepeat((bulkRoom < room) ? bulkRoom : room, &seq, &size)) { break; }
+
+		ArqSim_Write(ring, seq, size, ARQSIM_REPEAT);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Runs the link for ARQSIM_FRAMES frames at one loss rate.
+ *
+ * @param loss - Probability that a record or an acknowledgement is lost.
+ * @param capacity - Link bytes per frame period.
+ * @param ackDelay - Frames before an acknowledgement reaches the implant.
+ * @param run - Receives the outcome.
+ *
+ * @return None.
+*******************************************************************************/
+static void ArqSim_Link(double loss, double capacity, unsigned int ackDelay, ArqSim_Run& run) {
+	std::deque<unsigned char> ring;
+	std::deque<std::vector<unsigned char> > acks;		// acknowledgements on their way, one per frame
+	std::vector<unsigned char> packet, stream;
+	std::vector<unsigned char> ack(ARQ_ACK_SIZE);
+	unsigned char frame[ARQSIM_FRAME_BYTES] = {0};
+	ArqReceiver receiver;
+	TxQueue_Stats queueStats;
+	Record record;
+	size_t offset;
+	double credit = 0.0;
+	unsigned long f, n;
+
+	std::srand(1);
+	TxQueue_Initialize();
+	Arq_Configure(1);
+	ArqReceiver_Initialize(receiver);
+	run.offered = 0;
+	run.dropped = 0;
+	run.linkBytes = 0;
+
+	for (f = 0; f < ARQSIM_FRAMES + ARQSIM_DRAIN; f = f + 1) {
+		/* The implant reads a frame and takes the acknowledgements arrived */
+		frame[0] = (unsigned char)f;
+		if (f >= ARQSIM_FRAMES) {
+			/* Let the last records through */
+		} else if (TxQueue_Put(TXQUEUE_BULK, IMPLANT_TAG_FRAME, (unsigned char)f, frame, ARQSIM_FRAME_BYTES)) {
+			run.offered = run.offered + 1;
+		} else {
+			run.dropped = run.dropped + 1;
+		}
+		while (!acks.empty() && (acks.size() >= ackDelay)) {
+			if (!acks.front().empty()) { Arq_Acknowledge(acks.front()[0], (acks.front()[1] << 8) | acks.front()[2]); }
+			acks.pop_front();
+		}
+		TxQueue_Tick();
+		Arq_Tick();
+		ArqSim_Pump(ring);
+
+		/* The radio sends whole records while the frame period lasts, the
+		 * pump runs again as the ring empties */
+		credit = credit + capacity;
+		while (!ring.empty() && (credit >= IMPLANT_RECORD_OVERHEAD + ring[3])) {
+			n = IMPLANT_RECORD_OVERHEAD + ring[3];
+			packet.assign(ring.begin(), ring.begin() + n);
+			ring.erase(ring.begin(), ring.begin() + n);
+			credit = credit - n;
+			run.linkBytes = run.linkBytes + n;
+
+			if ((double)std::rand() / RAND_MAX >= loss) {
+				offset = 0;
+				Record_Next(packet.data(), packet.size(), offset, record);
+				ArqReceiver_Record(receiver, record, stream);
+			}
+			ArqSim_Pump(ring);
+		}
+		if (ring.empty()) { credit = 0.0; }
+
+		/* The relay acknowledges once per frame period */
+		ArqReceiver_GetAck(receiver, ack.data());
+		acks.push_back(((double)std::rand() / RAND_MAX < loss) ? std::vector<unsigned char>() : ack);
+	}
+
+	/* Count the FRAME records delivered in order */
+	run.delivered = 0;
+	offset = 0;
+	while (Record_Next(stream.data(), stream.size(), offset, record)) {
+		if (record.tag == IMPLANT_TAG_FRAME) { run.delivered = run.delivered + 1; }
+	}
+	run.usefulBytes = run.delivered * (IMPLANT_RECORD_OVERHEAD + ARQSIM_FRAME_BYTES);
+	TxQueue_GetStats(TXQUEUE_BULK, &queueStats);
+	run.maxLatency = queueStats.maxLatency;
+	Arq_GetStats(&run.stats);
+}
+
+/***************************************************************************//**
+ * @brief Prints the goodput, the repeats and the records lost for good
+ *        against the loss rate of the link for every acknowledgement delay up
+ *        to maxDelay, and whether the live frames kept flowing: no record
+ *        dropped by the bulk queue. The limit printed last is the longest
+ *        delay for which, up to ARQSIM_LIMIT_LOSS, fewer than
+ *        ARQSIM_LIMIT_RESIDUAL of the records are lost for good and the
+ *        repeats are those of the losses, not of every record timing out.
+ *
+ * @param capacity - Link bytes per frame period.
+ * @param maxDelay - Longest delay simulated, in frames before an
+ *                   acknowledgement reaches the implant.
+ * @param out - Stream to print to.
+ *
+ * @return Exit code of the tool, 2 if a record was lost without a loss on the
+ *         link or live frames were dropped.
+*******************************************************************************/
+int ArqSim_Report(double capacity, unsigned int maxDelay, FILE* out) {
+	static const double losses[] = {0.0, 0.01, 0.02, 0.05, 0.10, 0.20, 0.30};
+	ArqSim_Run run;
+	unsigned int ackDelay, limit = 0;
+	int result = 0, repaired;
+	size_t l;
+
+	for (ackDelay = 1; ackDelay <= maxDelay; ackDelay = ackDelay + 1) {
+		std::fprintf(out, "%u-byte frames, %.0f link bytes per frame, acknowledged after %u frame(s)\n",
+					 ARQSIM_FRAME_BYTES, capacity, ackDelay);
+		std::fprintf(out, " loss  delivered  lost  repeats  dropped  latency(frames)  goodput\n");
+		repaired = 1;
+		for (l = 0; l < sizeof(losses) / sizeof(losses[0]); l = l + 1) {
+			ArqSim_Link(losses[l], capacity, ackDelay, run);
+			std::fprintf(out, "%4.0f%%  %8.3f%%  %4lu  %7u  %7lu  %15u  %6.1f%%\n", losses[l] * 100.0,
+						 100.0 * run.delivered / run.offered, run.offered - run.delivered,
+						 run.stats.repeated, run.dropped, run.maxLatency,
+						 100.0 * run.usefulBytes / run.linkBytes);
+			if ((run.dropped != 0) || ((losses[l] == 0.0) && (run.delivered != run.offered))) { result = 2; }
+			if ((losses[l] <= ARQSIM_LIMIT_LOSS) &&
+				((run.offered - run.delivered > ARQSIM_LIMIT_RESIDUAL * run.offered) ||
+				 (run.stats.repeated > 2.0 * losses[l] * run.offered + ARQ_WINDOW))) {
+				repaired = 0;
+			}
+		}
+		if (repaired && (limit == ackDelay - 1)) { limit = ackDelay; }
+		std::fprintf(out, "\n");
+	}
+
+	std::fprintf(out, "losses up to %.0f%% repaired by one repeat each with acknowledgements within %u frame(s), "
+				 "window %u records, time-out %u frames\n", ARQSIM_LIMIT_LOSS * 100.0, limit, ARQ_WINDOW, ARQ_TIMEOUT);
+	return result;
+}
@@ -0,0 +1,33 @@
+/***************************************************************************//**
+ *   @file   ArqSim.h
+ *   @brief  Header file of the lossy link simulation of the selective-repeat
+ *           ARQ.
+*******************************************************************************/
+#ifndef ARQSIM_H
+#define ARQSIM_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define ARQSIM_RING_SIZE			160		// CC110L MAX_TX_SIZE
+#define ARQSIM_FRAME_BYTES			54		// two devices, status and 8 channels each
+#define ARQSIM_FRAMES				20000
+#define ARQSIM_REPEAT				TXQUEUE_CLASSES	// copy kept by the ARQ, as IMPLANT_PUMP_REPEAT
+#define ARQSIM_DRAIN				(4 * ARQ_TIMEOUT)	// frames without new records at the end
+#define ARQSIM_LIMIT_LOSS			0.05	// loss rate the delay limit is stated for
+#define ARQSIM_LIMIT_RESIDUAL		0.001	// records lost for good within the limit
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Prints the goodput and the records lost against the loss rate of the link
+ * and the acknowledgement delay */
+int ArqSim_Report(double capacity, unsigned int maxDelay, FILE* out);
+
+#endif /* ARQSIM_H */
@@ -0,0 +1,498 @@
+/***************************************************************************//**
+ *   @file   Exporter.cpp
+ *   @brief  Implementation of the EDF+ and WFDB exporter of the recordings.
+ *           Frames are written as they come: one second of samples is kept
+ *           for the EDF+ data record being filled, the WFDB samples go
+ *           straight to the file, so the memory does not grow with the
+ *           length of the session. The samples are scaled with the gain of
+ *           every channel and VREF. EDF+ samples are 16-bit, so the 8 low
+ *           bits of the 24-bit samples are rounded off there, the WFDB
+ *           signal file keeps all 24 bits (format 24).
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstring>
+
+#include "Exporter.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Gets the gain set in a CHnSET register (ADS1298_CHSET_GAIN_*).
+ *
+ * @param chset - Value of the CHnSET register.
+ *
+ * @return Gain of the PGA, 6 for the reserved code.
+*******************************************************************************/
+double Exporter_Gain(unsigned char chset) {
+	static const double gains[8] = {6.0, 1.0, 2.0, 3.0, 4.0, 8.0, 12.0, 6.0};
+
+	return gains[(chset >> 4) & 0x07];
+}
+
+/***************************************************************************//**
+ * @brief Appends a field of the EDF+ header, padded with spaces.
+ *
+ * @param header - Header being built.
+ * @param text - Content of the field, cut to the width.
+ * @param width - Width of the field.
+ *
+ * @return None.
+*******************************************************************************/
+static void Exporter_Field(std::string& header, const char* text, size_t width) {
+	std::string field(text);
+
+	field.resize(width, ' ');
+	header = header + field;
+}
+
+/***************************************************************************//**
+ * @brief Appends a number to the EDF+ header with the most digits that fit.
+ *
+ * @param header - Header being built.
+ * @param value - Number.
+ * @param width - Width of the field.
+ *
+ * @return None.
+*******************************************************************************/
+static void Exporter_Number(std::string& header, double value, size_t width) {
+	char text[32];
+	int digits;
+
+	for (digits = (int)width; digits > 1; digits = digits - 1) {
+		std::snprintf(text, sizeof(text), "%.*g", digits, value);
+		if (std::strlen(text) <= width) { break; }
+	}
+	Exporter_Field(header, text, width);
+}
+
+/***************************************************************************//**
+ * @brief Gets the microvolts of one 16-bit EDF+ step of a channel, 256 LSB of
+ *        VREF / (gain * 2^23).
+ *
+ * @param exporter - Exporter of the recording.
+ * @param channel - Channel, from 0.
+ *
+ * @return Microvolts per step.
+*******************************************************************************/
+static double Exporter_Step(const Exporter& exporter, unsigned int channel) {
+	return 256.0 * 1.0e6 * exporter.vref / (exporter.gain[channel] * 8388608.0);
+}
+
+/***************************************************************************//**
+ * @brief Writes the EDF+ header, the number of data records is written when
+ *        the file is complete.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param start - Time of the first frame.
+ *
+ * @return true - written, false - write error.
+*******************************************************************************/
+static bool Exporter_WriteHeader(Exporter& exporter, std::time_t start) {
+	static const char* months[12] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+	unsigned int signals = exporter.channels + 1;
+	std::string header;
+	struct tm date = *std::localtime(&start);
+	char text[96];
+	unsigned int c;
+
+	Exporter_Field(header, "0", 8);
+	Exporter_Field(header, "X X X X", 80);
+	std::snprintf(text, sizeof(text), "Startdate %02d-%s-%04d X X ADS1298", date.tm_mday, months[date.tm_mon],
+				  date.tm_year + 1900);
+	Exporter_Field(header, text, 80);
+	std::snprintf(text, sizeof(text), "%02d.%02d.%02d", date.tm_mday, date.tm_mon + 1, date.tm_year % 100);
+	Exporter_Field(header, text, 8);
+	std::snprintf(text, sizeof(text), "%02d.%02d.%02d", date.tm_hour, date.tm_min, date.tm_sec);
+	Exporter_Field(header, text, 8);
+	Exporter_Number(header, 256.0 * (signals + 1), 8);
+	Exporter_Field(header, "EDF+C", 44);
+	Exporter_Field(header, "-1", 8);
+	Exporter_Number(header, (double)exporter.recordSize / exporter.rate, 8);
+	Exporter_Number(header, signals, 4);
+
+	/* Every field for all the signals, then the next field */
+	for (c = 0; c < exporter.channels; c = c + 1) {
+		std::snprintf(text, sizeof(text), "ECG %u", c + 1);
+		Exporter_Field(header, text, 16);
+	}
+	Exporter_Field(header, "EDF Annotations", 16);
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, (c < exporter.channels) ? "AgAgCl electrode" : "", 80); }
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, (c < exporter.channels) ? "uV" : "", 8); }
+	for (c = 0; c < signals; c = c + 1) {
+		Exporter_Number(header, (c < exporter.channels) ? -32768.0 * Exporter_Step(exporter, c) : -1.0, 8);
+	}
+	for (c = 0; c < signals; c = c + 1) {
+		Exporter_Number(header, (c < exporter.channels) ? 32767.0 * Exporter_Step(exporter, c) : 1.0, 8);
+	}
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, "-32768", 8); }
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, "32767", 8); }
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, "", 80); }
+	for (c = 0; c < signals; c = c + 1) { Exporter_Number(header, (c < exporter.channels) ? exporter.recordSize : EXPORT_TAL_SAMPLES, 8); }
+	for (c = 0; c < signals; c = c + 1) { Exporter_Field(header, "", 32); }
+
+	return std::fwrite(header.data(), 1, header.size(), exporter.edf) == header.size();
+}
+
+/***************************************************************************//**
+ * @brief Creates the EDF+ and WFDB files of a recording.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param base - Path of the files without their extension.
+ * @param channels - Channels of the frames.
+ * @param rate - Frames per second.
+ * @param decimation - ADS1298 frames per frame, the beat indexes count them.
+ * @param vref - VREFP in volts, 2.4 or 4 with CONFIG3_VREF4V.
+ * @param chset - CHnSET register of every channel, the last one is repeated
+ *                for the channels after it.
+ * @param start - Time of the first frame.
+ *
+ * @return true - files created, false - files could not be created.
+*******************************************************************************/
+bool Exporter_Create(Exporter& exporter, const char* base, unsigned int channels, unsigned int rate,
+					 unsigned int decimation, double vref, const std::vector<unsigned char>& chset, std::time_t start) {
+	unsigned int c, divider, factor;
+
+	if ((channels == 0) || (channels > EXPORT_MAX_CHANNELS) || (rate == 0) || (decimation == 0)) { return false; }
+
+	exporter.channels = channels;
+	exporter.rate = rate;
+	exporter.decimation = decimation;
+	exporter.vref = vref;
+	exporter.base = base;
+	exporter.gain.resize(channels);
+	for (c = 0; c < channels; c = c + 1) {
+		exporter.gain[c] = Exporter_Gain(chset.empty() ? 0x00 : chset[(c < chset.size()) ? c : chset.size() - 1]);
+	}
+
+	/* A second per data record, or the largest fraction of it in decimal that
+	 * divides the rate and keeps the record within EXPORT_MAX_RECORD */
+	exporter.recordSize = rate;
+	for (divider = 2; divider <= rate; divider = divider + 1) {
+		if ((channels * exporter.recordSize * 2) + (EXPORT_TAL_SAMPLES * 2) <= EXPORT_MAX_RECORD) { break; }
+		for (factor = divider; (factor % 2) == 0; factor = factor / 2) {}
+		for (; (factor % 5) == 0; factor = factor / 5) {}
+		if ((factor == 1) && (rate % divider == 0)) { exporter.recordSize = rate / divider; }
+	}
+	exporter.record.assign((channels * exporter.recordSize * 2) + (EXPORT_TAL_SAMPLES * 2), 0);
+	exporter.frame.resize(channels * 3);
+	exporter.recordFrames = 0;
+	exporter.records = 0;
+	exporter.annotations.clear();
+	exporter.initial.assign(channels, 0);
+	exporter.checksums.assign(channels, 0);
+	exporter.frames = 0;
+	exporter.lastBeat = 0;
+	exporter.layoutFrame = 0;
+	exporter.captureValid = false;
+	exporter.captureNext = 0;
+	exporter.capturePad = 0;
+	exporter.seqValid = false;
+	exporter.beats = 0;
+	exporter.leadOffs = 0;
+	exporter.missing = 0;
+	exporter.dropped = 0;
+
+	exporter.edf = std::fopen((exporter.base + ".edf").c_str(), "wb");
+	exporter.dat = std::fopen((exporter.base + ".dat").c_str(), "wb");
+	exporter.atr = std::fopen((exporter.base + ".atr").c_str(), "wb");
+	if (!exporter.edf || !exporter.dat || !exporter.atr) {
+		if (exporter.edf) { std::fclose(exporter.edf); }
+		if (exporter.dat) { std::fclose(exporter.dat); }
+		if (exporter.atr) { std::fclose(exporter.atr); }
+		return false;
+	}
+	std::setvbuf(exporter.edf, 0, _IOFBF, 1 << 20);
+	std::setvbuf(exporter.dat, 0, _IOFBF, 1 << 20);
+
+	return Exporter_WriteHeader(exporter, start);
+}
+
+/***************************************************************************//**
+ * @brief Writes the EDF+ data record filled, with the annotations whose
+ *        onset is before its end. An annotation that does not fit waits for
+ *        the next record, its onset keeps its time.
+ *
+ * @param exporter - Exporter of the recording.
+ *
+ * @return true - written, false - write error.
+*******************************************************************************/
+static bool Exporter_WriteRecord(Exporter& exporter) {
+	unsigned char* tal = exporter.record.data() + (exporter.channels * exporter.recordSize * 2);
+	uint64_t end = (uint64_t)(exporter.records + 1) * exporter.recordSize;
+	size_t used, length;
+	char text[2 * EXPORT_TAL_SAMPLES];
+	std::deque<ExportAnnotation>::iterator a;
+
+	/* Time-keeping TAL first, the onset of the record is exact in decimal */
+	std::memset(tal, 0, EXPORT_TAL_SAMPLES * 2);
+	used = (size_t)std::snprintf((char*)tal, EXPORT_TAL_SAMPLES * 2, "+%.12g\x14\x14",
+								 (double)exporter.records * exporter.recordSize / exporter.rate) + 1;
+
+	for (a = exporter.annotations.begin(); a != exporter.annotations.end();) {
+		if (a->frame >= end) {
+			a = a + 1;
+			continue;
+		}
+		length = (size_t)std::snprintf(text, sizeof(text), "+%.3f\x14%s\x14", (double)a->frame / exporter.rate,
+									   a->text.c_str()) + 1;
+		if (used + length > EXPORT_TAL_SAMPLES * 2) { break; }
+		std::memcpy(tal + used, text, length);
+		used = used + length;
+		a = exporter.annotations.erase(a);
+	}
+
+	exporter.records = exporter.records + 1;
+	exporter.recordFrames = 0;
+	return std::fwrite(exporter.record.data(), 1, exporter.record.size(), exporter.edf) == exporter.record.size();
+}
+
+/***************************************************************************//**
+ * @brief Adds the next frame to both exports.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param samples - Sample of every channel.
+ *
+ * @return true - frame written, false - write error.
+*******************************************************************************/
+bool Exporter_AddFrame(Exporter& exporter, const int32_t* samples) {
+	unsigned char* sample = exporter.record.data() + (exporter.recordFrames * 2);
+	unsigned int c;
+	int32_t value;
+
+	if (exporter.frames == 0) { exporter.initial.assign(samples, samples + exporter.channels); }
+
+	for (c = 0; c < exporter.channels; c = c + 1) {
+		/* WFDB format 24, little-endian */
+		exporter.frame[(c * 3) + 0] = (unsigned char)samples[c];
+		exporter.frame[(c * 3) + 1] = (unsigned char)(samples[c] >> 8);
+		exporter.frame[(c * 3) + 2] = (unsigned char)(samples[c] >> 16);
+		exporter.checksums[c] = (uint16_t)(exporter.checksums[c] + samples[c]);
+
+		/* EDF+ 16-bit, rounded */
+		value = (samples[c] + 128) >> 8;
+		if (value > 32767) { value = 32767; }
+		sample[0] = (unsigned char)value;
+		sample[1] = (unsigned char)(value >> 8);
+		sample = sample + (exporter.recordSize * 2);
+	}
+	if (std::fwrite(exporter.frame.data(), 1, exporter.frame.size(), exporter.dat) != exporter.frame.size()) { return false; }
+
+	exporter.frames = exporter.frames + 1;
+	exporter.recordFrames = exporter.recordFrames + 1;
+	if (exporter.recordFrames == exporter.recordSize) { return Exporter_WriteRecord(exporter); }
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Writes a beat to the WFDB annotation file, in the MIT format: the
+ *        type in the 6 high bits of a little-endian word, the samples since
+ *        the last annotation in the 10 low bits, or in a SKIP before it.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param frame - Frame of the R peak.
+ *
+ * @return None.
+*******************************************************************************/
+static void Exporter_WriteBeat(Exporter& exporter, uint64_t frame) {
+	uint64_t delta;
+	uint32_t skip;
+	unsigned char bytes[8];
+	size_t size = 0;
+
+	/* The annotations are in time order */
+	if ((exporter.beats > 1) && (frame <= exporter.lastBeat)) { return; }
+	delta = frame - exporter.lastBeat;
+	exporter.lastBeat = frame;
+
+	if (delta > 0x3FF) {
+		skip = (uint32_t)delta;
+		bytes[0] = 0x00;
+		bytes[1] = EXPORT_ATR_SKIP << 2;
+		bytes[2] = (unsigned char)(skip >> 16);		// PDP-11 order, high word first
+		bytes[3] = (unsigned char)(skip >> 24);
+		bytes[4] = (unsigned char)skip;
+		bytes[5] = (unsigned char)(skip >> 8);
+		size = 6;
+		delta = 0;
+	}
+	bytes[size + 0] = (unsigned char)delta;
+	bytes[size + 1] = (unsigned char)((EXPORT_ATR_NORMAL << 2) | (delta >> 8));
+	std::fwrite(bytes, 1, size + 2, exporter.atr);
+}
+
+/***************************************************************************//**
+ * @brief Adds a BEAT, STATUS, LAYOUT, RESTART or TRIGGER record as an
+ *        annotation. The STATUS, LAYOUT and RESTART records are placed by their
+ *        sequence number against the frames added, the beats by their R peak
+ *        index, counted from the last LAYOUT or RESTART record (the implant
+ *        sends a LAYOUT record whenever the stream starts). A captured window
+ *        is placed at the index of its trigger frame: the frames between two
+ *        windows are counted in capturePad, to be written as zeros.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param record - Event record.
+ *
+ * @return None.
+*******************************************************************************/
+void Exporter_AddEvent(Exporter& exporter, const Record& record) {
+	static const char* causes[] = {"?", "command", "beat", "lead-off", "threshold"};
+	ExportAnnotation annotation;
+	const unsigned char* p = record.payload;
+	int64_t frame = (int64_t)exporter.frames;
+	unsigned long index;
+	unsigned int pre, post;
+	uint32_t start;
+	char text[64];
+
+	if (exporter.seqValid) { frame = (int64_t)exporter.frames - 1 + (signed char)(record.seq - exporter.lastSeq); }
+	if (frame < 0) { frame = 0; }
+
+	if ((record.tag == IMPLANT_TAG_BEAT) && (record.length >= 7)) {
+		index = ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+		frame = (int64_t)(exporter.layoutFrame + (index / exporter.decimation));
+		std::snprintf(text, sizeof(text), "QRS%s%s", (p[6] & QRS_FLAG_SEARCHBACK) ? " search back" : "",
+					  (p[6] & QRS_FLAG_IRREGULAR) ? " irregular" : "");
+		exporter.beats = exporter.beats + 1;
+		Exporter_WriteBeat(exporter, (uint64_t)frame);
+	} else if ((record.tag == IMPLANT_TAG_STATUS) && (record.length >= 4)) {
+		if ((p[1] | p[2]) != 0) {
+			std::snprintf(text, sizeof(text), "Lead-off device %u P 0x%02X N 0x%02X", p[0], p[1], p[2]);
+			exporter.leadOffs = exporter.leadOffs + 1;
+		} else {
+			std::snprintf(text, sizeof(text), "Leads on device %u", p[0]);
+		}
+	} else if (record.tag == IMPLANT_TAG_LAYOUT) {
+		exporter.layoutFrame = (uint64_t)frame;
+		std::snprintf(text, sizeof(text), "Channels changed");
+	} else if (record.tag == IMPLANT_TAG_RESTART) {
+		exporter.layoutFrame = (uint64_t)frame;
+		std::snprintf(text, sizeof(text), "Implant restart");
+	} else if ((record.tag == IMPLANT_TAG_TRIGGER) && (record.length >= 9)) {
+		pre = (p[1] << 8) | p[2];
+		post = (p[3] << 8) | p[4];
+		index = ((unsigned long)p[5] << 24) | ((unsigned long)p[6] << 16) | ((unsigned long)p[7] << 8) | (unsigned long)p[8];
+		start = (uint32_t)index + 1 - pre;
+		if (exporter.captureValid && ((int32_t)(start - exporter.captureNext) > 0)) {
+			exporter.capturePad = start - exporter.captureNext;
+		}
+		exporter.captureValid = true;
+		exporter.captureNext = (uint32_t)index + 1 + post;
+		frame = frame + (int64_t)exporter.capturePad + ((pre != 0) ? pre - 1 : 0);
+		std::snprintf(text, sizeof(text), "Capture %s", causes[(p[0] <= CAPTURE_CAUSE_THRESHOLD) ? p[0] : 0]);
+	} else {
+		return;
+	}
+
+	annotation.frame = (uint64_t)frame;
+	annotation.text = text;
+	exporter.annotations.push_back(annotation);
+}
+
+/***************************************************************************//**
+ * @brief Adds the frames and events decoded since the last drain, in stream
+ *        order. The frames are numbered from their sequence numbers, a frame
+ *        lost on the way is written as zeros so the time stays aligned.
+ *
+ * @param exporter - Exporter of the recording.
+ * @param decoder - Decoder flushed, the frames and events are then drained.
+ *
+ * @return true - frames written, false - write error.
+*******************************************************************************/
+bool Exporter_AddFrames(Exporter& exporter, const SampleDecoder& decoder) {
+	int32_t samples[EXPORT_MAX_CHANNELS];
+	int32_t zeros[EXPORT_MAX_CHANNELS] = {0};
+	size_t offset = 0, e = 0, i;
+	unsigned int c;
+	unsigned char delta;
+	Record event;
+	bool pending;
+
+	pending = Record_Next(decoder.events.data(), decoder.events.size(), offset, event);
+	for (i = 0; i < decoder.seqs.size(); i = i + 1) {
+		while (pending && (decoder.eventFrames[e] <= i)) {
+			Exporter_AddEvent(exporter, event);
+			for (; exporter.capturePad != 0; exporter.capturePad = exporter.capturePad - 1) {
+				if (!Exporter_AddFrame(exporter, zeros)) { return false; }
+			}
+			e = e + 1;
+			pending = Record_Next(decoder.events.data(), decoder.events.size(), offset, event);
+		}
+
+		if (exporter.seqValid) {
+			delta = (unsigned char)(decoder.seqs[i] - exporter.lastSeq);
+			if (delta == 0) { continue; }
+			for (; delta > 1; delta = delta - 1) {
+				if (!Exporter_AddFrame(exporter, zeros)) { return false; }
+				exporter.missing = exporter.missing + 1;
+			}
+		}
+		exporter.seqValid = true;
+		exporter.lastSeq = decoder.seqs[i];
+
+		for (c = 0; c < exporter.channels; c = c + 1) { samples[c] = (c < decoder.planes.size()) ? decoder.planes[c][i] : 0; }
+		if (!Exporter_AddFrame(exporter, samples)) { return false; }
+	}
+
+	while (pending) {
+		Exporter_AddEvent(exporter, event);
+		for (; exporter.capturePad != 0; exporter.capturePad = exporter.capturePad - 1) {
+			if (!Exporter_AddFrame(exporter, zeros)) { return false; }
+		}
+		pending = Record_Next(decoder.events.data(), decoder.events.size(), offset, event);
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Completes the files: the last EDF+ data record is padded with
+ *        zeros and the number of records is written in the header, the WFDB
+ *        header is written with the checksums of the signals.
+ *
+ * @param exporter - Exporter of the recording.
+ *
+ * @return true - files complete, false - write error.
+*******************************************************************************/
+bool Exporter_Close(Exporter& exporter) {
+	std::string name = exporter.base.substr(exporter.base.find_last_of('/') + 1);
+	std::string count;
+	unsigned char end[2] = {0, 0};
+	unsigned int c, f;
+	bool written = true;
+	FILE* hea;
+
+	/* Last data record, padded */
+	if (exporter.recordFrames != 0) {
+		for (c = 0; c < exporter.channels; c = c + 1) {
+			for (f = exporter.recordFrames; f < exporter.recordSize; f = f + 1) {
+				exporter.record[(c * exporter.recordSize * 2) + (f * 2) + 0] = 0;
+				exporter.record[(c * exporter.recordSize * 2) + (f * 2) + 1] = 0;
+			}
+		}
+		written = Exporter_WriteRecord(exporter);
+	}
+	exporter.dropped = (unsigned long)exporter.annotations.size();
+
+	Exporter_Number(count, (double)exporter.records, 8);
+	written = written && (std::fseek(exporter.edf, 236, SEEK_SET) == 0) &&
+			  (std::fwrite(count.data(), 1, count.size(), exporter.edf) == count.size());
+	written = (std::fclose(exporter.edf) == 0) && written;
+	written = (std::fclose(exporter.dat) == 0) && written;
+	written = (std::fwrite(end, 1, sizeof(end), exporter.atr) == sizeof(end)) && written;
+	written = (std::fclose(exporter.atr) == 0) && written;
+
+	/* WFDB header: record line, then one line per signal, gain in ADC units per mV */
+	hea = std::fopen((exporter.base + ".hea").c_str(), "w");
+	if (!hea) { return false; }
+	std::fprintf(hea, "%s %u %u %llu\n", name.c_str(), exporter.channels, exporter.rate, (unsigned long long)exporter.frames);
+	for (c = 0; c < exporter.channels; c = c + 1) {
+		std::fprintf(hea, "%s.dat 24 %.4f/mV 24 0 %d %d 0 ECG %u\n", name.c_str(),
+					 exporter.gain[c] * 8388608.0 / (exporter.vref * 1000.0), exporter.initial[c],
+					 (int16_t)exporter.checksums[c], c + 1);
+	}
+	return (std::fclose(hea) == 0) && written;
+}
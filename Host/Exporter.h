@@ -0,0 +1,98 @@
+/***************************************************************************//**
+ *   @file   Exporter.h
+ *   @brief  Header file of the EDF+ and WFDB exporter of the recordings.
+*******************************************************************************/
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Record.h"
+#include "SampleDecoder.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define EXPORT_VREF					2.4		// VREFP without CONFIG3_VREF4V, in volts
+#define EXPORT_TAL_SAMPLES			64		// 2-byte samples of the annotations in an EDF+ data record
+#define EXPORT_MAX_CHANNELS			16
+#define EXPORT_MAX_RECORD			61440	// bytes of an EDF+ data record
+
+/* MIT annotation format of the WFDB .atr file */
+#define EXPORT_ATR_NORMAL			1		// normal beat
+#define EXPORT_ATR_SKIP				59		// time difference in the next 4 bytes
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Event waiting for the EDF+ data record of its onset */
+struct ExportAnnotation {
+	uint64_t frame;
+	std::string text;
+};
+
+/* Exporter of one recording to base.edf, and base.hea, base.dat, base.atr */
+struct Exporter {
+	unsigned int channels;
+	unsigned int rate;						// frames per second
+	unsigned int recordSize;				// frames per EDF+ data record, a second or a fraction of it
+	unsigned int decimation;				// ADS1298 frames per frame, for the beat indexes
+	std::vector<double> gain;				// ADS1298 gain of every channel
+	double vref;
+	std::string base;
+
+	FILE* edf;
+	FILE* dat;
+	FILE* atr;
+	std::vector<unsigned char> record;		// EDF+ data record being filled
+	std::vector<unsigned char> frame;		// WFDB samples of a frame
+	unsigned int recordFrames;
+	unsigned long records;
+	std::deque<ExportAnnotation> annotations;
+
+	std::vector<int32_t> initial;			// first sample of every channel
+	std::vector<uint16_t> checksums;		// 16-bit sum of the samples of every channel
+	uint64_t frames;						// frames written
+	uint64_t lastBeat;						// frame of the last beat in the .atr
+	uint64_t layoutFrame;					// beat indexes count from this frame, set by LAYOUT and RESTART
+	bool captureValid;
+	uint32_t captureNext;					// trigger index of the frame after the last window
+	uint64_t capturePad;					// frames of 0 before the window announced
+	bool seqValid;
+	unsigned char lastSeq;
+	unsigned long beats, leadOffs, missing, dropped;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Gets the gain set in a CHnSET register */
+double Exporter_Gain(unsigned char chset);
+
+/* Creates the EDF+ and WFDB files */
+bool Exporter_Create(Exporter& exporter, const char* base, unsigned int channels, unsigned int rate,
+					 unsigned int decimation, double vref, const std::vector<unsigned char>& chset, std::time_t start);
+
+/* Adds the next frame */
+bool Exporter_AddFrame(Exporter& exporter, const int32_t* samples);
+
+/* Adds the frames and events decoded, numbered from their sequence numbers */
+bool Exporter_AddFrames(Exporter& exporter, const SampleDecoder& decoder);
+
+/* Adds a BEAT, STATUS or LAYOUT record as an annotation */
+void Exporter_AddEvent(Exporter& exporter, const Record& record);
+
+/* Completes the files */
+bool Exporter_Close(Exporter& exporter);
+
+#endif /* EXPORTER_H */
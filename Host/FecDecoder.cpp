@@ -0,0 +1,93 @@
+/***************************************************************************//**
+ *   @file   FecDecoder.cpp
+ *   @brief  Implementation of the decoder of the forward error correction of
+ *           the radio bytes. The codewords of a block are gathered back from
+ *           the bit planes and every codeword is corrected from its syndrome.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "FecDecoder.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the decoder.
+ *
+ * @param decoder - Decoder to initialize.
+ *
+ * @return None.
+*******************************************************************************/
+void FecDecoder_Initialize(FecDecoder& decoder) {
+	decoder.blocks = 0;
+	decoder.codewords = 0;
+	decoder.corrected = 0;
+	decoder.fills = 0;
+}
+
+/***************************************************************************//**
+ * @brief Decodes a Hamming(7,4) codeword, p1 p2 d1 p3 d2 d3 d4 from bit 0.
+ *        The syndrome is the position of the bit in error, 0 if none.
+ *
+ * @param decoder - Decoder counting the corrections.
+ * @param word - Codeword received, 7 bits.
+ *
+ * @return Nibble decoded.
+*******************************************************************************/
+unsigned char FecDecoder_Codeword(FecDecoder& decoder, unsigned char word) {
+	int s1 = ((word >> 0) ^ (word >> 2) ^ (word >> 4) ^ (word >> 6)) & 1;
+	int s2 = ((word >> 1) ^ (word >> 2) ^ (word >> 5) ^ (word >> 6)) & 1;
+	int s3 = ((word >> 3) ^ (word >> 4) ^ (word >> 5) ^ (word >> 6)) & 1;
+	int position = s1 | (s2 << 1) | (s3 << 2);
+
+	decoder.codewords = decoder.codewords + 1;
+	if (position != 0) {
+		word = word ^ (1 << (position - 1));
+		decoder.corrected = decoder.corrected + 1;
+	}
+
+	return ((word >> 2) & 0x01) | ((word >> 3) & 0x0E);
+}
+
+/***************************************************************************//**
+ * @brief Decodes the whole blocks of a coded stream. The FILL bytes are kept
+ *        in the stream, Record_Next skips them between records.
+ *
+ * @param decoder - Decoder to update.
+ * @param data - Coded bytes.
+ * @param size - Number of coded bytes.
+ * @param stream - Stream the bytes decoded are appended to.
+ *
+ * @return Number of coded bytes used, a multiple of FEC_CODED_SIZE.
+*******************************************************************************/
+size_t FecDecoder_Decode(FecDecoder& decoder, const unsigned char* data, size_t size, std::vector<unsigned char>& stream) {
+	const unsigned char* coded;
+	unsigned char word, low = 0, byte;
+	size_t offset;
+	int k, b;
+
+	for (offset = 0; offset + FEC_CODED_SIZE <= size; offset = offset + FEC_CODED_SIZE) {
+		coded = data + offset;
+		for (k = 0; k < 2 * FEC_DATA_SIZE; k = k + 1) {
+			/* Bit b of codeword k is bit k % 8 of the byte of plane b */
+			word = 0;
+			for (b = 0; b < 7; b = b + 1) {
+				word = word | (((coded[(b * 2) + (k >> 3)] >> (k & 7)) & 1) << b);
+			}
+
+			if ((k & 1) == 0) {
+				low = FecDecoder_Codeword(decoder, word);
+				continue;
+			}
+			byte = low | (FecDecoder_Codeword(decoder, word) << 4);
+			if (byte == IMPLANT_TAG_FILL) { decoder.fills = decoder.fills + 1; }
+			stream.push_back(byte);
+		}
+		decoder.blocks = decoder.blocks + 1;
+	}
+
+	return offset;
+}
@@ -0,0 +1,42 @@
+/***************************************************************************//**
+ *   @file   FecDecoder.h
+ *   @brief  Header file of the decoder of the forward error correction of the
+ *           radio bytes.
+*******************************************************************************/
+#ifndef FECDECODER_H
+#define FECDECODER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstddef>
+#include <vector>
+
+#include "../Protocol.h"
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Counters of the blocks decoded */
+struct FecDecoder {
+	unsigned long blocks;
+	unsigned long codewords;
+	unsigned long corrected;		// codewords with a bit flipped back
+	unsigned long fills;			// FILL bytes that completed a block
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the decoder */
+void FecDecoder_Initialize(FecDecoder& decoder);
+
+/* Decodes a Hamming(7,4) codeword, correcting one bit error */
+unsigned char FecDecoder_Codeword(FecDecoder& decoder, unsigned char word);
+
+/* Decodes the whole blocks of a coded stream */
+size_t FecDecoder_Decode(FecDecoder& decoder, const unsigned char* data, size_t size, std::vector<unsigned char>& stream);
+
+#endif /* FECDECODER_H */
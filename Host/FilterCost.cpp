@@ -0,0 +1,64 @@
+/***************************************************************************//**
+ *   @file   FilterCost.cpp
+ *   @brief  Cost report of the implant filter bank. The implant sources are
+ *           built here with the multiplications counted, and one frame is
+ *           filtered for every filter set.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#define FIXEDPOINT_PROFILE
+#define FILTERBANK_CHANNELS			16		// reports up to every channel of the two devices
+#include "../FixedPoint.c"
+#include "../FilterBank.c"
+
+#include "FilterCost.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Prints the multiplications and the estimated PIC18 cycles of the
+ *        filter bank per channel, and whether the channels fit in the frame
+ *        period at the given rate.
+ *
+ * @param rate - Rate of the filtered frames, in SPS, after decimation.
+ * @param mains - Power-line frequency, 50 or 60 Hz.
+ * @param channels - Number of channels streamed.
+ * @param out - Stream to print to.
+ *
+ * @return Exit code of the tool, 2 if the filters do not fit in the budget.
+*******************************************************************************/
+int FilterCost_Report(unsigned int rate, unsigned char mains, int channels, FILE* out) {
+	static const unsigned char sets[] = {FILTERBANK_HIGHPASS, FILTERBANK_NOTCH, FILTERBANK_NOTCH | FILTERBANK_HIGHPASS};
+	static const char* names[] = {"high-pass", "notch", "notch+high-pass"};
+	unsigned char frame[FILTERBANK_CHANNELS * 3] = {0};
+	double budget = FILTERCOST_FCY / (double)rate * FILTERCOST_BUDGET;
+	double muls, cycles;
+	int fit = 1;
+	int s;
+
+	if ((channels < 1) || (channels > FILTERBANK_CHANNELS)) { channels = FILTERBANK_CHANNELS; }
+	if (!FilterBank_Configure(rate, mains, FILTERBANK_NOTCH)) {
+		std::fprintf(stderr, "no coefficients for %u SPS, %u Hz\n", rate, mains);
+		return 1;
+	}
+
+	std::fprintf(out, "%u SPS, %u Hz mains, %d channel(s), %.0f cycles per frame\n", rate, mains, channels, budget);
+	std::fprintf(out, "filters          mul/ch  cycles/ch  cycles/frame  budget  max channels\n");
+	for (s = 0; s < 3; s = s + 1) {
+		FilterBank_Configure(rate, mains, sets[s]);
+		FixedPoint_MulCount = 0;
+		FilterBank_ProcessFrame(frame, (unsigned char)channels);
+
+		muls = (double)FixedPoint_MulCount / (double)channels;
+		cycles = muls * FILTERCOST_CYCLES_MUL + FILTERCOST_CYCLES_CHANNEL;
+		if (cycles * channels > budget) { fit = 0; }
+		std::fprintf(out, "%-15s  %6.0f  %9.0f  %12.0f  %5.0f%%  %12d\n",
+					 names[s], muls, cycles, cycles * channels, 100.0 * cycles * channels / budget,
+					 (int)(budget / cycles));
+	}
+	return fit ? 0 : 2;
+}
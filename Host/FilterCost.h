@@ -0,0 +1,33 @@
+/***************************************************************************//**
+ *   @file   FilterCost.h
+ *   @brief  Header file of the cost report of the implant filter bank.
+*******************************************************************************/
+#ifndef FILTERCOST_H
+#define FILTERCOST_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Approximate PIC18 cycles of the C18 build, to be replaced by profiled
+ * figures. A FixedPoint_Mul is two 32-bit multiplications and a variable
+ * shift, the channel overhead is the 24-bit load, saturation and state moves.
+ */
+#define FILTERCOST_CYCLES_MUL		420
+#define FILTERCOST_CYCLES_CHANNEL	180
+#define FILTERCOST_FCY				4000000.0	// 16 MHz / 4
+#define FILTERCOST_BUDGET			0.5			// share of the frame period left to the filters
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Prints the cost of the filter bank per channel against the frame budget */
+int FilterCost_Report(unsigned int rate, unsigned char mains, int channels, FILE* out);
+
+#endif /* FILTERCOST_H */
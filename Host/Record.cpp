@@ -0,0 +1,148 @@
+/***************************************************************************//**
+ *   @file   Record.cpp
+ *   @brief  Implementation of the reader for the records streamed by the
+ *           implant.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+
+#include "Record.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Reads a whole file into memory.
+ *
+ * @param path - Path of the file to read.
+ * @param data - Vector receiving the content of the file.
+ *
+ * @return true - file read, false - file could not be opened.
+*******************************************************************************/
+bool Record_LoadFile(const char* path, std::vector<unsigned char>& data) {
+	unsigned char chunk[4096];
+	size_t count;
+	FILE* file = std::fopen(path, "rb");
+
+	if (!file) { return false; }
+
+	data.clear();
+	while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		data.insert(data.end(), chunk, chunk + count);
+	}
+	std::fclose(file);
+
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Computes the CRC-8 of the bytes of a record, as TxQueue_Crc8 on the
+ *        implant. The CRC is linear, so 8 bytes are added at once: table k
+ *        holds the CRC of a byte followed by k zero bytes, and the CRC of the
+ *        8 bytes is the sum of their entries. The tables are built on the
+ *        first call.
+ *
+ * @param crc - CRC of the bytes before, 0 at the tag.
+ * @param data - Bytes added.
+ * @param size - Number of bytes.
+ *
+ * @return CRC of the bytes up to the last one added.
+*******************************************************************************/
+unsigned char Record_Crc8(unsigned char crc, const unsigned char* data, size_t size) {
+	static unsigned char tables[RECORD_CRC_SLICES][256];
+	static bool built = false;
+	unsigned int value, bit, k;
+	unsigned char entry;
+	size_t i = 0;
+
+	if (!built) {
+		for (value = 0; value < 256; value = value + 1) {
+			entry = (unsigned char)value;
+			for (bit = 0; bit < 8; bit = bit + 1) {
+				entry = (unsigned char)((entry & 0x80) ? (entry << 1) ^ IMPLANT_RECORD_POLYNOMIAL : entry << 1);
+			}
+			tables[0][value] = entry;
+		}
+		for (k = 1; k < RECORD_CRC_SLICES; k = k + 1) {
+			for (value = 0; value < 256; value = value + 1) { tables[k][value] = tables[0][tables[k - 1][value]]; }
+		}
+		built = true;
+	}
+
+	for (; i + RECORD_CRC_SLICES <= size; i = i + RECORD_CRC_SLICES) {
+		crc = tables[7][crc ^ data[i]] ^ tables[6][data[i + 1]] ^ tables[5][data[i + 2]] ^ tables[4][data[i + 3]] ^
+			  tables[3][data[i + 4]] ^ tables[2][data[i + 5]] ^ tables[1][data[i + 6]] ^ tables[0][data[i + 7]];
+	}
+	for (; i < size; i = i + 1) { crc = tables[0][crc ^ data[i]]; }
+	return crc;
+}
+
+/***************************************************************************//**
+ * @brief Reads the next record of a stream whose check is right. FILL bytes
+ *        between records are skipped. Any other byte is discarded until a
+ *        sync starts a record whose CRC matches, so the reader resynchronizes
+ *        after corrupted or lost bytes.
+ *
+ * @param data - Stream buffer.
+ * @param size - Number of bytes in the stream buffer.
+ * @param offset - Offset of the next record, advanced past the record read.
+ *                 At a truncated record it is left on its sync, so that the
+ *                 record is read again once the rest of the stream is added.
+ *                 A corrupted length within the last record's worth of bytes
+ *                 of a whole stream looks the same, those bytes are not
+ *                 read.
+ * @param record - Record read, its payload points into data.
+ * @param discarded - Incremented by the bytes discarded, may be null.
+ *
+ * @return true - record read, false - end of the stream or truncated record.
+*******************************************************************************/
+bool Record_Next(const unsigned char* data, size_t size, size_t& offset, Record& record,
+				 unsigned long* discarded) {
+	size_t end;
+
+	while (offset < size) {
+		/* FILL bytes complete the FEC blocks between records */
+		if (data[offset] == IMPLANT_TAG_FILL) {
+			offset = offset + 1;
+			continue;
+		}
+		if (data[offset] == IMPLANT_RECORD_SYNC) {
+			if (offset + IMPLANT_RECORD_HEADER > size) { return false; }
+			end = offset + IMPLANT_RECORD_OVERHEAD + data[offset + 3];
+			if (end > size) { return false; }
+			if (Record_Crc8(0, data + offset + 1, end - offset - 2) == data[end - 1]) {
+				record.tag = data[offset + 1];
+				record.seq = data[offset + 2];
+				record.length = data[offset + 3];
+				record.payload = data + offset + IMPLANT_RECORD_HEADER;
+				offset = end;
+				return true;
+			}
+		}
+
+		/* Not the start of a record, try from the next byte */
+		offset = offset + 1;
+		if (discarded) { *discarded = *discarded + 1; }
+	}
+
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief Converts a big-endian 24-bit two's complement sample as sent by the
+ *        ADS1298.
+ *
+ * @param bytes - Pointer to the 3 bytes of the sample, MSB first.
+ *
+ * @return Sign-extended sample.
+*******************************************************************************/
+long Record_Sample24(const unsigned char* bytes) {
+	long sample = ((long)bytes[0] << 16) | ((long)bytes[1] << 8) | (long)bytes[2];
+
+	if (sample & 0x800000L) { sample = sample - 0x1000000L; }
+	return sample;
+}
@@ -0,0 +1,54 @@
+/***************************************************************************//**
+ *   @file   Record.h
+ *   @brief  Header file of the reader for the records streamed by the implant.
+*******************************************************************************/
+#ifndef RECORD_H
+#define RECORD_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstddef>
+#include <vector>
+
+#include "../Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define RECORD_CRC_SLICES			8		// bytes added to the CRC at once
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* One record of the implant stream (see Protocol.h) */
+struct Record {
+	unsigned char tag;
+	unsigned char seq;
+	const unsigned char* payload;	// points into the stream buffer
+	unsigned char length;
+};
+
+/* First and last byte of a record in the stream buffer, sync and check included */
+#define RECORD_BEGIN(record)		((record).payload - IMPLANT_RECORD_HEADER)
+#define RECORD_END(record)			((record).payload + (record).length + IMPLANT_RECORD_CHECK)
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Reads a whole file into memory */
+bool Record_LoadFile(const char* path, std::vector<unsigned char>& data);
+
+/* Computes the CRC-8 of the bytes of a record */
+unsigned char Record_Crc8(unsigned char crc, const unsigned char* data, size_t size);
+
+/* Reads the next record of a stream whose check is right */
+bool Record_Next(const unsigned char* data, size_t size, size_t& offset, Record& record,
+				 unsigned long* discarded = 0);
+
+/* Converts a big-endian 24-bit two's complement sample */
+long Record_Sample24(const unsigned char* bytes);
+
+#endif /* RECORD_H */
@@ -0,0 +1,433 @@
+/***************************************************************************//**
+ *   @file   Recording.cpp
+ *   @brief  Implementation of the chunked recording container of the relay.
+ *           The writer fills one chunk of planar samples at a time and
+ *           appends it, the reader maps the file and hands out spans of the
+ *           chunks without copying them.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Recording.h"
+
+static_assert(sizeof(RecordingHeader) == 64, "RecordingHeader is 64 bytes in the file");
+static_assert(sizeof(RecordingChunk) == 32, "RecordingChunk is 32 bytes in the file");
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Writes a whole buffer at an offset of the file.
+ *
+ * @param file - File descriptor.
+ * @param data - Bytes to write.
+ * @param size - Number of bytes.
+ * @param offset - Offset in the file.
+ *
+ * @return true - written, false - write error.
+*******************************************************************************/
+static bool Recording_Write(int file, const void* data, size_t size, uint64_t offset) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	ssize_t written;
+
+	while (size > 0) {
+		written = pwrite(file, bytes, size, (off_t)offset);
+		if (written <= 0) { return false; }
+		bytes = bytes + written;
+		size = size - (size_t)written;
+		offset = offset + (uint64_t)written;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Creates a recording, an existing file is replaced.
+ *
+ * @param writer - Writer of the recording.
+ * @param path - Path of the file.
+ * @param channels - Sample arrays in a chunk, the channels after them are not
+ *                   recorded.
+ * @param rate - Frames per second.
+ *
+ * @return true - file created, false - file could not be created.
+*******************************************************************************/
+bool Recording_Create(RecordingWriter& writer, const char* path, unsigned int channels, unsigned int rate) {
+	if ((channels == 0) || (channels > RECORDING_MAX_CHANNELS)) { return false; }
+
+	writer.file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (writer.file < 0) { return false; }
+
+	std::memset(&writer.header, 0, sizeof(writer.header));
+	std::memcpy(writer.header.magic, RECORDING_MAGIC, sizeof(writer.header.magic));
+	writer.header.version = RECORDING_VERSION;
+	writer.header.byteOrder = RECORDING_BYTE_ORDER;
+	writer.header.channels = channels;
+	writer.header.chunkFrames = RECORDING_CHUNK_FRAMES;
+	writer.header.chunkSize = sizeof(RecordingChunk) + (channels * RECORDING_CHUNK_FRAMES * sizeof(int32_t));
+	writer.header.rate = rate;
+	writer.header.indexOffset = 0;
+	writer.header.created = (uint64_t)std::time(0);
+
+	writer.end = sizeof(RecordingHeader);
+	writer.index.clear();
+	writer.samples.assign(channels * RECORDING_CHUNK_FRAMES, 0);
+	writer.chunkOpen = false;
+	writer.unindexed = 0;
+	writer.nextFrame = 0;
+	writer.seqValid = false;
+	writer.gapPending = false;
+	writer.statsValid = false;
+	writer.statsUptime = 0;
+	writer.statsFrame = 0;
+	writer.frames = 0;
+	writer.missing = 0;
+	writer.duplicates = 0;
+	writer.discontinuities = 0;
+
+	if (!Recording_Write(writer.file, &writer.header, sizeof(writer.header), 0)) {
+		close(writer.file);
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Writes an index of every chunk appended after the last chunk, then
+ *        points the header to it once it is on the disk.
+ *
+ * @param writer - Writer of the recording.
+ *
+ * @return true - written, false - write error.
+*******************************************************************************/
+static bool Recording_WriteIndex(RecordingWriter& writer) {
+	uint32_t head[2];
+	uint64_t offset = writer.end;
+
+	std::memcpy(&head[0], RECORDING_INDEX_MAGIC, sizeof(head[0]));
+	head[1] = (uint32_t)writer.index.size();
+	if (!Recording_Write(writer.file, head, sizeof(head), offset) ||
+		!Recording_Write(writer.file, writer.index.data(), writer.index.size() * sizeof(uint64_t), offset + sizeof(head)) ||
+		(fdatasync(writer.file) != 0)) { return false; }
+	writer.end = offset + sizeof(head) + (writer.index.size() * sizeof(uint64_t));
+
+	/* One aligned 8-byte write switches the readers to the new index */
+	writer.header.indexOffset = offset;
+	if (!Recording_Write(writer.file, &writer.header.indexOffset, sizeof(writer.header.indexOffset),
+						 offsetof(RecordingHeader, indexOffset)) ||
+		(fdatasync(writer.file) != 0)) { return false; }
+
+	writer.unindexed = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Appends the chunk being filled, and an index every
+ *        RECORDING_INDEX_INTERVAL chunks.
+ *
+ * @param writer - Writer of the recording.
+ *
+ * @return true - written, false - write error.
+*******************************************************************************/
+static bool Recording_WriteChunk(RecordingWriter& writer) {
+	if (!Recording_Write(writer.file, &writer.chunk, sizeof(writer.chunk), writer.end) ||
+		!Recording_Write(writer.file, writer.samples.data(), writer.samples.size() * sizeof(int32_t),
+						 writer.end + sizeof(writer.chunk))) { return false; }
+
+	writer.index.resize(writer.chunk.number + 1, 0);
+	writer.index[writer.chunk.number] = writer.end;
+	writer.end = writer.end + writer.header.chunkSize;
+	writer.chunkOpen = false;
+	writer.unindexed = writer.unindexed + 1;
+
+	if (writer.unindexed >= RECORDING_INDEX_INTERVAL) { return Recording_WriteIndex(writer); }
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Adds frames to the recording. The frame numbers follow the sequence
+ *        numbers, so a frame lost on the way leaves a frame of zeros and the
+ *        time stays aligned. A repeated sequence number is dropped. The first
+ *        frame after a discontinuity is marked in its chunk.
+ *
+ * @param writer - Writer of the recording.
+ * @param planes - Samples of every channel, as left by SampleDecoder.
+ * @param first - First frame of the planes added.
+ * @param seqs - Sequence number of every frame of the planes.
+ * @param counts - Channels of every frame of the planes.
+ * @param count - Number of frames added.
+ *
+ * @return true - frames added, false - write error.
+*******************************************************************************/
+bool Recording_AddFrames(RecordingWriter& writer, const std::vector<std::vector<int32_t> >& planes, size_t first,
+						 const unsigned char* seqs, const unsigned char* counts, size_t count) {
+	size_t channels = writer.header.channels;
+	size_t frames = writer.header.chunkFrames;
+	size_t i, c, position;
+	uint64_t frame;
+	uint32_t number;
+	unsigned char delta;
+
+	if (planes.size() < channels) { channels = planes.size(); }
+
+	for (i = first; i < first + count; i = i + 1) {
+		/* Number the frame from the sequence numbers */
+		frame = writer.nextFrame;
+		if (writer.seqValid) {
+			delta = (unsigned char)(seqs[i] - writer.lastSeq);
+			if (delta == 0) {
+				writer.duplicates = writer.duplicates + 1;
+				continue;
+			}
+			frame = frame + delta - 1;
+			writer.missing = writer.missing + delta - 1;
+		}
+		writer.seqValid = true;
+		writer.lastSeq = seqs[i];
+		writer.nextFrame = frame + 1;
+		writer.frames = writer.frames + 1;
+
+		/* Chunks without any frame are not written */
+		number = (uint32_t)(frame / frames);
+		if (writer.chunkOpen && (number != writer.chunk.number) && !Recording_WriteChunk(writer)) { return false; }
+		if (!writer.chunkOpen) {
+			std::memset(&writer.chunk, 0, sizeof(writer.chunk));
+			std::memcpy(writer.chunk.magic, RECORDING_CHUNK_MAGIC, sizeof(writer.chunk.magic));
+			writer.chunk.number = number;
+			writer.chunk.firstFrame = (uint64_t)number * frames;
+			writer.chunk.firstSeq = seqs[i];
+			writer.chunk.rate = writer.header.rate;
+			writer.chunk.compression = RECORDING_RAW;
+			std::fill(writer.samples.begin(), writer.samples.end(), 0);
+			writer.chunkOpen = true;
+		}
+
+		position = (size_t)(frame - writer.chunk.firstFrame);
+		if (writer.gapPending) {
+			writer.chunk.flags = writer.chunk.flags | RECORDING_CHUNK_DISCONTINUITY;
+			writer.chunk.discontinuity = (uint16_t)position;
+			writer.gapPending = false;
+		}
+		for (c = 0; c < channels; c = c + 1) { writer.samples[(c * frames) + position] = planes[c][i]; }
+		writer.chunk.frames = (uint32_t)(position + 1);
+		writer.chunk.lastSeq = seqs[i];
+		writer.chunk.channelMask = writer.chunk.channelMask | (uint16_t)((1UL << counts[i]) - 1);
+		writer.chunk.channelMask = writer.chunk.channelMask & (uint16_t)((1UL << writer.header.channels) - 1);
+	}
+
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Takes a record found between the frames. The 8-bit sequence numbers
+ *        cannot tell 256 frames lost from none: a RESTART record, or a STATS
+ *        record whose uptime moved further than the frames numbered since the
+ *        previous one, marks a discontinuity before the next frame. The
+ *        uptime counts whole seconds, a second of frames is allowed for it. A
+ *        QUALITY record changes the rate of the frames, the next STATS record
+ *        is only taken as a new reference.
+ *
+ * @param writer - Writer of the recording.
+ * @param record - Record decoded between the frames added.
+ *
+ * @return None.
+*******************************************************************************/
+void Recording_AddEvent(RecordingWriter& writer, const Record& record) {
+	const unsigned char* p = record.payload + STATS_OFFSET_UPTIME;
+	uint32_t uptime;
+	uint64_t elapsed;
+
+	if (record.tag == IMPLANT_TAG_RESTART) {
+		writer.gapPending = true;
+		writer.discontinuities = writer.discontinuities + 1;
+		writer.statsValid = false;
+	} else if (record.tag == IMPLANT_TAG_QUALITY) {
+		writer.statsValid = false;
+	} else if ((record.tag == IMPLANT_TAG_STATS) && (record.length >= STATS_RECORD_SIZE)) {
+		uptime = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+		if (writer.statsValid && (uptime > writer.statsUptime + 1)) {
+			elapsed = (uint64_t)(uptime - writer.statsUptime - 1) * writer.header.rate;
+			if (elapsed > writer.nextFrame - writer.statsFrame + 255) {
+				writer.gapPending = true;
+				writer.discontinuities = writer.discontinuities + 1;
+			}
+		}
+		writer.statsValid = true;
+		writer.statsUptime = uptime;
+		writer.statsFrame = writer.nextFrame;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Writes the last chunk and the index, then closes the file.
+ *
+ * @param writer - Writer of the recording.
+ *
+ * @return true - recording complete, false - write error.
+*******************************************************************************/
+bool Recording_Close(RecordingWriter& writer) {
+	bool written = true;
+
+	if (writer.chunkOpen) { written = Recording_WriteChunk(writer); }
+	if (written && ((writer.unindexed != 0) || (writer.header.indexOffset == 0))) { written = Recording_WriteIndex(writer); }
+
+	return (close(writer.file) == 0) && written;
+}
+
+/***************************************************************************//**
+ * @brief Maps a recording. Only the chunks of the last index written are
+ *        seen, a recording still being written can be read.
+ *
+ * @param reader - Reader of the recording.
+ * @param path - Path of the file.
+ *
+ * @return true - recording mapped, false - not a complete recording.
+*******************************************************************************/
+bool Recording_Open(RecordingReader& reader, const char* path) {
+	struct stat status;
+	const RecordingHeader* header;
+	const uint32_t* head;
+	void* base;
+
+	reader.file = open(path, O_RDONLY);
+	if (reader.file < 0) { return false; }
+	if ((fstat(reader.file, &status) != 0) || ((size_t)status.st_size < sizeof(RecordingHeader))) {
+		close(reader.file);
+		return false;
+	}
+
+	base = mmap(0, (size_t)status.st_size, PROT_READ, MAP_SHARED, reader.file, 0);
+	if (base == MAP_FAILED) {
+		close(reader.file);
+		return false;
+	}
+	reader.base = (const unsigned char*)base;
+	reader.size = (size_t)status.st_size;
+
+	/* Check the header and the index it points to */
+	header = (const RecordingHeader*)reader.base;
+	reader.header = header;
+	if ((std::memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0) ||
+		(header->version == 0) || (header->version > RECORDING_VERSION) || (header->byteOrder != RECORDING_BYTE_ORDER) ||
+		(header->channels == 0) || (header->channels > RECORDING_MAX_CHANNELS) || (header->chunkFrames == 0) ||
+		(header->chunkSize != sizeof(RecordingChunk) + (header->channels * header->chunkFrames * sizeof(int32_t))) ||
+		(header->indexOffset == 0) || (header->indexOffset + (2 * sizeof(uint32_t)) > reader.size)) {
+		Recording_Unmap(reader);
+		return false;
+	}
+
+	head = (const uint32_t*)(reader.base + header->indexOffset);
+	reader.chunks = head[1];
+	reader.index = (const uint64_t*)(head + 2);
+	if ((std::memcmp(&head[0], RECORDING_INDEX_MAGIC, sizeof(head[0])) != 0) ||
+		(header->indexOffset + (2 * sizeof(uint32_t)) + (reader.chunks * sizeof(uint64_t)) > reader.size)) {
+		Recording_Unmap(reader);
+		return false;
+	}
+
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Unmaps a recording, the spans taken from it are no longer valid.
+ *
+ * @param reader - Reader of the recording.
+ *
+ * @return None.
+*******************************************************************************/
+void Recording_Unmap(RecordingReader& reader) {
+	munmap((void*)reader.base, reader.size);
+	close(reader.file);
+	reader.base = 0;
+	reader.size = 0;
+	reader.chunks = 0;
+}
+
+/***************************************************************************//**
+ * @brief Gets the frames of the recording, up to the last frame recorded.
+ *
+ * @param reader - Reader of the recording.
+ *
+ * @return Number of frames.
+*******************************************************************************/
+uint64_t Recording_GetFrames(const RecordingReader& reader) {
+	const RecordingChunk* chunk;
+
+	if (reader.chunks == 0) { return 0; }
+
+	chunk = (const RecordingChunk*)(reader.base + reader.index[reader.chunks - 1]);
+	return chunk->firstFrame + chunk->frames;
+}
+
+/***************************************************************************//**
+ * @brief Gets the frame recorded at a time from the start of the recording.
+ *
+ * @param reader - Reader of the recording.
+ * @param seconds - Time from the first frame.
+ *
+ * @return Frame number.
+*******************************************************************************/
+uint64_t Recording_FrameAt(const RecordingReader& reader, double seconds) {
+	if (seconds <= 0.0) { return 0; }
+	return (uint64_t)(seconds * reader.header->rate);
+}
+
+/***************************************************************************//**
+ * @brief Gets the samples of a channel from a frame on, up to the end of the
+ *        chunk holding the frame. The span points into the mapped file.
+ *
+ * @param reader - Reader of the recording.
+ * @param channel - Channel, from 0.
+ * @param frame - First frame.
+ * @param count - Frames wanted, the span may hold less.
+ * @param span - Receives the samples, no samples for frames not recorded.
+ *
+ * @return true - span found, false - frame after the end of the recording or
+ *         chunk not readable.
+*******************************************************************************/
+bool Recording_GetSpan(const RecordingReader& reader, unsigned int channel, uint64_t frame, size_t count,
+					   RecordingSpan& span) {
+	uint64_t frames = reader.header->chunkFrames;
+	uint64_t number = frame / frames;
+	uint64_t position = frame % frames;
+	uint64_t offset;
+	const RecordingChunk* chunk;
+
+	if ((channel >= reader.header->channels) || (count == 0) || (frame >= Recording_GetFrames(reader))) { return false; }
+
+	span.samples = 0;
+	span.frame = frame;
+	span.count = (size_t)((count < frames - position) ? count : frames - position);
+	span.chunk = 0;
+
+	/* A chunk number without an offset was not recorded */
+	offset = reader.index[number];
+	if (offset == 0) { return true; }
+	if ((offset + reader.header->chunkSize > reader.size) || (offset % sizeof(int32_t) != 0)) { return false; }
+
+	chunk = (const RecordingChunk*)(reader.base + offset);
+	if ((std::memcmp(chunk->magic, RECORDING_CHUNK_MAGIC, sizeof(chunk->magic)) != 0) ||
+		(chunk->number != number) || (chunk->compression != RECORDING_RAW)) { return false; }
+
+	span.chunk = chunk;
+	if (position >= chunk->frames) {
+		span.count = (size_t)(frames - position);
+		if (span.count > count) { span.count = count; }
+		return true;
+	}
+	if (span.count > chunk->frames - position) { span.count = (size_t)(chunk->frames - position); }
+	span.samples = (const int32_t*)(chunk + 1) + (channel * frames) + position;
+
+	return true;
+}
@@ -0,0 +1,156 @@
+/***************************************************************************//**
+ *   @file   Recording.h
+ *   @brief  Header file of the chunked recording container of the relay.
+*******************************************************************************/
+#ifndef RECORDING_H
+#define RECORDING_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "Record.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* File layout, every field in the byte order of the host that wrote it:
+ *   header (64 bytes)
+ *   chunks of chunkSize bytes: chunk header (32 bytes), then chunkFrames
+ *     int32 samples of every channel, one channel after the other
+ *   index: "INDX", chunk count, then the file offset of every chunk number,
+ *     0 for a chunk with no frame recorded
+ * Chunk n holds the frames n * chunkFrames to (n + 1) * chunkFrames - 1, so a
+ * frame is found with one division and one index read. The frames are
+ * numbered from 8-bit sequence numbers, a chunk flagged with
+ * RECORDING_CHUNK_DISCONTINUITY lost more frames before its frame
+ * discontinuity than the numbering tells (implant restart, or more than 255
+ * frames lost as told by the uptime of two STATS records). A new index is
+ * written after the chunks appended, then the header is pointed to it with a
+ * single 8-byte write: a reader always sees a complete index, the previous
+ * ones are left as dead bytes between the chunks.
+ */
+#define RECORDING_MAGIC				"ADS1298R"
+#define RECORDING_VERSION			2		// 1 had no chunk flags, read as none
+#define RECORDING_BYTE_ORDER		0x01020304
+#define RECORDING_CHUNK_MAGIC		"CHNK"
+#define RECORDING_INDEX_MAGIC		"INDX"
+
+#define RECORDING_CHUNK_FRAMES		4096	// 2 s at 2 kSPS
+#define RECORDING_INDEX_INTERVAL	64		// chunks written between two indexes
+#define RECORDING_MAX_CHANNELS		16		// bits of the channel mask
+
+/* Compression of the samples of a chunk */
+#define RECORDING_RAW				0		// planar int32, mapped without a copy
+
+/* Flags of a chunk */
+#define RECORDING_CHUNK_DISCONTINUITY	0x01	// time lost before the frame discontinuity is not known
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Header at the start of the file */
+struct RecordingHeader {
+	char magic[8];				// RECORDING_MAGIC
+	uint32_t version;
+	uint32_t byteOrder;			// RECORDING_BYTE_ORDER
+	uint32_t channels;			// sample arrays in a chunk
+	uint32_t chunkFrames;
+	uint32_t chunkSize;			// bytes of a chunk, header included
+	uint32_t rate;				// frames per second
+	uint64_t indexOffset;		// last complete index, 0 before the first one
+	uint64_t created;			// seconds since 1970
+	uint8_t reserved[16];
+};
+
+/* Header at the start of every chunk */
+struct RecordingChunk {
+	char magic[4];				// RECORDING_CHUNK_MAGIC
+	uint32_t number;
+	uint64_t firstFrame;		// number * chunkFrames
+	uint32_t frames;			// frames recorded, the missing ones read 0
+	uint16_t channelMask;		// channels with samples in the chunk
+	uint8_t firstSeq, lastSeq;	// sequence numbers of the first and last frames recorded
+	uint32_t rate;				// frames per second
+	uint8_t compression;		// RECORDING_RAW
+	uint8_t flags;				// RECORDING_CHUNK_*
+	uint16_t discontinuity;		// position of the frame after the last discontinuity of the chunk
+};
+
+/* Samples of a channel within one chunk, pointing into the mapped file */
+struct RecordingSpan {
+	const int32_t* samples;		// 0 if the chunk was not recorded
+	uint64_t frame;				// first frame of the span
+	size_t count;
+	const RecordingChunk* chunk;
+};
+
+/* Writer appending the frames of a session */
+struct RecordingWriter {
+	int file;
+	RecordingHeader header;
+	uint64_t end;				// offset of the next chunk
+	std::vector<uint64_t> index;
+	std::vector<int32_t> samples;	// chunk being filled
+	RecordingChunk chunk;
+	bool chunkOpen;
+	uint32_t unindexed;			// chunks written after the last index
+	uint64_t nextFrame;			// frame number of the next frame added
+	bool seqValid;
+	unsigned char lastSeq;
+	bool gapPending;			// the next frame follows a discontinuity
+	bool statsValid;
+	uint32_t statsUptime;		// uptime of the last STATS record
+	uint64_t statsFrame;		// nextFrame at the last STATS record
+	unsigned long frames, missing, duplicates, discontinuities;
+};
+
+/* Reader of a mapped file */
+struct RecordingReader {
+	int file;
+	const unsigned char* base;
+	size_t size;
+	const RecordingHeader* header;
+	const uint64_t* index;
+	uint32_t chunks;			// chunk numbers in the index
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Creates a recording */
+bool Recording_Create(RecordingWriter& writer, const char* path, unsigned int channels, unsigned int rate);
+
+/* Adds frames numbered from their sequence numbers */
+bool Recording_AddFrames(RecordingWriter& writer, const std::vector<std::vector<int32_t> >& planes, size_t first,
+						 const unsigned char* seqs, const unsigned char* counts, size_t count);
+
+/* Takes a RESTART, STATS or QUALITY record found between the frames */
+void Recording_AddEvent(RecordingWriter& writer, const Record& record);
+
+/* Writes the last chunk and the index, then closes the file */
+bool Recording_Close(RecordingWriter& writer);
+
+/* Maps a recording */
+bool Recording_Open(RecordingReader& reader, const char* path);
+
+/* Unmaps a recording */
+void Recording_Unmap(RecordingReader& reader);
+
+/* Gets the frames of the recording, the last chunk included */
+uint64_t Recording_GetFrames(const RecordingReader& reader);
+
+/* Gets the frame recorded at a time */
+uint64_t Recording_FrameAt(const RecordingReader& reader, double seconds);
+
+/* Gets the samples of a channel from a frame on, up to the end of its chunk */
+bool Recording_GetSpan(const RecordingReader& reader, unsigned int channel, uint64_t frame, size_t count,
+					   RecordingSpan& span);
+
+#endif /* RECORDING_H */
@@ -0,0 +1,908 @@
+/***************************************************************************//**
+ *   @file   RelayTool.cpp
+ *   @brief  Command line tool for the data recorded from the implant by the
+ *           relay.
+ *
+ *           Build: g++ -std=c++11 -O2 -o RelayTool Host/[A-Z]*.cpp
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <sys/stat.h>
+
+#include "Record.h"
+#include "SkewMonitor.h"
+#include "RiceDecoder.h"
+#include "Unpacker.h"
+#include "FilterCost.h"
+#include "ArqReceiver.h"
+#include "ArqSim.h"
+#include "FecDecoder.h"
+#include "TraceHistogram.h"
+#include "SampleDecoder.h"
+#include "Recording.h"
+#include "Exporter.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define RELAYTOOL_STATS_COUNTERS	6		// 2-byte counters of a STATS record printed as rates
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Prints the usage of the tool.
+ *
+ * @param None.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Usage() {
+	std::fprintf(stderr,
+		"usage: RelayTool <command> <stream> [options]\n"
+		"  skew <stream> [rate] [alert]  inter-device skew from a calibration run\n"
+		"                                rate: data rate in SPS (2000)\n"
+		"                                alert: allowed skew drift in samples (0.5)\n"
+		"  restarts <stream> [timeout]    watchdog restarts and mean recovery time\n"
+		"                                timeout: watchdog time-out in ms (256)\n"
+		"  decode <stream>                 samples of every frame as CSV on stdout\n"
+		"  beats <stream> [rate]          R peaks, RR intervals and heart rate\n"
+		"                                rate: data rate of the ADS1298 in SPS (500)\n"
+		"  captures <stream>              windows captured around the triggers\n"
+		"  envelope <stream>              min,max,mean of every channel per window as CSV\n"
+		"  quality <stream>               steps of the quality ladder and records dropped\n"
+		"  queues <stream>                depth and latency of the urgent and bulk queues\n"
+		"  filtercost <rate> [mains] [channels]\n"
+		"                                cost of the filter bank against the frame period\n"
+		"                                rate: SPS after decimation, mains: 50 or 60 Hz (50)\n"
+		"  arq <stream>                   records of the ARQ in link order, as a stream on stdout\n"
+		"  arqsim <capacity> [delay]      goodput of the ARQ against the loss rate and the ack delay\n"
+		"                                capacity: link bytes per frame, delay: longest ack delay in frames (ARQ_WINDOW)\n"
+		"  fec <stream>                   bytes coded with FEC_HAMMING, decoded as a stream on stdout\n"
+		"  trace <csv>                    latency histogram of every stage from a logic analyzer capture\n"
+		"  profile <stream>               times of the profiler probes dumped by the implant\n"
+		"  stats <stream>                 rates of the statistics queried from the implant as CSV\n"
+		"  bench <frames> [channels] [rate]\n"
+		"                                speed of the 24-bit unpack kernels on a synthetic stream\n"
+		"                                channels: per frame (16), rate: frames/s of the implant (500)\n"
+		"  record <stream> <file> [rate]  frames of a stream into a chunked recording\n"
+		"                                rate: frames/s of the stream (500)\n"
+		"  extract <file> <start> [length]\n"
+		"                                samples of a recording as CSV, times in seconds (1)\n"
+		"  export <stream|file> <base> [rate] [decimation] [vref] [chset,...]\n"
+		"                                stream or recording to base.edf (EDF+) and base.hea/.dat/.atr (WFDB)\n"
+		"                                rate: frames/s (500), decimation: ADS1298 frames per frame (1),\n"
+		"                                vref: volts (2.4), chset: CHnSET of every channel (0x00, gain 6)\n");
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Measures the skew between devices from the calibration records
+ *        streamed by Implant_Calibrate.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if the skew drifted during the run.
+*******************************************************************************/
+static int RelayTool_Skew(int argc, char** argv) {
+	std::vector<unsigned char> data;
+	std::vector<long> samples;
+	SkewMonitor monitor;
+	Record record;
+	size_t offset = 0;
+	double rate = (argc > 1) ? std::atof(argv[1]) : 2000.0;
+	double alert = (argc > 2) ? std::atof(argv[2]) : 0.5;
+	int devices = 0;
+	int d;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if (record.tag != IMPLANT_TAG_CALIBRATION) { continue; }
+
+		/* The first calibration record sets the number of devices */
+		if (devices == 0) {
+			devices = record.length / 3;
+			SkewMonitor_Initialize(monitor, devices, rate, alert);
+			samples.assign(devices, 0);
+		}
+		if (record.length != devices * 3) { continue; }
+
+		for (d = 0; d < devices; d = d + 1) {
+			samples[d] = Record_Sample24(record.payload + (d * 3));
+		}
+		SkewMonitor_AddFrame(monitor, samples.data());
+	}
+
+	if (devices < 2) {
+		std::fprintf(stderr, "no calibration records with 2 devices or more\n");
+		return 1;
+	}
+
+	SkewMonitor_Report(monitor, stdout);
+	return (monitor.alerts != 0) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Lists the restarts of the implant after a watchdog reset and reports
+ *        the mean recovery time. The stall is detected after the watchdog
+ *        time-out, then the implant boots and sends the RESTART record with
+ *        the time it took.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Restarts(int argc, char** argv) {
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	double timeoutMs = (argc > 1) ? std::atof(argv[1]) : 256.0;
+	double bootMs, recoveryMs, totalMs = 0.0;
+	unsigned long frames = 0, restarts = 0;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("   frame  cause  resets  boot(ms)  recovery(ms)\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag == IMPLANT_TAG_FRAME) || (record.tag == IMPLANT_TAG_GAP)) { frames = frames + 1; }
+		if ((record.tag != IMPLANT_TAG_RESTART) || (record.length < 4)) { continue; }
+
+		bootMs = (double)((record.payload[2] << 8) | record.payload[3]) * 2.0e-3; // 2 us ticks
+		recoveryMs = timeoutMs + bootMs;
+		totalMs = totalMs + recoveryMs;
+		restarts = restarts + 1;
+		std::printf("%8lu  %5u  %6u  %8.2f  %12.2f\n",
+					frames, record.payload[0], record.payload[1], bootMs, recoveryMs);
+	}
+
+	if (restarts == 0) {
+		std::printf("no restart in %lu frames\n", frames);
+		return 0;
+	}
+	std::printf("%lu restart(s) in %lu frames, mean recovery %.2f ms\n", restarts, frames, totalMs / (double)restarts);
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Decodes the raw, Rice coded and bit-packed frames of a stream and
+ *        prints the samples as CSV, one line per frame. The reduction of the
+ *        frame bytes is printed on stderr.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Decode(int argc, char** argv) {
+	std::vector<unsigned char> data;
+	std::vector<long> samples;
+	RiceDecoder decoder;
+	Unpacker unpacker;
+	Record record;
+	size_t offset = 0;
+	size_t i;
+	unsigned long discarded = 0;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	RiceDecoder_Initialize(decoder);
+	Unpacker_Initialize(unpacker);
+	while (Record_Next(data.data(), data.size(), offset, record, &discarded)) {
+		if (!RiceDecoder_Record(decoder, record, samples) &&
+			!Unpacker_Record(unpacker, record, samples)) { continue; }
+
+		std::printf("%u", record.seq);
+		for (i = 0; i < samples.size(); i = i + 1) { std::printf(",%ld", samples[i]); }
+		std::printf("\n");
+	}
+
+	if ((decoder.frames + decoder.lost > 0) || (unpacker.frames + unpacker.undecodable == 0)) {
+		std::fprintf(stderr, "%lu frames, %lu undecodable, %lu raw bytes in %lu (%.2fx)\n",
+					 decoder.frames, decoder.lost, decoder.rawBytes, decoder.codedBytes,
+					 decoder.codedBytes ? (double)decoder.rawBytes / (double)decoder.codedBytes : 0.0);
+	}
+	if (unpacker.frames + unpacker.undecodable > 0) {
+		std::fprintf(stderr, "%lu packed frames, %lu undecodable, %lu clipped, %lu lead-off, %lu raw bytes in %lu (%.2fx)\n",
+					 unpacker.frames, unpacker.undecodable, unpacker.clipped, unpacker.leadOff,
+					 unpacker.rawBytes, unpacker.packedBytes,
+					 unpacker.packedBytes ? (double)unpacker.rawBytes / (double)unpacker.packedBytes : 0.0);
+	}
+	if (discarded != 0) { std::fprintf(stderr, "%lu byte(s) discarded to resynchronize\n", discarded); }
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Lists the beats found by the QRS detector of the implant with their
+ *        RR interval and the heart rate, then the mean heart rate.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Beats(int argc, char** argv) {
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	double rate = (argc > 1) ? std::atof(argv[1]) : 500.0;
+	double rrSum = 0.0;
+	unsigned long index, beats = 0, intervals = 0, searchBack = 0, irregular = 0;
+	unsigned int rr;
+	unsigned char flags;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("   time(s)  rr(ms)  bpm  flags\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag != IMPLANT_TAG_BEAT) || (record.length < 7)) { continue; }
+
+		index = ((unsigned long)record.payload[0] << 24) | ((unsigned long)record.payload[1] << 16) |
+				((unsigned long)record.payload[2] << 8) | (unsigned long)record.payload[3];
+		rr = (record.payload[4] << 8) | record.payload[5];
+		flags = record.payload[6];
+		beats = beats + 1;
+		if (flags & QRS_FLAG_SEARCHBACK) { searchBack = searchBack + 1; }
+		if (flags & QRS_FLAG_IRREGULAR) { irregular = irregular + 1; }
+
+		if (rr == 0) {
+			std::printf("%10.3f       -    -  %s%s\n", (double)index / rate,
+						(flags & QRS_FLAG_SEARCHBACK) ? "S" : "", (flags & QRS_FLAG_IRREGULAR) ? "I" : "");
+			continue;
+		}
+		rrSum = rrSum + (double)rr / rate;
+		intervals = intervals + 1;
+		std::printf("%10.3f  %6.0f  %3.0f  %s%s\n", (double)index / rate, 1000.0 * (double)rr / rate,
+					60.0 * rate / (double)rr,
+					(flags & QRS_FLAG_SEARCHBACK) ? "S" : "", (flags & QRS_FLAG_IRREGULAR) ? "I" : "");
+	}
+
+	if (intervals == 0) {
+		std::printf("%lu beat(s), no RR interval\n", beats);
+		return 0;
+	}
+	std::printf("%lu beat(s), %lu found by search back, %lu irregular, mean %.1f bpm\n",
+				beats, searchBack, irregular, 60.0 * (double)intervals / rrSum);
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Lists the windows captured around the triggers, with the index of
+ *        their trigger frame, and checks that all their frames were received.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if a window is incomplete.
+*******************************************************************************/
+static int RelayTool_Captures(int argc, char** argv) {
+	static const char* causes[] = {"?", "command", "beat", "lead-off", "threshold"};
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned int pre = 0, post = 0, received = 0;
+	unsigned long windows = 0, incomplete = 0, index;
+	unsigned char cause;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("  seq  cause      pre  post       index  received\n");
+	while (true) {
+		bool more = Record_Next(data.data(), data.size(), offset, record);
+
+		/* A window ends with its last frame, the next trigger or the stream */
+		if ((windows != 0) && (received < pre + post) &&
+			(!more || (record.tag == IMPLANT_TAG_TRIGGER))) {
+			incomplete = incomplete + 1;
+			std::printf("                                           incomplete, %u frame(s) missing\n", pre + post - received);
+			received = pre + post;
+		}
+		if (!more) { break; }
+
+		if ((record.tag == IMPLANT_TAG_FRAME) && (received < pre + post)) { received = received + 1; }
+		if ((record.tag != IMPLANT_TAG_TRIGGER) || (record.length < 9)) { continue; }
+
+		cause = (record.payload[0] <= CAPTURE_CAUSE_THRESHOLD) ? record.payload[0] : 0;
+		pre = (record.payload[1] << 8) | record.payload[2];
+		post = (record.payload[3] << 8) | record.payload[4];
+		index = ((unsigned long)record.payload[5] << 24) | ((unsigned long)record.payload[6] << 16) |
+				((unsigned long)record.payload[7] << 8) | (unsigned long)record.payload[8];
+		received = 0;
+		windows = windows + 1;
+		std::printf("  %3u  %-9s  %3u  %4u  %10lu\n", record.seq, causes[cause], pre, post, index);
+	}
+
+	std::printf("%lu window(s), %lu incomplete\n", windows, incomplete);
+	return (incomplete != 0) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Prints the envelopes of a stream as CSV, one line per window: the
+ *        sequence number of its first frame, the number of frames, then the
+ *        minimum, maximum and mean of every channel.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Envelope(int argc, char** argv) {
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned long windows = 0, bytes = 0, frames = 0;
+	unsigned char channels;
+	int i;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag != IMPLANT_TAG_ENVELOPE) || (record.length < 2)) { continue; }
+		channels = record.payload[1];
+		if ((record.payload[0] == 0) || (record.length != 2 + (channels * 9))) { continue; }
+
+		/* The record has the sequence number of the last frame of the window */
+		std::printf("%u,%u", (unsigned char)(record.seq - record.payload[0] + 1), record.payload[0]);
+		for (i = 0; i < channels * 3; i = i + 1) {
+			std::printf(",%ld", Record_Sample24(record.payload + 2 + (i * 3)));
+		}
+		std::printf("\n");
+		windows = windows + 1;
+		frames = frames + record.payload[0];
+		bytes = bytes + IMPLANT_RECORD_OVERHEAD + record.length;
+	}
+
+	if (windows != 0) {
+		std::fprintf(stderr, "%lu window(s) of %lu frame(s) in %lu bytes\n", windows, frames, bytes);
+	}
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Lists the steps of the quality ladder taken by the implant and the
+ *        records it dropped when the TX ring was full.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Quality(int argc, char** argv) {
+	static const char* levels[] = {"full", "packed", "decimated", "envelope"};
+	static const char* reasons[] = {"relay", "occupancy", "ack lag", "drop", "calm"};
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned long records = 0, steps = 0;
+	unsigned int dropped = 0;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("  record  seq  level      reason     ring  dropped\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		records = records + 1;
+		if ((record.tag != IMPLANT_TAG_QUALITY) || (record.length < 5)) { continue; }
+		if ((record.payload[0] > QUALITY_ENVELOPE) || (record.payload[1] > QUALITY_REASON_CALM)) { continue; }
+
+		dropped = (record.payload[3] << 8) | record.payload[4];
+		steps = steps + 1;
+		std::printf("%8lu  %3u  %-9s  %-9s  %4u  %7u\n", records, record.seq,
+					levels[record.payload[0]], reasons[record.payload[1]], record.payload[2], dropped);
+	}
+
+	std::printf("%lu step(s) in %lu records, %u record(s) dropped by the implant\n", steps, records, dropped);
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Lists the counters of the transmit queues reported by the implant:
+ *        the maximum depth and latency since the previous report, and the
+ *        records sent and dropped.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if urgent records were dropped.
+*******************************************************************************/
+static int RelayTool_Queues(int argc, char** argv) {
+	static const char* classes[] = {"urgent", "bulk"};
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned int dropped[2] = {0, 0};
+	unsigned char maxLatency[2] = {0, 0};
+	unsigned long reports = 0;
+	const unsigned char* counters;
+	int c;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("  seq  class   depth  latency(frames)  dropped   sent\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag != IMPLANT_TAG_QUEUES) || (record.length < 12)) { continue; }
+		reports = reports + 1;
+
+		for (c = 0; c < 2; c = c + 1) {
+			counters = record.payload + (c * 6);
+			dropped[c] = (counters[2] << 8) | counters[3];
+			if (counters[1] > maxLatency[c]) { maxLatency[c] = counters[1]; }
+			std::printf("  %3u  %-6s  %5u  %15u  %7u  %5u\n", record.seq, classes[c],
+						counters[0], counters[1], dropped[c], (counters[4] << 8) | counters[5]);
+		}
+	}
+
+	std::printf("%lu report(s), max latency urgent %u bulk %u frame(s), dropped urgent %u bulk %u\n",
+				reports, maxLatency[0], maxLatency[1], dropped[0], dropped[1]);
+	return (dropped[0] != 0) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Unwraps the ARQ records of a stream recorded by the relay before the
+ *        reordering, and writes the records delivered in link order to stdout
+ *        so that the other commands can read them. Records sent outside the
+ *        ARQ are copied as they come.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if records were given up by the implant.
+*******************************************************************************/
+static int RelayTool_Arq(int argc, char** argv) {
+	std::vector<unsigned char> data, stream;
+	ArqReceiver receiver;
+	Record record;
+	size_t offset = 0;
+	unsigned long discarded = 0;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	ArqReceiver_Initialize(receiver);
+	while (Record_Next(data.data(), data.size(), offset, record, &discarded)) {
+		if (record.tag == IMPLANT_TAG_ARQ) {
+			ArqReceiver_Record(receiver, record, stream);
+		} else {
+			stream.insert(stream.end(), RECORD_BEGIN(record), RECORD_END(record));
+		}
+	}
+	std::fwrite(stream.data(), 1, stream.size(), stdout);
+
+	std::fprintf(stderr, "%lu record(s) delivered, %lu duplicate(s), %lu given up, %lu byte(s) discarded\n",
+				 receiver.delivered, receiver.duplicates, receiver.skipped, discarded);
+	return (receiver.skipped != 0) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Decodes the bytes received with the FEC_HAMMING radio profile and
+ *        writes the stream to stdout so that the other commands can read it.
+ *        The codewords corrected tell how noisy the link was.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if the stream ends inside a block.
+*******************************************************************************/
+static int RelayTool_Fec(int argc, char** argv) {
+	std::vector<unsigned char> data, stream;
+	FecDecoder decoder;
+	size_t used;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	FecDecoder_Initialize(decoder);
+	used = FecDecoder_Decode(decoder, data.data(), data.size(), stream);
+	std::fwrite(stream.data(), 1, stream.size(), stdout);
+
+	std::fprintf(stderr, "%lu block(s), %lu of %lu codeword(s) corrected (%.3f%%), %lu fill byte(s), air time x%.2f\n",
+				 decoder.blocks, decoder.corrected, decoder.codewords,
+				 (decoder.codewords != 0) ? 100.0 * decoder.corrected / decoder.codewords : 0.0, decoder.fills,
+				 (stream.size() > decoder.fills) ? (double)used / (stream.size() - decoder.fills) : 0.0);
+	if (used != data.size()) {
+		std::fprintf(stderr, "%lu byte(s) left after the last block\n", (unsigned long)(data.size() - used));
+		return 2;
+	}
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Prints the latency histogram of every stage traced by a firmware
+ *        built with LOGICANALYZER_TRACING, from the CSV exported by the logic
+ *        analyzer.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if end markers had no start marker.
+*******************************************************************************/
+static int RelayTool_Trace(int argc, char** argv) {
+	TraceHistogram histogram;
+	unsigned long orphans = 0;
+	int s;
+
+	TraceHistogram_Initialize(histogram);
+	if ((argc < 1) || !TraceHistogram_LoadCsv(histogram, argv[0])) { return RelayTool_Usage(); }
+
+	TraceHistogram_Report(histogram, stdout);
+	for (s = 0; s < TRACE_STAGES; s = s + 1) { orphans = orphans + histogram.stages[s].orphans; }
+	return (orphans != 0) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Prints the times of the profiler probes dumped by a firmware built
+ *        with PROFILER_ENABLE, with the log2 histogram of every probe.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Profile(int argc, char** argv) {
+	static const char* probes[PROFILER_PROBES] = {"comm-read", "read-frame", "tx-write", "decimator",
+												  "filters", "detector", "encoder", "isr"};
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned long dumps = 0;
+	unsigned int field[4];
+	double tickUs;
+	int i, b;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("  seq  probe       count    min(us)   mean(us)    max(us)  histogram (2^b ticks, b from 0)\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag != IMPLANT_TAG_PROFILE) || (record.length < PROFILER_RECORD_SIZE) ||
+			(record.payload[0] >= PROFILER_PROBES)) { continue; }
+		dumps = dumps + 1;
+
+		tickUs = ((record.payload[1] << 8) | record.payload[2]) / 1000.0;
+		for (i = 0; i < 4; i = i + 1) { field[i] = (record.payload[3 + (i * 2)] << 8) | record.payload[4 + (i * 2)]; }
+		std::printf("  %3u  %-10s  %5u  %9.2f  %9.2f  %9.2f ", record.seq, probes[record.payload[0]], field[0],
+					field[1] * tickUs, field[3] * tickUs, field[2] * tickUs);
+		for (b = 0; b < PROFILER_BUCKETS; b = b + 1) { std::printf(" %u", record.payload[11 + b]); }
+		std::printf("\n");
+	}
+
+	std::printf("%lu probe record(s)\n", dumps);
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Reads a field of a STATS record, MSB first.
+ *
+ * @param payload - Payload of the record.
+ * @param offset - STATS_OFFSET_* of the field.
+ * @param size - Bytes of the field.
+ *
+ * @return Value of the field.
+*******************************************************************************/
+static unsigned long RelayTool_StatsField(const unsigned char* payload, int offset, int size) {
+	unsigned long value = 0;
+	int i;
+
+	for (i = 0; i < size; i = i + 1) { value = (value << 8) | payload[offset + i]; }
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief Prints the rates of the counters between two STATS records as CSV,
+ *        one line per query, for plotting. The counters wrap around, their
+ *        differences are taken modulo their size.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if DRDY was missed or headers were out of
+ *         sync.
+*******************************************************************************/
+static int RelayTool_Stats(int argc, char** argv) {
+	static const int offsets[RELAYTOOL_STATS_COUNTERS] = {STATS_OFFSET_DRDY_MISSES, STATS_OFFSET_HEADER_ERRORS,
+														  STATS_OFFSET_TX_OVERWRITES, STATS_OFFSET_RC_ERRORS,
+														  STATS_OFFSET_RETRANSMITS, STATS_OFFSET_ARQ_REJECTS};
+	std::vector<unsigned char> data;
+	Record record;
+	size_t offset = 0;
+	unsigned long queries = 0, frames = 0, uptime = 0, seconds;
+	unsigned long counter[RELAYTOOL_STATS_COUNTERS] = {0}, total[RELAYTOOL_STATS_COUNTERS] = {0};
+	unsigned long value, delta;
+	unsigned int maxRecovery = 0;
+	int i;
+
+	if ((argc < 1) || !Record_LoadFile(argv[0], data)) { return RelayTool_Usage(); }
+
+	std::printf("uptime,frames/s,drdy_misses/s,header_errors/s,tx_overwrites/s,rc_errors/s,retransmits/s,"
+				"arq_rejects/s,tx_high_water,mode,encoding,quality,max_recovery,state_mismatches\n");
+	while (Record_Next(data.data(), data.size(), offset, record)) {
+		if ((record.tag != IMPLANT_TAG_STATS) || (record.length < STATS_RECORD_SIZE)) { continue; }
+
+		/* The first query, or one after a reset, only sets the reference */
+		value = RelayTool_StatsField(record.payload, STATS_OFFSET_UPTIME, 4);
+		seconds = value - uptime;
+		if ((queries == 0) || (value < uptime)) { seconds = 0; }
+		uptime = value;
+		queries = queries + 1;
+
+		value = RelayTool_StatsField(record.payload, STATS_OFFSET_FRAMES, 4);
+		delta = (value - frames) & 0xFFFFFFFFUL;
+		frames = value;
+		std::printf("%lu,", uptime);
+		if (seconds != 0) { std::printf("%.1f", (double)delta / seconds); }
+
+		for (i = 0; i < RELAYTOOL_STATS_COUNTERS; i = i + 1) {
+			value = RelayTool_StatsField(record.payload, offsets[i], 2);
+			delta = (value - counter[i]) & 0xFFFF;
+			counter[i] = value;
+			std::printf(",");
+			if (seconds == 0) { continue; }
+			total[i] = total[i] + delta;
+			std::printf("%.2f", (double)delta / seconds);
+		}
+		std::printf(",%u,%u,%u,%u,%u,%u\n", record.payload[STATS_OFFSET_TX_HIGH_WATER], record.payload[STATS_OFFSET_MODE],
+					record.payload[STATS_OFFSET_ENCODING], record.payload[STATS_OFFSET_QUALITY],
+					record.payload[STATS_OFFSET_MAX_RECOVERY], record.payload[STATS_OFFSET_STATE_MISMATCHES]);
+		if (record.payload[STATS_OFFSET_MAX_RECOVERY] > maxRecovery) { maxRecovery = record.payload[STATS_OFFSET_MAX_RECOVERY]; }
+	}
+
+	std::fprintf(stderr, "%lu STATS record(s), %lu DRDY miss(es), %lu header error(s), %lu TX overwrite(s), "
+				 "%lu RC error(s), %lu retransmit(s), %lu ARQ reject(s), longest recovery %u frame(s)\n", queries, total[0],
+				 total[1], total[2], total[3], total[4], total[5], maxRecovery);
+	return ((total[0] != 0) || (total[1] != 0)) ? 2 : 0;
+}
+
+/***************************************************************************//**
+ * @brief Decodes a stream and writes its frames to a recording. The stream is
+ *        read a chunk at a time, so its size is not bounded by the memory.
+ *        The records marking a discontinuity are taken between the frames
+ *        they came with.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if the recording could not be written.
+*******************************************************************************/
+static int RelayTool_Record(int argc, char** argv) {
+	std::vector<unsigned char> chunk(SAMPLEDECODER_CHUNK);
+	SampleDecoder decoder;
+	RecordingWriter writer;
+	Record event;
+	bool created = false, written = true, pending;
+	size_t count, offset, first, e, last;
+	FILE* file;
+
+	if (argc < 2) { return RelayTool_Usage(); }
+	file = std::fopen(argv[0], "rb");
+	if (!file) { return RelayTool_Usage(); }
+
+	SampleDecoder_Initialize(decoder, SAMPLEDECODER_BEST);
+	do {
+		count = std::fread(chunk.data(), 1, chunk.size(), file);
+		SampleDecoder_Feed(decoder, chunk.data(), count);
+		SampleDecoder_Flush(decoder);
+		if (decoder.seqs.empty()) { continue; }
+
+		/* The channels of the first frames set the size of the chunks */
+		if (!created) {
+			created = Recording_Create(writer, argv[1], (unsigned int)decoder.planes.size(),
+									   (argc > 2) ? (unsigned int)std::atoi(argv[2]) : 500);
+			if (!created) { break; }
+		}
+		offset = 0;
+		first = 0;
+		pending = Record_Next(decoder.events.data(), decoder.events.size(), offset, event);
+		for (e = 0; written && pending; e = e + 1) {
+			last = (decoder.eventFrames[e] < decoder.seqs.size()) ? decoder.eventFrames[e] : decoder.seqs.size();
+			written = Recording_AddFrames(writer, decoder.planes, first, decoder.seqs.data(), decoder.counts.data(),
+										  last - first);
+			first = last;
+			Recording_AddEvent(writer, event);
+			pending = Record_Next(decoder.events.data(), decoder.events.size(), offset, event);
+		}
+		written = written && Recording_AddFrames(writer, decoder.planes, first, decoder.seqs.data(),
+												 decoder.counts.data(), decoder.seqs.size() - first);
+		SampleDecoder_Drain(decoder);
+	} while (written && (count == chunk.size()));
+	std::fclose(file);
+
+	if (!created) {
+		std::fprintf(stderr, "no frame in %s\n", argv[0]);
+		return 2;
+	}
+	written = Recording_Close(writer) && written;
+	std::fprintf(stderr, "%lu frames, %lu missing, %lu repeated, %lu discontinuit(ies), %zu chunk(s) of %u channels, "
+				 "%lu byte(s) discarded\n", writer.frames, writer.missing, writer.duplicates, writer.discontinuities,
+				 writer.index.size(), writer.header.channels, decoder.discarded);
+	return written ? 0 : 2;
+}
+
+/***************************************************************************//**
+ * @brief Prints the samples of a time range of a recording as CSV, one line
+ *        per frame recorded, read from the spans of the mapped file.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool.
+*******************************************************************************/
+static int RelayTool_Extract(int argc, char** argv) {
+	RecordingReader reader;
+	RecordingSpan spans[RECORDING_MAX_CHANNELS];
+	uint64_t frame, end;
+	unsigned int channels, c;
+	size_t i;
+
+	if ((argc < 2) || !Recording_Open(reader, argv[0])) { return RelayTool_Usage(); }
+
+	channels = reader.header->channels;
+	frame = Recording_FrameAt(reader, std::atof(argv[1]));
+	end = frame + Recording_FrameAt(reader, (argc > 2) ? std::atof(argv[2]) : 1.0);
+	if (end > Recording_GetFrames(reader)) { end = Recording_GetFrames(reader); }
+
+	/* Every channel of a chunk has the same span */
+	while (frame < end) {
+		for (c = 0; c < channels; c = c + 1) {
+			if (!Recording_GetSpan(reader, c, frame, (size_t)(end - frame), spans[c])) { break; }
+		}
+		if (c < channels) { break; }
+
+		for (i = 0; (spans[0].samples != 0) && (i < spans[0].count); i = i + 1) {
+			std::printf("%llu", (unsigned long long)(frame + i));
+			for (c = 0; c < channels; c = c + 1) { std::printf(",%d", spans[c].samples[i]); }
+			std::printf("\n");
+		}
+		frame = frame + spans[0].count;
+	}
+
+	Recording_Unmap(reader);
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Exports the frames of a recording to EDF+ and WFDB, a chunk of spans
+ *        at a time. The recording holds no events, so there is no annotation.
+ *
+ * @param reader - Recording mapped.
+ * @param exporter - Exporter created.
+ *
+ * @return true - frames written, false - write error.
+*******************************************************************************/
+static bool RelayTool_ExportRecording(const RecordingReader& reader, Exporter& exporter) {
+	RecordingSpan spans[RECORDING_MAX_CHANNELS];
+	int32_t samples[RECORDING_MAX_CHANNELS];
+	uint64_t frame = 0, end = Recording_GetFrames(reader);
+	unsigned int channels = reader.header->channels, c;
+	size_t i;
+
+	while (frame < end) {
+		for (c = 0; c < channels; c = c + 1) {
+			if (!Recording_GetSpan(reader, c, frame, (size_t)(end - frame), spans[c])) { return false; }
+		}
+
+		/* A chunk not recorded is written as zeros, so the time stays aligned */
+		for (i = 0; i < spans[0].count; i = i + 1) {
+			for (c = 0; c < channels; c = c + 1) { samples[c] = (spans[c].samples != 0) ? spans[c].samples[i] : 0; }
+			if (!Exporter_AddFrame(exporter, samples)) { return false; }
+		}
+		frame = frame + spans[0].count;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Exports a stream or a recording to EDF+ and WFDB. A stream is read a
+ *        chunk at a time, its beats and lead-off changes become annotations.
+ *        The gains are not in the stream, they are given as the CHnSET
+ *        registers written to the ADS1298.
+ *
+ * @param argc - Number of arguments after the command.
+ * @param argv - Arguments after the command.
+ *
+ * @return Exit code of the tool, 2 if the files could not be written.
+*******************************************************************************/
+static int RelayTool_Export(int argc, char** argv) {
+	std::vector<unsigned char> chunk(SAMPLEDECODER_CHUNK);
+	std::vector<unsigned char> chset;
+	SampleDecoder decoder;
+	RecordingReader reader;
+	Exporter exporter;
+	unsigned int rate = (argc > 2) ? (unsigned int)std::atoi(argv[2]) : 500;
+	unsigned int decimation = (argc > 3) ? (unsigned int)std::atoi(argv[3]) : 1;
+	double vref = (argc > 4) ? std::atof(argv[4]) : EXPORT_VREF;
+	bool created = false, written = true;
+	const char* text;
+	char* next;
+	struct stat status;
+	size_t count;
+	FILE* file;
+
+	if (argc < 2) { return RelayTool_Usage(); }
+	for (text = (argc > 5) ? argv[5] : ""; *text != '\0'; text = (*next == ',') ? next + 1 : next) {
+		chset.push_back((unsigned char)std::strtoul(text, &next, 0));
+		if (next == text) { return RelayTool_Usage(); }
+	}
+
+	if (Recording_Open(reader, argv[0])) {
+		created = Exporter_Create(exporter, argv[1], reader.header->channels, reader.header->rate, decimation, vref,
+								  chset, (std::time_t)reader.header->created);
+		written = created && RelayTool_ExportRecording(reader, exporter);
+		Recording_Unmap(reader);
+	} else {
+		file = std::fopen(argv[0], "rb");
+		if (!file || (fstat(fileno(file), &status) != 0)) { return RelayTool_Usage(); }
+
+		/* Flushed after every chunk, so the events fall between the frames they came with */
+		SampleDecoder_Initialize(decoder, SAMPLEDECODER_BEST);
+		do {
+			count = std::fread(chunk.data(), 1, chunk.size(), file);
+			SampleDecoder_Feed(decoder, chunk.data(), count);
+			SampleDecoder_Flush(decoder);
+			if (decoder.seqs.empty()) { continue; }
+
+			/* The channels of the first frames set the signals of the files */
+			if (!created) {
+				created = Exporter_Create(exporter, argv[1], (unsigned int)decoder.planes.size(), rate, decimation, vref,
+										  chset, status.st_mtime);
+				if (!created) { break; }
+			}
+			written = Exporter_AddFrames(exporter, decoder);
+			SampleDecoder_Drain(decoder);
+		} while (written && (count == chunk.size()));
+		std::fclose(file);
+	}
+
+	if (!created) {
+		std::fprintf(stderr, "no frame in %s, or %s not created\n", argv[0], argv[1]);
+		return 2;
+	}
+	written = Exporter_Close(exporter) && written;
+	std::fprintf(stderr, "%llu frames, %lu missing, %lu EDF+ record(s), %lu beat(s), %lu lead-off event(s), "
+				 "%lu annotation(s) dropped\n", (unsigned long long)exporter.frames, exporter.missing, exporter.records,
+				 exporter.beats, exporter.leadOffs, exporter.dropped);
+	return written ? 0 : 2;
+}
+
+/***************************************************************************//**
+ * @brief Entry point of the tool.
+*******************************************************************************/
+int main(int argc, char** argv) {
+	if (argc < 3) { return RelayTool_Usage(); }
+
+	if (std::strcmp(argv[1], "skew") == 0) { return RelayTool_Skew(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "restarts") == 0) { return RelayTool_Restarts(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "decode") == 0) { return RelayTool_Decode(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "beats") == 0) { return RelayTool_Beats(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "captures") == 0) { return RelayTool_Captures(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "envelope") == 0) { return RelayTool_Envelope(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "quality") == 0) { return RelayTool_Quality(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "queues") == 0) { return RelayTool_Queues(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "filtercost") == 0) {
+		return FilterCost_Report((unsigned int)std::atoi(argv[2]), (argc > 3) ? (unsigned char)std::atoi(argv[3]) : 50,
+								 (argc > 4) ? std::atoi(argv[4]) : 0, stdout);
+	}
+
+	if (std::strcmp(argv[1], "arq") == 0) { return RelayTool_Arq(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "fec") == 0) { return RelayTool_Fec(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "trace") == 0) { return RelayTool_Trace(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "profile") == 0) { return RelayTool_Profile(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "stats") == 0) { return RelayTool_Stats(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "record") == 0) { return RelayTool_Record(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "extract") == 0) { return RelayTool_Extract(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "export") == 0) { return RelayTool_Export(argc - 2, argv + 2); }
+	if (std::strcmp(argv[1], "bench") == 0) {
+		return SampleDecoder_Benchmark(std::strtoul(argv[2], 0, 10), (argc > 3) ? (unsigned int)std::atoi(argv[3]) : 16,
+									   (argc > 4) ? std::atof(argv[4]) : 500.0, stdout);
+	}
+	if (std::strcmp(argv[1], "arqsim") == 0) {
+		return ArqSim_Report(std::atof(argv[2]), (argc > 3) ? (unsigned int)std::atoi(argv[3]) : ARQ_WINDOW, stdout);
+	}
+
+	return RelayTool_Usage();
+}
@@ -0,0 +1,162 @@
+/***************************************************************************//**
+ *   @file   RiceDecoder.cpp
+ *   @brief  Implementation of the decoder of the Rice coded frames. It mirrors
+ *           RiceCoder.c step by step, see Protocol.h for the format.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "RiceDecoder.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the decoder.
+ *
+ * @param decoder - Decoder to initialize.
+ *
+ * @return None.
+*******************************************************************************/
+void RiceDecoder_Initialize(RiceDecoder& decoder) {
+	decoder.channels.clear();
+	decoder.primed = false;
+	decoder.seqValid = false;
+	decoder.nextSeq = 0;
+	decoder.frames = 0;
+	decoder.lost = 0;
+	decoder.rawBytes = 0;
+	decoder.codedBytes = 0;
+}
+
+/***************************************************************************//**
+ * @brief Reads bits MSB first from a record payload. Reading past the end
+ *        returns zeros, which the caller detects with the bit position.
+ *
+ * @param data - Coded bits.
+ * @param size - Number of bytes of coded bits.
+ * @param bit - Position of the next bit, advanced past the bits read.
+ * @param count - Number of bits to read, up to 32.
+ *
+ * @return Bits read, right aligned.
+*******************************************************************************/
+static unsigned long RiceDecoder_GetBits(const unsigned char* data, size_t size, size_t& bit, unsigned count) {
+	unsigned long value = 0;
+	unsigned i;
+
+	for (i = 0; i < count; i = i + 1) {
+		value = value << 1;
+		if ((bit >> 3) < size) { value = value | ((data[bit >> 3] >> (7 - (bit & 7))) & 1); }
+		bit = bit + 1;
+	}
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief Decodes the samples of a record. FRAME records restart the
+ *        predictor, RICE records are decoded against it. A lost frame record
+ *        or a GAP, LAYOUT or RESTART record stops the decoding until the next
+ *        FRAME record.
+ *
+ * @param decoder - Decoder of the stream.
+ * @param record - Record read from the stream.
+ * @param samples - Sign-extended samples of every channel of the frame.
+ *
+ * @return true - samples decoded, false - not a frame or not decodable.
+*******************************************************************************/
+bool RiceDecoder_Record(RiceDecoder& decoder, const Record& record, std::vector<long>& samples) {
+	const unsigned char* data;
+	size_t size, bit = 0;
+	unsigned channelCount, i, k;
+	unsigned long u, q;
+	long residual;
+
+	if ((record.tag == IMPLANT_TAG_LAYOUT) || (record.tag == IMPLANT_TAG_RESTART)) {
+		decoder.primed = false;
+		decoder.seqValid = false;
+		return false;
+	}
+	if ((record.tag != IMPLANT_TAG_FRAME) && (record.tag != IMPLANT_TAG_RICE) && (record.tag != IMPLANT_TAG_GAP)) {
+		return false;
+	}
+
+	/* A missing frame record breaks the prediction */
+	if (decoder.seqValid && (record.seq != decoder.nextSeq)) { decoder.primed = false; }
+	decoder.nextSeq = (unsigned char)(record.seq + 1);
+	decoder.seqValid = true;
+
+	if (record.tag == IMPLANT_TAG_GAP) {
+		decoder.primed = false;
+		return false;
+	}
+
+	/* Raw frame, restart the predictor */
+	if (record.tag == IMPLANT_TAG_FRAME) {
+		channelCount = record.length / 3;
+		samples.resize(channelCount);
+		decoder.channels.resize(channelCount);
+		for (i = 0; i < channelCount; i = i + 1) {
+			samples[i] = Record_Sample24(record.payload + (i * 3));
+			decoder.channels[i].x1 = samples[i];
+			decoder.channels[i].x2 = samples[i];
+			decoder.channels[i].sum = RICE_SUM_INIT;
+			decoder.channels[i].count = 1;
+		}
+		decoder.primed = true;
+		decoder.frames = decoder.frames + 1;
+		decoder.rawBytes = decoder.rawBytes + record.length;
+		decoder.codedBytes = decoder.codedBytes + record.length;
+		return true;
+	}
+
+	/* Rice coded frame */
+	if ((record.length < 1) || !decoder.primed || (record.payload[0] != decoder.channels.size())) {
+		decoder.lost = decoder.lost + 1;
+		return false;
+	}
+	channelCount = record.payload[0];
+	data = record.payload + 1;
+	size = record.length - 1;
+	samples.resize(channelCount);
+
+	for (i = 0; i < channelCount; i = i + 1) {
+		RiceChannel& ch = decoder.channels[i];
+
+		for (k = 0; (k < RICE_MAX_K) && (((unsigned long)ch.count << k) < ch.sum); k = k + 1);
+
+		/* Unary quotient, then the k low bits, or an escape */
+		for (q = 0; (q < RICE_QMAX) && RiceDecoder_GetBits(data, size, bit, 1); q = q + 1);
+		if (q < RICE_QMAX) {
+			u = (q << k) | RiceDecoder_GetBits(data, size, bit, k);
+		} else {
+			u = RiceDecoder_GetBits(data, size, bit, RICE_RAW_BITS);
+		}
+
+		/* Unfold the residual and add the prediction */
+		residual = (u & 1) ? -(long)((u + 1) >> 1) : (long)(u >> 1);
+		samples[i] = residual + ((ch.x1 * 2) - ch.x2);
+
+		ch.sum = (ch.sum + u) & 0xFFFFFFFFUL;	// 32-bit on the PIC
+		ch.count = ch.count + 1;
+		if (ch.count == RICE_RESET) {
+			ch.sum = ch.sum >> 1;
+			ch.count = ch.count >> 1;
+		}
+		ch.x2 = ch.x1;
+		ch.x1 = samples[i];
+	}
+
+	/* Truncated record */
+	if (bit > size * 8) {
+		decoder.primed = false;
+		decoder.lost = decoder.lost + 1;
+		return false;
+	}
+
+	decoder.frames = decoder.frames + 1;
+	decoder.rawBytes = decoder.rawBytes + (channelCount * 3);
+	decoder.codedBytes = decoder.codedBytes + record.length;
+	return true;
+}
@@ -0,0 +1,46 @@
+/***************************************************************************//**
+ *   @file   RiceDecoder.h
+ *   @brief  Header file of the decoder of the Rice coded frames.
+*******************************************************************************/
+#ifndef RICEDECODER_H
+#define RICEDECODER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <vector>
+
+#include "Record.h"
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Prediction and Rice parameter state of a channel, as kept by RiceCoder.c */
+struct RiceChannel {
+	long x1, x2;
+	unsigned long sum;
+	unsigned count;
+};
+
+/* Decoder of the frame records of one stream */
+struct RiceDecoder {
+	std::vector<RiceChannel> channels;
+	bool primed;				// a FRAME record was seen since the last loss
+	bool seqValid;
+	unsigned char nextSeq;		// sequence number of the next frame record
+	unsigned long frames, lost;	// frames decoded, RICE records dropped while unprimed
+	unsigned long rawBytes, codedBytes;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the decoder */
+void RiceDecoder_Initialize(RiceDecoder& decoder);
+
+/* Decodes the samples of a record */
+bool RiceDecoder_Record(RiceDecoder& decoder, const Record& record, std::vector<long>& samples);
+
+#endif /* RICEDECODER_H */
@@ -0,0 +1,508 @@
+/***************************************************************************//**
+ *   @file   SampleDecoder.cpp
+ *   @brief  Implementation of the bulk decoder of the samples of a stream.
+ *           The payloads of consecutive FRAME records are batched and their
+ *           big-endian 24-bit samples are unpacked with byte shuffles, 4 or 8
+ *           samples at a time, then spread to one array per channel. The
+ *           RICE and PACKED records go through RiceDecoder and Unpacker.
+ *           The kernel is chosen at run time, so one build runs everywhere.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "SampleDecoder.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SAMPLEDECODER_X86			1
+#define SAMPLEDECODER_TARGET(isa)	__attribute__((target(isa)))
+#else
+#define SAMPLEDECODER_X86			0
+#endif
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+#if SAMPLEDECODER_X86
+/***************************************************************************//**
+ * @brief Unpacks 4 samples per step: the shuffle puts the 3 bytes of every
+ *        sample in the upper 3 bytes of a 32-bit lane, LSB first, and the
+ *        arithmetic shift sign-extends them. Every step loads 16 bytes, the
+ *        last samples are left to the caller.
+ *
+ * @param bytes - Samples, 3 bytes each, MSB first.
+ * @param count - Number of samples.
+ * @param samples - Receives the sign-extended samples.
+ *
+ * @return Number of samples unpacked.
+*******************************************************************************/
+SAMPLEDECODER_TARGET("ssse3")
+static size_t SampleDecoder_Unpack24Ssse3(const unsigned char* bytes, size_t count, int32_t* samples) {
+	const __m128i order = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+	__m128i v;
+	size_t k;
+
+	for (k = 0; k + 6 <= count; k = k + 4) {
+		v = _mm_loadu_si128((const __m128i*)(bytes + (k * 3)));
+		v = _mm_srai_epi32(_mm_shuffle_epi8(v, order), 8);
+		_mm_storeu_si128((__m128i*)(samples + k), v);
+	}
+	return k;
+}
+
+/***************************************************************************//**
+ * @brief Unpacks 8 samples per step, the shuffle works within the 128-bit
+ *        lanes so each lane is loaded with the 12 bytes of 4 samples.
+ *
+ * @param bytes - Samples, 3 bytes each, MSB first.
+ * @param count - Number of samples.
+ * @param samples - Receives the sign-extended samples.
+ *
+ * @return Number of samples unpacked.
+*******************************************************************************/
+SAMPLEDECODER_TARGET("avx2")
+static size_t SampleDecoder_Unpack24Avx2(const unsigned char* bytes, size_t count, int32_t* samples) {
+	const __m256i order = _mm256_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+										   -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+	__m256i v;
+	size_t k;
+
+	for (k = 0; k + 10 <= count; k = k + 8) {
+		v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(bytes + (k * 3))));
+		v = _mm256_inserti128_si256(v, _mm_loadu_si128((const __m128i*)(bytes + (k * 3) + 12)), 1);
+		v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, order), 8);
+		_mm256_storeu_si256((__m256i*)(samples + k), v);
+	}
+	return k;
+}
+
+/***************************************************************************//**
+ * @brief Scales 4 samples per step.
+ *
+ * @param samples - Samples to scale.
+ * @param count - Number of samples.
+ * @param scale - Value of one LSB.
+ * @param values - Receives the scaled samples.
+ *
+ * @return Number of samples scaled.
+*******************************************************************************/
+SAMPLEDECODER_TARGET("sse2")
+static size_t SampleDecoder_ToFloatSse2(const int32_t* samples, size_t count, float scale, float* values) {
+	const __m128 factor = _mm_set1_ps(scale);
+	size_t k;
+
+	for (k = 0; k + 4 <= count; k = k + 4) {
+		_mm_storeu_ps(values + k, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(samples + k))), factor));
+	}
+	return k;
+}
+
+/***************************************************************************//**
+ * @brief Scales 8 samples per step.
+ *
+ * @param samples - Samples to scale.
+ * @param count - Number of samples.
+ * @param scale - Value of one LSB.
+ * @param values - Receives the scaled samples.
+ *
+ * @return Number of samples scaled.
+*******************************************************************************/
+SAMPLEDECODER_TARGET("avx2")
+static size_t SampleDecoder_ToFloatAvx2(const int32_t* samples, size_t count, float scale, float* values) {
+	const __m256 factor = _mm256_set1_ps(scale);
+	size_t k;
+
+	for (k = 0; k + 8 <= count; k = k + 8) {
+		_mm256_storeu_ps(values + k,
+						 _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(samples + k))), factor));
+	}
+	return k;
+}
+#endif
+
+/***************************************************************************//**
+ * @brief Tells whether the CPU runs a kernel.
+ *
+ * @param path - SAMPLEDECODER_* kernel.
+ *
+ * @return true - kernel supported, false - kernel not supported.
+*******************************************************************************/
+bool SampleDecoder_IsSupported(int path) {
+	if (path == SAMPLEDECODER_SCALAR) { return true; }
+#if SAMPLEDECODER_X86
+	__builtin_cpu_init();
+	if (path == SAMPLEDECODER_SSSE3) { return __builtin_cpu_supports("ssse3") != 0; }
+	if (path == SAMPLEDECODER_AVX2) { return __builtin_cpu_supports("avx2") != 0; }
+#endif
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief Initializes the decoder.
+ *
+ * @param decoder - Decoder to initialize.
+ * @param path - SAMPLEDECODER_* kernel, SAMPLEDECODER_BEST for the fastest
+ *               one the CPU runs. An unsupported kernel falls back to the
+ *               scalar code.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_Initialize(SampleDecoder& decoder, int path) {
+	if (path == SAMPLEDECODER_BEST) {
+		path = SampleDecoder_IsSupported(SAMPLEDECODER_AVX2) ? SAMPLEDECODER_AVX2 : SAMPLEDECODER_SSSE3;
+	}
+	decoder.path = SampleDecoder_IsSupported(path) ? path : SAMPLEDECODER_SCALAR;
+
+	decoder.channelCount = 0;
+	decoder.batchFrames = 0;
+	decoder.batch.clear();
+	decoder.batchSeqs.clear();
+	decoder.interleaved.clear();
+	decoder.carry.clear();
+	decoder.key.clear();
+	decoder.samples.clear();
+	decoder.planes.clear();
+	decoder.seqs.clear();
+	decoder.counts.clear();
+	decoder.events.clear();
+	decoder.eventFrames.clear();
+	RiceDecoder_Initialize(decoder.rice);
+	Unpacker_Initialize(decoder.unpacker);
+
+	decoder.frames = 0;
+	decoder.gaps = 0;
+	decoder.rejected = 0;
+	decoder.discarded = 0;
+	decoder.bytes = 0;
+}
+
+/***************************************************************************//**
+ * @brief Unpacks big-endian 24-bit two's complement samples, as sent by the
+ *        ADS1298.
+ *
+ * @param bytes - Samples, 3 bytes each, MSB first.
+ * @param count - Number of samples.
+ * @param samples - Receives the sign-extended samples.
+ * @param path - SAMPLEDECODER_* kernel, supported by the CPU.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_Unpack24(const unsigned char* bytes, size_t count, int32_t* samples, int path) {
+	size_t k = 0;
+
+#if SAMPLEDECODER_X86
+	if (path == SAMPLEDECODER_AVX2) { k = SampleDecoder_Unpack24Avx2(bytes, count, samples); }
+	if (path != SAMPLEDECODER_SCALAR) { k = k + SampleDecoder_Unpack24Ssse3(bytes + (k * 3), count - k, samples + k); }
+#else
+	(void)path;
+#endif
+
+	/* Left-aligned in 32 bits, the arithmetic shift sign-extends */
+	for (; k < count; k = k + 1) {
+		samples[k] = (int32_t)(((uint32_t)bytes[(k * 3) + 0] << 24) | ((uint32_t)bytes[(k * 3) + 1] << 16) |
+							   ((uint32_t)bytes[(k * 3) + 2] << 8)) >> 8;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Scales samples to floats, in volts with the LSB of the gain set.
+ *
+ * @param samples - Samples to scale.
+ * @param count - Number of samples.
+ * @param scale - Value of one LSB.
+ * @param values - Receives the scaled samples.
+ * @param path - SAMPLEDECODER_* kernel, supported by the CPU.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_ToFloat(const int32_t* samples, size_t count, float scale, float* values, int path) {
+	size_t k = 0;
+
+#if SAMPLEDECODER_X86
+	if (path == SAMPLEDECODER_AVX2) { k = SampleDecoder_ToFloatAvx2(samples, count, scale, values); }
+	if (path != SAMPLEDECODER_SCALAR) { k = k + SampleDecoder_ToFloatSse2(samples + k, count - k, scale, values + k); }
+#else
+	(void)path;
+#endif
+
+	for (; k < count; k = k + 1) { values[k] = (float)samples[k] * scale; }
+}
+
+/***************************************************************************//**
+ * @brief Adds frames to the end of the channel arrays. A channel missing
+ *        from the frames, or from the frames before, reads 0.
+ *
+ * @param decoder - Decoder of the stream.
+ * @param channels - Channels of the frames.
+ * @param count - Number of frames.
+ *
+ * @return Index of the first frame added.
+*******************************************************************************/
+static size_t SampleDecoder_Grow(SampleDecoder& decoder, size_t channels, size_t count) {
+	size_t base = decoder.planes.empty() ? 0 : decoder.planes[0].size();
+	size_t c;
+
+	if (decoder.planes.size() < channels) { decoder.planes.resize(channels, std::vector<int32_t>(base, 0)); }
+	for (c = 0; c < decoder.planes.size(); c = c + 1) { decoder.planes[c].resize(base + count, 0); }
+	decoder.frames = decoder.frames + count;
+
+	return base;
+}
+
+/***************************************************************************//**
+ * @brief Unpacks the frames batched and spreads their samples to the channel
+ *        arrays.
+ *
+ * @param decoder - Decoder of the stream.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_Flush(SampleDecoder& decoder) {
+	size_t channels = decoder.channelCount;
+	size_t count = decoder.batchFrames;
+	size_t base, c, f;
+	const int32_t* source;
+	int32_t* plane;
+
+	if (count == 0) { return; }
+
+	decoder.interleaved.resize(count * channels);
+	SampleDecoder_Unpack24(decoder.batch.data(), count * channels, decoder.interleaved.data(), decoder.path);
+
+	base = SampleDecoder_Grow(decoder, channels, count);
+	for (c = 0; c < channels; c = c + 1) {
+		plane = decoder.planes[c].data() + base;
+		source = decoder.interleaved.data() + c;
+		for (f = 0; f < count; f = f + 1) { plane[f] = source[f * channels]; }
+	}
+
+	decoder.seqs.insert(decoder.seqs.end(), decoder.batchSeqs.begin(), decoder.batchSeqs.end());
+	decoder.counts.insert(decoder.counts.end(), count, (unsigned char)channels);
+
+	decoder.batch.clear();
+	decoder.batchSeqs.clear();
+	decoder.batchFrames = 0;
+}
+
+/***************************************************************************//**
+ * @brief Empties the channel arrays once their samples are used, keeping
+ *        their memory for the next chunks. A long recording is decoded a
+ *        chunk at a time.
+ *
+ * @param decoder - Decoder of the stream.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_Drain(SampleDecoder& decoder) {
+	size_t c;
+
+	for (c = 0; c < decoder.planes.size(); c = c + 1) { decoder.planes[c].clear(); }
+	decoder.seqs.clear();
+	decoder.counts.clear();
+	decoder.events.clear();
+	decoder.eventFrames.clear();
+}
+
+/***************************************************************************//**
+ * @brief Decodes a record. FRAME records are batched, the Rice decoder only
+ *        gets the last one before a RICE record, which is the one its
+ *        prediction starts from.
+ *
+ * @param decoder - Decoder of the stream.
+ * @param record - Record read from the stream.
+ *
+ * @return None.
+*******************************************************************************/
+static void SampleDecoder_Record(SampleDecoder& decoder, const Record& record) {
+	Record key;
+	size_t channels, base, c;
+
+	if (record.tag == IMPLANT_TAG_FRAME) {
+		channels = record.length / 3;
+		if ((record.length % 3 != 0) || (channels == 0) || (channels > SAMPLEDECODER_MAX_CHANNELS)) {
+			decoder.rejected = decoder.rejected + 1;
+			return;
+		}
+		if ((channels != decoder.channelCount) || (decoder.batchFrames == SAMPLEDECODER_BATCH)) {
+			SampleDecoder_Flush(decoder);
+		}
+		decoder.channelCount = channels;
+		decoder.batch.insert(decoder.batch.end(), record.payload, record.payload + record.length);
+		decoder.batchFrames = decoder.batchFrames + 1;
+		decoder.batchSeqs.push_back(record.seq);
+		decoder.key.assign(RECORD_BEGIN(record), RECORD_END(record));
+		return;
+	}
+
+	/* Events are kept with their place among the frames */
+	if ((record.tag == IMPLANT_TAG_BEAT) || (record.tag == IMPLANT_TAG_STATUS) || (record.tag == IMPLANT_TAG_LAYOUT) ||
+		(record.tag == IMPLANT_TAG_TRIGGER) || (record.tag == IMPLANT_TAG_RESTART) || (record.tag == IMPLANT_TAG_STATS) ||
+		(record.tag == IMPLANT_TAG_QUALITY)) {
+		decoder.eventFrames.push_back((decoder.planes.empty() ? 0 : decoder.planes[0].size()) + decoder.batchFrames);
+		decoder.events.insert(decoder.events.end(), RECORD_BEGIN(record), RECORD_END(record));
+	}
+
+	if (record.tag == IMPLANT_TAG_GAP) { decoder.gaps = decoder.gaps + 1; }
+	if ((record.tag == IMPLANT_TAG_GAP) || (record.tag == IMPLANT_TAG_LAYOUT) || (record.tag == IMPLANT_TAG_RESTART)) {
+		decoder.key.clear();
+	}
+
+	if ((record.tag == IMPLANT_TAG_RICE) && !decoder.key.empty()) {
+		key.tag = decoder.key[1];
+		key.seq = decoder.key[2];
+		key.length = decoder.key[3];
+		key.payload = decoder.key.data() + IMPLANT_RECORD_HEADER;
+		RiceDecoder_Record(decoder.rice, key, decoder.samples);
+		decoder.key.clear();
+	}
+
+	if (!RiceDecoder_Record(decoder.rice, record, decoder.samples) &&
+		!Unpacker_Record(decoder.unpacker, record, decoder.samples)) { return; }
+
+	/* Keep the frames in stream order */
+	SampleDecoder_Flush(decoder);
+	decoder.seqs.push_back(record.seq);
+	decoder.counts.push_back((unsigned char)decoder.samples.size());
+	base = SampleDecoder_Grow(decoder, decoder.samples.size(), 1);
+	for (c = 0; c < decoder.samples.size(); c = c + 1) { decoder.planes[c][base] = (int32_t)decoder.samples[c]; }
+}
+
+/***************************************************************************//**
+ * @brief Decodes the records of a chunk of the stream. A record cut at the
+ *        end of the chunk is decoded with the next chunk. Records whose CRC
+ *        is wrong are discarded byte by byte until the next good record, a
+ *        FRAME record whose length is not a whole number of samples is
+ *        rejected.
+ *
+ * @param decoder - Decoder of the stream.
+ * @param data - Bytes of the stream.
+ * @param size - Number of bytes.
+ *
+ * @return None.
+*******************************************************************************/
+void SampleDecoder_Feed(SampleDecoder& decoder, const unsigned char* data, size_t size) {
+	const unsigned char* buffer = data;
+	size_t length = size;
+	size_t offset = 0;
+	Record record;
+
+	if (!decoder.carry.empty()) {
+		decoder.carry.insert(decoder.carry.end(), data, data + size);
+		buffer = decoder.carry.data();
+		length = decoder.carry.size();
+	}
+	decoder.bytes = decoder.bytes + size;
+
+	while (Record_Next(buffer, length, offset, record, &decoder.discarded)) { SampleDecoder_Record(decoder, record); }
+
+	std::vector<unsigned char> rest(buffer + offset, buffer + length);
+	decoder.carry.swap(rest);
+}
+
+/***************************************************************************//**
+ * @brief Prints the decoding speed of every kernel on a synthetic stream of
+ *        FRAME records, as implant-hours decoded per minute, and checks the
+ *        samples against the scalar code.
+ *
+ * @param frames - Number of frames in the stream.
+ * @param channels - Channels of a frame.
+ * @param rate - Frames per second of the implant.
+ * @param out - Stream to print to.
+ *
+ * @return Exit code of the tool, 2 if a kernel decoded other samples.
+*******************************************************************************/
+int SampleDecoder_Benchmark(unsigned long frames, unsigned int channels, double rate, FILE* out) {
+	static const char* names[] = {"scalar", "ssse3", "avx2"};
+	std::vector<unsigned char> stream, packed;
+	std::vector<int32_t> samples, reference;
+	SampleDecoder decoder;
+	std::chrono::steady_clock::time_point start;
+	double unpackTime, streamTime, seconds, scalarTime = 0.0;
+	size_t count = (size_t)frames * channels;
+	size_t chunk;
+	unsigned long f;
+	unsigned int c;
+	int path, run, result = 0;
+
+	if ((channels == 0) || (channels > SAMPLEDECODER_MAX_CHANNELS) || (frames == 0)) { return 1; }
+
+	/* Samples of every channel, and the FRAME records carrying them */
+	std::srand(1);
+	reference.resize(count);
+	packed.reserve(count * 3);
+	stream.reserve(frames * (IMPLANT_RECORD_OVERHEAD + (channels * 3)));
+	for (f = 0; f < frames; f = f + 1) {
+		stream.push_back(IMPLANT_RECORD_SYNC);
+		stream.push_back(IMPLANT_TAG_FRAME);
+		stream.push_back((unsigned char)f);
+		stream.push_back((unsigned char)(channels * 3));
+		for (c = 0; c < channels; c = c + 1) {
+			reference[(c * frames) + f] = (std::rand() & 0xFFFFFF) - 0x800000;
+			packed.push_back((unsigned char)(reference[(c * frames) + f] >> 16));
+			packed.push_back((unsigned char)(reference[(c * frames) + f] >> 8));
+			packed.push_back((unsigned char)reference[(c * frames) + f]);
+		}
+		stream.insert(stream.end(), packed.end() - (channels * 3), packed.end());
+		stream.push_back(Record_Crc8(0, &stream[stream.size() - 3 - (channels * 3)], 3 + (channels * 3)));
+	}
+	samples.resize(count);
+
+	std::fprintf(out, "%lu frames of %u channels, %.1f MB, %.1f implant-hours at %.0f frames/s\n",
+				 frames, channels, stream.size() / 1.0e6, frames / rate / 3600.0, rate);
+	std::fprintf(out, "kernel  unpack(MB/s)  stream(MB/s)  implant-hours/min  speedup\n");
+	for (path = SAMPLEDECODER_SCALAR; path <= SAMPLEDECODER_AVX2; path = path + 1) {
+		if (!SampleDecoder_IsSupported(path)) {
+			std::fprintf(out, "%-6s  not supported by the CPU\n", names[path]);
+			continue;
+		}
+
+		/* Whole stream at once to check the samples */
+		SampleDecoder_Initialize(decoder, path);
+		SampleDecoder_Feed(decoder, stream.data(), stream.size());
+		SampleDecoder_Flush(decoder);
+		for (c = 0; c < channels; c = c + 1) {
+			if ((decoder.planes.size() != channels) || (decoder.planes[c].size() != frames) ||
+				(std::memcmp(decoder.planes[c].data(), reference.data() + (c * frames), frames * sizeof(int32_t)) != 0)) {
+				result = 2;
+				std::fprintf(out, "%-6s  channel %u decoded other samples\n", names[path], c + 1);
+				break;
+			}
+		}
+
+		/* Best of a few runs, the stream is fed in chunks as read from a
+		 * file and the channel arrays are drained after every chunk */
+		unpackTime = 1.0e9;
+		streamTime = 1.0e9;
+		for (run = 0; run < 3; run = run + 1) {
+			start = std::chrono::steady_clock::now();
+			SampleDecoder_Unpack24(packed.data(), count, samples.data(), path);
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (seconds < unpackTime) { unpackTime = seconds; }
+
+			SampleDecoder_Initialize(decoder, path);
+			start = std::chrono::steady_clock::now();
+			for (chunk = 0; chunk < stream.size(); chunk = chunk + SAMPLEDECODER_CHUNK) {
+				SampleDecoder_Feed(decoder, stream.data() + chunk, std::min(stream.size() - chunk, (size_t)SAMPLEDECODER_CHUNK));
+				SampleDecoder_Flush(decoder);
+				SampleDecoder_Drain(decoder);
+			}
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (seconds < streamTime) { streamTime = seconds; }
+		}
+		if (path == SAMPLEDECODER_SCALAR) { scalarTime = streamTime; }
+
+		/* The unpack kernel alone reads the 3-byte samples back to back */
+		std::fprintf(out, "%-6s  %12.0f  %12.0f  %17.0f  %6.2fx\n", names[path], count * 3 / unpackTime / 1.0e6,
+					 stream.size() / streamTime / 1.0e6, (frames / rate / 3600.0) / (streamTime / 60.0),
+					 scalarTime / streamTime);
+	}
+
+	return result;
+}
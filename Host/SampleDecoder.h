@@ -0,0 +1,94 @@
+/***************************************************************************//**
+ *   @file   SampleDecoder.h
+ *   @brief  Header file of the bulk decoder of the samples of a stream into
+ *           one array per channel.
+*******************************************************************************/
+#ifndef SAMPLEDECODER_H
+#define SAMPLEDECODER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstddef>
+#include <cstdio>
+#include <stdint.h>
+#include <vector>
+
+#include "Record.h"
+#include "RiceDecoder.h"
+#include "Unpacker.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Kernels unpacking the 24-bit samples, the best one the CPU runs is used */
+#define SAMPLEDECODER_SCALAR		0
+#define SAMPLEDECODER_SSSE3			1		// 4 samples per shuffle
+#define SAMPLEDECODER_AVX2			2		// 8 samples per shuffle
+#define SAMPLEDECODER_BEST			-1
+
+#define SAMPLEDECODER_BATCH			1024	// FRAME records unpacked at once
+#define SAMPLEDECODER_MAX_CHANNELS	16		// two ADS1298 of 8 channels
+#define SAMPLEDECODER_CHUNK			(1 << 20)	// bytes of the stream fed at once by the benchmark
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Decoder of the frames of one stream, the stream may be fed in chunks */
+struct SampleDecoder {
+	int path;								// SAMPLEDECODER_* kernel used
+	size_t channelCount;					// channels of the frames being batched
+	size_t batchFrames;
+	std::vector<unsigned char> batch;		// payloads of the FRAME records not unpacked yet
+	std::vector<unsigned char> batchSeqs;	// their sequence numbers
+	std::vector<int32_t> interleaved;		// samples of the batch, in stream order
+	std::vector<unsigned char> carry;		// record cut at the end of the last chunk
+	std::vector<unsigned char> key;			// last FRAME record, primes the Rice decoder
+	std::vector<long> samples;				// frame of the Rice decoder or the unpacker
+
+	RiceDecoder rice;
+	Unpacker unpacker;
+
+	/* Samples of every channel in frame order, a channel turned off reads 0 */
+	std::vector<std::vector<int32_t> > planes;
+	std::vector<unsigned char> seqs;		// sequence number of every frame in the arrays
+	std::vector<unsigned char> counts;		// channels of every frame in the arrays
+	std::vector<unsigned char> events;		// BEAT, STATUS, LAYOUT, TRIGGER, RESTART, STATS and QUALITY records, header included
+	std::vector<size_t> eventFrames;		// frames decoded before each of them
+
+	unsigned long frames, gaps, rejected;
+	unsigned long discarded;				// bytes skipped to resynchronize on a record whose check is right
+	unsigned long long bytes;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the decoder */
+void SampleDecoder_Initialize(SampleDecoder& decoder, int path);
+
+/* Tells which kernels the CPU runs */
+bool SampleDecoder_IsSupported(int path);
+
+/* Unpacks big-endian 24-bit two's complement samples */
+void SampleDecoder_Unpack24(const unsigned char* bytes, size_t count, int32_t* samples, int path);
+
+/* Scales samples to floats */
+void SampleDecoder_ToFloat(const int32_t* samples, size_t count, float scale, float* values, int path);
+
+/* Decodes the records of a chunk of the stream */
+void SampleDecoder_Feed(SampleDecoder& decoder, const unsigned char* data, size_t size);
+
+/* Unpacks the frames still batched */
+void SampleDecoder_Flush(SampleDecoder& decoder);
+
+/* Empties the channel arrays, keeping their memory */
+void SampleDecoder_Drain(SampleDecoder& decoder);
+
+/* Prints the decoding speed of every kernel on a synthetic stream */
+int SampleDecoder_Benchmark(unsigned long frames, unsigned int channels, double rate, FILE* out);
+
+#endif /* SAMPLEDECODER_H */
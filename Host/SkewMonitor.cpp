@@ -0,0 +1,150 @@
+/***************************************************************************//**
+ *   @file   SkewMonitor.cpp
+ *   @brief  Implementation of the inter-device sample skew monitor. Every
+ *           device converts the same internal square wave (CONFIG2_INTTEST,
+ *           TESTFREQ_AC20) on channel 1. The edges of device N are paired with
+ *           the nearest edge of the same polarity on device 1, which is where
+ *           the cross-correlation of the two edge trains peaks, and the time
+ *           difference is the skew between the devices.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cmath>
+
+#include "SkewMonitor.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the monitor.
+ *
+ * @param monitor - Monitor to initialize.
+ * @param devices - Number of devices in a calibration record.
+ * @param sampleRate - Data rate set in CONFIG1, in samples per second.
+ * @param alertSamples - Drift of the skew, in samples, that raises an alert.
+ *
+ * @return None.
+*******************************************************************************/
+void SkewMonitor_Initialize(SkewMonitor& monitor, int devices, double sampleRate, double alertSamples) {
+	monitor.devices = devices;
+	monitor.samplePeriodUs = 1.0e6 / sampleRate;
+	monitor.alertSamples = alertSamples;
+	monitor.index = 0;
+	monitor.alerts = 0;
+
+	monitor.previous.assign(devices, 0);
+	monitor.low.assign(devices, 0x7FFFFFL);
+	monitor.high.assign(devices, -0x800000L);
+	monitor.edgeTime.assign(devices, 0.0);
+	monitor.edgeRising.assign(devices, 0);
+	monitor.edgeCount.assign(devices, 0);
+	monitor.pairedEdge.assign(devices, 0);
+	monitor.pairedReference.assign(devices, 0);
+
+	monitor.pairs.assign(devices, 0);
+	monitor.skew.assign(devices, 0.0);
+	monitor.skewSum.assign(devices, 0.0);
+	monitor.skewMin.assign(devices, 0.0);
+	monitor.skewMax.assign(devices, 0.0);
+	monitor.baseline.assign(devices, 0.0);
+}
+
+/***************************************************************************//**
+ * @brief Adds the channel 1 sample of every device for one frame. Edges are
+ *        located with sub-sample precision by interpolating the crossing of
+ *        the mid level between the two samples around it.
+ *
+ * @param monitor - Monitor to update.
+ * @param samples - Channel 1 sample of every device, in device order.
+ *
+ * @return None.
+*******************************************************************************/
+void SkewMonitor_AddFrame(SkewMonitor& monitor, const long* samples) {
+	int d;
+	long x, prev, mid;
+	double dt;
+
+	/* Look for a mid-level crossing on every device */
+	for (d = 0; d < monitor.devices; d = d + 1) {
+		x = samples[d];
+		prev = monitor.previous[d];
+		monitor.previous[d] = x;
+
+		if (x < monitor.low[d]) { monitor.low[d] = x; }
+		if (x > monitor.high[d]) { monitor.high[d] = x; }
+		if ((monitor.index == 0) || (monitor.high[d] - monitor.low[d] < SKEW_MIN_AMPLITUDE)) { continue; }
+
+		mid = (monitor.low[d] + monitor.high[d]) / 2;
+		if ((prev < mid) == (x < mid)) { continue; }
+
+		monitor.edgeTime[d] = (double)(monitor.index - 1) + (double)(mid - prev) / (double)(x - prev);
+		monitor.edgeRising[d] = (x > prev);
+		monitor.edgeCount[d] = monitor.edgeCount[d] + 1;
+	}
+	monitor.index = monitor.index + 1;
+
+	/* Pair new edges against device 1, whichever device saw its edge first.
+	 * The first edges are skipped, the extremes are not settled before them. */
+	for (d = 1; d < monitor.devices; d = d + 1) {
+		if ((monitor.edgeCount[d] < SKEW_SETTLE_EDGES) || (monitor.edgeCount[0] < SKEW_SETTLE_EDGES)) { continue; }
+		if ((monitor.edgeCount[d] == monitor.pairedEdge[d]) ||
+			(monitor.edgeCount[0] == monitor.pairedReference[d])) { continue; }
+		if (monitor.edgeRising[d] != monitor.edgeRising[0]) { continue; }
+
+		dt = monitor.edgeTime[d] - monitor.edgeTime[0];
+		if (std::fabs(dt) > SKEW_MAX_LAG) { continue; }
+
+		monitor.pairedEdge[d] = monitor.edgeCount[d];
+		monitor.pairedReference[d] = monitor.edgeCount[0];
+
+		/* Keep the statistics of the skew */
+		if (monitor.pairs[d] == 0) {
+			monitor.baseline[d] = dt;
+			monitor.skewMin[d] = dt;
+			monitor.skewMax[d] = dt;
+		}
+		if (dt < monitor.skewMin[d]) { monitor.skewMin[d] = dt; }
+		if (dt > monitor.skewMax[d]) { monitor.skewMax[d] = dt; }
+		monitor.skew[d] = dt;
+		monitor.skewSum[d] = monitor.skewSum[d] + dt;
+		monitor.pairs[d] = monitor.pairs[d] + 1;
+
+		/* Raise an alert if the devices drifted apart during the run */
+		if (std::fabs(dt - monitor.baseline[d]) > monitor.alertSamples) {
+			monitor.alerts = monitor.alerts + 1;
+			std::fprintf(stderr, "ALERT: device %d skew drifted to %.3f samples (%.1f us) at sample %lu, started at %.3f\n",
+						 d + 1, dt, dt * monitor.samplePeriodUs, monitor.index, monitor.baseline[d]);
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief Prints the skew of every device against device 1.
+ *
+ * @param monitor - Monitor to report.
+ * @param out - Stream to print to.
+ *
+ * @return None.
+*******************************************************************************/
+void SkewMonitor_Report(const SkewMonitor& monitor, FILE* out) {
+	int d;
+	double mean;
+
+	std::fprintf(out, "device  edges  mean(samples)  mean(us)  min(us)  max(us)\n");
+	for (d = 1; d < monitor.devices; d = d + 1) {
+		if (monitor.pairs[d] == 0) {
+			std::fprintf(out, "%6d  %5d  no edges paired with device 1\n", d + 1, 0);
+			continue;
+		}
+		mean = monitor.skewSum[d] / (double)monitor.pairs[d];
+		std::fprintf(out, "%6d  %5lu  %13.3f  %8.1f  %7.1f  %7.1f\n",
+					 d + 1, monitor.pairs[d], mean, mean * monitor.samplePeriodUs,
+					 monitor.skewMin[d] * monitor.samplePeriodUs,
+					 monitor.skewMax[d] * monitor.samplePeriodUs);
+	}
+	std::fprintf(out, "%lu drift alert(s)\n", monitor.alerts);
+}
@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ *   @file   SkewMonitor.h
+ *   @brief  Header file of the inter-device sample skew monitor.
+*******************************************************************************/
+#ifndef SKEWMONITOR_H
+#define SKEWMONITOR_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+#include <vector>
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define SKEW_MIN_AMPLITUDE		1000	// LSB swing before the test signal edges are trusted
+#define SKEW_MAX_LAG			16		// samples searched around an edge of device 1
+#define SKEW_SETTLE_EDGES		3		// edges skipped while the extremes settle
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Edge tracking state of the calibration test signal on every device */
+struct SkewMonitor {
+	int devices;
+	double samplePeriodUs;				// 1 / data rate, in microseconds
+	double alertSamples;				// drift from the first estimate raising an alert
+	unsigned long index;				// sample index of the next frame
+	unsigned long alerts;
+
+	std::vector<long> previous;			// previous sample of each device
+	std::vector<long> low, high;		// extremes of the test signal of each device
+	std::vector<double> edgeTime;		// interpolated sample index of the last edge
+	std::vector<int> edgeRising;		// polarity of the last edge
+	std::vector<unsigned long> edgeCount;
+	std::vector<unsigned long> pairedEdge, pairedReference; // edges last paired with device 1
+
+	std::vector<unsigned long> pairs;	// edge pairs measured against device 1
+	std::vector<double> skew;			// last skew against device 1, in samples
+	std::vector<double> skewSum, skewMin, skewMax;
+	std::vector<double> baseline;		// first skew measured, drift is relative to it
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the monitor */
+void SkewMonitor_Initialize(SkewMonitor& monitor, int devices, double sampleRate, double alertSamples);
+
+/* Adds the channel 1 sample of every device for one frame */
+void SkewMonitor_AddFrame(SkewMonitor& monitor, const long* samples);
+
+/* Prints the skew of every device against device 1 */
+void SkewMonitor_Report(const SkewMonitor& monitor, FILE* out);
+
+#endif /* SKEWMONITOR_H */
@@ -0,0 +1,189 @@
+/***************************************************************************//**
+ *   @file   TraceHistogram.cpp
+ *   @brief  Latency histograms of the trace events captured on the logic
+ *           analyzer port. The start and end markers of a stage are paired,
+ *           nested ones included, and the durations are counted in log2
+ *           buckets of microseconds. The DRDY marker gives the frame period.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "TraceHistogram.h"
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static const char* names[TRACE_STAGES] = {"idle", "drdy", "read", "frame", "enqueue", "pump", "isr"};
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the histograms.
+ *
+ * @param histogram - Histograms to initialize.
+ *
+ * @return None.
+*******************************************************************************/
+void TraceHistogram_Initialize(TraceHistogram& histogram) {
+	int s;
+
+	for (s = 0; s < TRACE_STAGES; s = s + 1) {
+		histogram.stages[s].open.clear();
+		histogram.stages[s].count = 0;
+		histogram.stages[s].orphans = 0;
+		histogram.stages[s].sum = 0.0;
+		histogram.stages[s].min = 0.0;
+		histogram.stages[s].max = 0.0;
+		std::memset(histogram.stages[s].buckets, 0, sizeof(histogram.stages[s].buckets));
+	}
+	histogram.lastDrdy = -1.0;
+	histogram.events = 0;
+	histogram.unknown = 0;
+}
+
+/***************************************************************************//**
+ * @brief Counts a duration of a stage.
+ *
+ * @param stage - Stage measured.
+ * @param us - Duration, in microseconds.
+ *
+ * @return None.
+*******************************************************************************/
+static void TraceHistogram_AddDuration(TraceStage& stage, double us) {
+	int bucket = 0;
+
+	if ((stage.count == 0) || (us < stage.min)) { stage.min = us; }
+	if ((stage.count == 0) || (us > stage.max)) { stage.max = us; }
+	stage.sum = stage.sum + us;
+	stage.count = stage.count + 1;
+
+	/* Bucket b holds [2^(b-1), 2^b) us, bucket 0 below 1 us */
+	if (us >= 1.0) { bucket = (int)std::floor(std::log2(us)) + 1; }
+	if (bucket >= TRACE_BUCKETS) { bucket = TRACE_BUCKETS - 1; }
+	stage.buckets[bucket] = stage.buckets[bucket] + 1;
+}
+
+/***************************************************************************//**
+ * @brief Adds an event strobed at a time. An end marker closes the last
+ *        start marker of its stage.
+ *
+ * @param histogram - Histograms to update.
+ * @param time - Time of the clock edge, in seconds.
+ * @param event - Byte latched, TRACE_* of Protocol.h.
+ *
+ * @return None.
+*******************************************************************************/
+void TraceHistogram_AddEvent(TraceHistogram& histogram, double time, unsigned int event) {
+	TraceStage* stage;
+
+	histogram.events = histogram.events + 1;
+	if ((event >= TRACE_EVENTS) || (event < TRACE_DRDY)) {
+		histogram.unknown = histogram.unknown + 1;
+		return;
+	}
+	stage = &histogram.stages[event >> 1];
+
+	if ((event & ~TRACE_EXIT) == TRACE_DRDY) {
+		if (histogram.lastDrdy >= 0.0) { TraceHistogram_AddDuration(*stage, (time - histogram.lastDrdy) * 1.0e6); }
+		histogram.lastDrdy = time;
+	} else if ((event & TRACE_EXIT) == 0) {
+		stage->open.push_back(time);
+	} else if (stage->open.empty()) {
+		stage->orphans = stage->orphans + 1;
+	} else {
+		TraceHistogram_AddDuration(*stage, (time - stage->open.back()) * 1.0e6);
+		stage->open.pop_back();
+	}
+}
+
+/***************************************************************************//**
+ * @brief Reads the events of a CSV exported by the logic analyzer, one line
+ *        per clock edge with the time in seconds first and the byte last, in
+ *        hexadecimal (0x..) or decimal. The header and other lines are
+ *        skipped.
+ *
+ * @param histogram - Histograms to update.
+ * @param path - Path of the CSV file.
+ *
+ * @return true - file read, false - file could not be opened.
+*******************************************************************************/
+bool TraceHistogram_LoadCsv(TraceHistogram& histogram, const char* path) {
+	char line[256];
+	char* field;
+	char* end;
+	double time;
+	unsigned long value;
+	FILE* file = std::fopen(path, "r");
+
+	if (!file) { return false; }
+
+	while (std::fgets(line, sizeof(line), file)) {
+		time = std::strtod(line, &end);
+		if ((end == line) || (*end != ',')) { continue; }
+
+		field = std::strrchr(line, ',') + 1;
+		while (*field == ' ') { field = field + 1; }
+		value = std::strtoul(field, &end, 0);
+		if (end == field) { continue; }
+
+		TraceHistogram_AddEvent(histogram, time, (unsigned int)value);
+	}
+	std::fclose(file);
+
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief Prints the statistics and the log2 histogram of every stage.
+ *
+ * @param histogram - Histograms to print.
+ * @param out - Stream to print to.
+ *
+ * @return None.
+*******************************************************************************/
+void TraceHistogram_Report(const TraceHistogram& histogram, FILE* out) {
+	const TraceStage* stage;
+	unsigned long peak;
+	int s, b, width;
+
+	std::fprintf(out, "stage    count    min(us)   mean(us)    max(us)  open  orphans\n");
+	for (s = 1; s < TRACE_STAGES; s = s + 1) {
+		stage = &histogram.stages[s];
+		if ((stage->count == 0) && (stage->orphans == 0)) { continue; }
+		std::fprintf(out, "%-7s  %5lu  %9.1f  %9.1f  %9.1f  %4lu  %7lu\n", names[s], stage->count, stage->min,
+					 (stage->count != 0) ? stage->sum / stage->count : 0.0, stage->max,
+					 (unsigned long)stage->open.size(), stage->orphans);
+	}
+
+	for (s = 1; s < TRACE_STAGES; s = s + 1) {
+		stage = &histogram.stages[s];
+		if (stage->count == 0) { continue; }
+
+		peak = 0;
+		for (b = 0; b < TRACE_BUCKETS; b = b + 1) { if (stage->buckets[b] > peak) { peak = stage->buckets[b]; } }
+
+		std::fprintf(out, "\n%s%s\n", names[s], (s == (TRACE_DRDY >> 1)) ? " period" : "");
+		for (b = 0; b < TRACE_BUCKETS; b = b + 1) {
+			if (stage->buckets[b] == 0) { continue; }
+			width = (int)((stage->buckets[b] * 50 + peak - 1) / peak);
+			if (b == 0) {
+				std::fprintf(out, "  %15s us  %7lu  ", "< 1", stage->buckets[b]);
+			} else if (b == TRACE_BUCKETS - 1) {
+				std::fprintf(out, "  %6ld and more us  %7lu  ", 1L << (b - 1), stage->buckets[b]);
+			} else {
+				std::fprintf(out, "  %6ld to %6ld us  %7lu  ", 1L << (b - 1), 1L << b, stage->buckets[b]);
+			}
+			while (width > 0) { std::fputc('#', out); width = width - 1; }
+			std::fputc('\n', out);
+		}
+	}
+
+	std::fprintf(out, "\n%lu event(s), %lu unknown\n", histogram.events, histogram.unknown);
+}
@@ -0,0 +1,58 @@
+/***************************************************************************//**
+ *   @file   TraceHistogram.h
+ *   @brief  Header file of the latency histograms of the trace events captured
+ *           on the logic analyzer port.
+*******************************************************************************/
+#ifndef TRACEHISTOGRAM_H
+#define TRACEHISTOGRAM_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <cstdio>
+#include <vector>
+
+#include "../Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define TRACE_STAGES				(TRACE_EVENTS / 2)
+#define TRACE_BUCKETS				20		// log2 of the duration in us, the last one open
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Durations of a stage, or periods of a single marker */
+struct TraceStage {
+	std::vector<double> open;			// start times of the stages not ended, nested
+	unsigned long count, orphans;		// durations measured, ends without a start
+	double sum, min, max;				// in us
+	unsigned long buckets[TRACE_BUCKETS];
+};
+
+/* Stages of a capture */
+struct TraceHistogram {
+	TraceStage stages[TRACE_STAGES];	// by event / 2, the DRDY periods first
+	double lastDrdy;
+	unsigned long events, unknown;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the histograms */
+void TraceHistogram_Initialize(TraceHistogram& histogram);
+
+/* Adds an event strobed at a time */
+void TraceHistogram_AddEvent(TraceHistogram& histogram, double time, unsigned int event);
+
+/* Reads the events of a CSV exported by the logic analyzer */
+bool TraceHistogram_LoadCsv(TraceHistogram& histogram, const char* path);
+
+/* Prints the statistics and the histogram of every stage */
+void TraceHistogram_Report(const TraceHistogram& histogram, FILE* out);
+
+#endif /* TRACEHISTOGRAM_H */
@@ -0,0 +1,100 @@
+/***************************************************************************//**
+ *   @file   Unpacker.cpp
+ *   @brief  Implementation of the unpacker of the bit-packed frames, see
+ *           Protocol.h for the format.
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "Unpacker.h"
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Initializes the unpacker.
+ *
+ * @param unpacker - Unpacker to initialize.
+ *
+ * @return None.
+*******************************************************************************/
+void Unpacker_Initialize(Unpacker& unpacker) {
+	unpacker.bits.clear();
+	unpacker.shift.clear();
+	unpacker.frames = 0;
+	unpacker.undecodable = 0;
+	unpacker.clipped = 0;
+	unpacker.leadOff = 0;
+	unpacker.rawBytes = 0;
+	unpacker.packedBytes = 0;
+}
+
+/***************************************************************************//**
+ * @brief Unpacks the samples of a record. PACKING records update the
+ *        settings, PACKED records are unpacked with them and scaled back to
+ *        24-bit samples.
+ *
+ * @param unpacker - Unpacker of the stream.
+ * @param record - Record read from the stream.
+ * @param samples - Sign-extended samples of every channel of the frame.
+ *
+ * @return true - samples unpacked, false - not a frame or not decodable.
+*******************************************************************************/
+bool Unpacker_Record(Unpacker& unpacker, const Record& record, std::vector<long>& samples) {
+	const unsigned char* data;
+	size_t size, bit = 0;
+	unsigned channelCount, i, j;
+	unsigned long value;
+	long sample;
+
+	if (record.tag == IMPLANT_TAG_PACKING) {
+		channelCount = record.length / 2;
+		unpacker.bits.resize(channelCount);
+		unpacker.shift.resize(channelCount);
+		for (i = 0; i < channelCount; i = i + 1) {
+			unpacker.bits[i] = record.payload[(i * 2) + 0];
+			unpacker.shift[i] = record.payload[(i * 2) + 1];
+		}
+		unpacker.packedBytes = unpacker.packedBytes + record.length + IMPLANT_RECORD_OVERHEAD;
+		return false;
+	}
+	if (record.tag != IMPLANT_TAG_PACKED) { return false; }
+
+	/* The settings must cover the channels of the frame */
+	if ((record.length < 2) || (record.payload[1] != unpacker.bits.size())) {
+		unpacker.undecodable = unpacker.undecodable + 1;
+		return false;
+	}
+	channelCount = record.payload[1];
+	data = record.payload + 2;
+	size = record.length - 2;
+	samples.resize(channelCount);
+
+	for (i = 0; i < channelCount; i = i + 1) {
+		if (bit + unpacker.bits[i] > size * 8) {
+			unpacker.undecodable = unpacker.undecodable + 1;
+			return false;
+		}
+
+		/* Read the bits of the channel MSB first */
+		value = 0;
+		for (j = 0; j < unpacker.bits[i]; j = j + 1) {
+			value = (value << 1) | ((data[bit >> 3] >> (7 - (bit & 7))) & 1);
+			bit = bit + 1;
+		}
+
+		/* Sign-extend and restore the scale */
+		sample = (long)value;
+		if (value & (1UL << (unpacker.bits[i] - 1))) { sample = sample - (long)(1UL << unpacker.bits[i]); }
+		samples[i] = sample * (1L << unpacker.shift[i]);
+	}
+
+	if (record.payload[0] & PACKER_FLAG_CLIPPED) { unpacker.clipped = unpacker.clipped + 1; }
+	if (record.payload[0] & PACKER_FLAG_LEADOFF) { unpacker.leadOff = unpacker.leadOff + 1; }
+	unpacker.frames = unpacker.frames + 1;
+	unpacker.rawBytes = unpacker.rawBytes + (channelCount * 3);
+	unpacker.packedBytes = unpacker.packedBytes + record.length;
+	return true;
+}
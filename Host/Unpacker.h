@@ -0,0 +1,37 @@
+/***************************************************************************//**
+ *   @file   Unpacker.h
+ *   @brief  Header file of the unpacker of the bit-packed frames.
+*******************************************************************************/
+#ifndef UNPACKER_H
+#define UNPACKER_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <vector>
+
+#include "Record.h"
+
+/******************************************************************************/
+/* TYPES																	  */
+/******************************************************************************/
+
+/* Unpacker of the PACKED records of one stream */
+struct Unpacker {
+	std::vector<unsigned char> bits, shift;	// from the last PACKING record
+	unsigned long frames, undecodable;
+	unsigned long clipped, leadOff;			// frames with the flag set
+	unsigned long rawBytes, packedBytes;
+};
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Initializes the unpacker */
+void Unpacker_Initialize(Unpacker& unpacker);
+
+/* Unpacks the samples of a record */
+bool Unpacker_Record(Unpacker& unpacker, const Record& record, std::vector<long>& samples);
+
+#endif /* UNPACKER_H */
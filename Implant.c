@@ -16,61 +16,908 @@
 /* VARIABLES    															 */
 /*****************************************************************************/
 static unsigned char frameSize = 0;
+static unsigned char frameSeq = 0; // sequence number of the frames sent to the relay
+static unsigned char streaming = 0; // frames are streamed by Implant_Task
+static unsigned char encoding = IMPLANT_ENCODING_RICE; // how the frames are sent
+static unsigned char baseEncoding = IMPLANT_ENCODING_RICE; // encoding set by the relay
+static unsigned char baseFactor = 1; // decimation set by the relay
+static unsigned char quality = QUALITY_FULL; // level of the quality ladder applied
+static unsigned char filterMains = 50, filterSet = 0; // filters set by the relay
+static unsigned char dropped = 0; // records dropped since the last quality update
+static unsigned int droppedTotal = 0;
+static unsigned int reportTicks = 0; // frames read since the last QUEUES record
+static unsigned char keyNext = 1; // the next frame must be sent raw to restart the predictor
+static unsigned char uploading = 0; // the TRIGGER record of the captured window was sent
+static unsigned char profileNext = PROFILER_PROBES; // probe of the next PROFILE record of a dump
+static unsigned char pumpSource = TXQUEUE_NONE; // record written to the radio ring, TXQUEUE_NONE between records
+static unsigned char pumpLeft = 0; // bytes of it left to write
+static unsigned char pumpStore = 0; // its bytes are copied to the ARQ
+static unsigned char pumpWrapped = 0; // it is carried by an ARQ record, whose check follows it
+static unsigned char pumpCheck = 0; // CRC-8 of the ARQ record so far
 unsigned char mode;
 
+/* Configuration restored at boot and saved when it changes */
+static Config config;
+
+/* Radio profile used until one is saved (CHANNR, FREQ2-0, MDMCFG4-2, DEVIATN, FEC) */
+static const unsigned char defaultRadio[CONFIG_RADIO_SIZE] = {0x00, 0x10, 0xB1, 0x3B, 0xF5, 0x83, 0x13, 0x15, FEC_NONE};
+
 /*****************************************************************************/
 /* FUNCTIONS																 */
 /*****************************************************************************/
 
 unsigned char Implant_Initialize(unsigned char* channels) {
     unsigned char status = 0;
+    unsigned char warm, i;
+    Supervisor_State* state = Supervisor_GetState();
     
-    /* Initialize the ADS1298 */
-	status = ADS1298_Initialize(channels);
+    /* After a watchdog reset the ADS1298 supplies stayed up */
+    warm = Supervisor_IsRestart();
+    
+    /* Restore the saved configuration, or go through the defaults once */
+    if (Config_Load(&config)) {
+		status = ADS1298_Restore(&config.registers[0][0], warm);
+		
+		/* Channels changed while streaming are not saved yet */
+		if (status && warm) {
+			for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+				if (state->channels[i] != ADS1298_GetChannels(i + 1)) { break; }
+			}
+			if (i < ADS1298_DEVICE_COUNT) { ADS1298_SetChannels(state->channels); }
+		}
+	} else {
+		for (i = 0; i < CONFIG_RADIO_SIZE; i = i + 1) { config.radio[i] = defaultRadio[i]; }
+		config.streaming = 0;
+		status = ADS1298_Initialize(channels);
+		if (status) { Implant_SaveConfig(); }
+	}
 	// frameSize = ADS1298_GetFrameSize();
     
-    /* Initialize the SPI communication */
-    //status &= CC110L_Initialize();
+    /* Initialize the SPI communication with the relay */
+    status &= CC110L_Initialize();
     
+	/* Commands of the relay, read from the RC ring */
+	Command_Initialize();
+	Command_SetHandler(COMMAND_MODE, 1 + ADS1298_DEVICE_COUNT, Implant_CommandMode);
+	Command_SetHandler(COMMAND_ENCODING, 1, Implant_CommandEncoding);
+	Command_SetHandler(COMMAND_PACKING, 3, Implant_CommandPacking);
+	Command_SetHandler(COMMAND_DECIMATION, 1, Implant_CommandDecimation);
+	Command_SetHandler(COMMAND_FILTERS, 2, Implant_CommandFilters);
+	Command_SetHandler(COMMAND_DETECTOR, 2, Implant_CommandDetector);
+	Command_SetHandler(COMMAND_CAPTURE, 5, Implant_CommandCapture);
+	Command_SetHandler(COMMAND_TRIGGER, 0, Implant_CommandTrigger);
+	Command_SetHandler(COMMAND_THRESHOLD, 4, Implant_CommandThreshold);
+	Command_SetHandler(COMMAND_ENVELOPE, 1, Implant_CommandEnvelope);
+	Command_SetHandler(COMMAND_QUALITY, 3, Implant_CommandQuality);
+	Command_SetHandler(COMMAND_QUALITY_ACK, 1, Implant_CommandQualityAck);
+	Command_SetHandler(COMMAND_ARQ, 1, Implant_CommandArq);
+	Command_SetHandler(COMMAND_ARQ_ACK, ARQ_ACK_SIZE, Implant_ArqAcknowledge);
+	Command_SetHandler(COMMAND_FEC, 1, Implant_CommandFec);
+	Command_SetHandler(COMMAND_PROFILE, 0, Implant_CommandProfile);
+	Command_SetHandler(COMMAND_STATS, 0, Implant_CommandStats);
+	Command_SetHandler(COMMAND_CALIBRATE, 1, Implant_CommandCalibrate);
+	
+	/* Records are queued by priority before the radio, coded as the profile says */
+	TxQueue_Initialize();
+	Fec_Configure(config.radio[CONFIG_RADIO_FEC]);
+	
+#ifdef PROFILER_ENABLE
+	Profiler_Initialize();
+#endif
+	
 	/* Initialize the Logic Analyzer */
 	status &= LogicAnalyzer_Initialize();
+	
+	/* Powered and idle, with or without channels on */
+	mode = 0x01;
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) {
+		if (ADS1298_GetChannels(i + 1) != 0) { mode = 0x02; }
+	}
     
     return status;
 }
 
-void Implant_StreamData(unsigned char frameCnt) {
-	unsigned char data[50];
+void Implant_SaveConfig() {
+	ADS1298_Device* dev;
+	unsigned char device, i;
+	
+	/* Take the registers as last written to the devices */
+	for (device = 1; device <= ADS1298_DEVICE_COUNT; device = device + 1) {
+		dev = ADS1298_GetDevice(device);
+		for (i = 0; i < CONFIG_IMAGE_SIZE; i = i + 1) {
+			config.registers[device - 1][i] = dev->registers[ADS1298_CONFIG1 + i];
+		}
+		config.channels[device - 1] = ADS1298_GetChannels(device);
+	}
+	
+	/* Only the bytes that changed are written */
+	Config_Save(&config);
+}
+
+unsigned char Implant_IsStreamSaved() {
+	return config.streaming;
+}
+
+void Implant_Resume() {
+	Supervisor_State* state = Supervisor_GetState();
+	unsigned char restart[4];
+	unsigned int ticks;
+	
+	/* Carry on with the sequence numbers, the relay sees a tagged gap */
+	frameSeq = state->nextSeq;
+	ticks = Supervisor_GetBootTicks();
+	restart[0] = Supervisor_GetCause();
+	restart[1] = state->resets;
+	restart[2] = (unsigned char) (ticks >> 8);
+	restart[3] = (unsigned char) ticks;
+	Implant_SendRecord(IMPLANT_TAG_RESTART, restart, sizeof(restart));
+	
+	if (state->streaming) { Implant_StartStreaming(); }
+}
+
+void Implant_StartStreaming() {
+	Supervisor_State* state = Supervisor_GetState();
 	unsigned char i;
 	
 	/* Start converting data and reading it */
     ADS1298_START_PIN = 1; // bring the START pin high to start converting data
-	ADS1298_StartConversion();
+	
+	/* Devices out of step are stopped and started together once more, the
+	 * failed verifications are counted in STATS */
+	if (!ADS1298_StartConversion()) {
+		ADS1298_START_PIN = 0;
+		ADS1298_StopConversion();
+		ADS1298_START_PIN = 1;
+		ADS1298_StartConversion();
+	}
+	
+	/* The beat indexes count from the LAYOUT record sent */
+	Implant_ChangeLayout();
+	streaming = 1;
+	mode = 0x03;
+	
+	/* Remember the stream across a watchdog reset */
+	state->streaming = 1;
+	state->nextSeq = frameSeq;
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) { state->channels[i] = ADS1298_GetChannels(i + 1); }
+	Supervisor_Checkpoint();
+}
+
+void Implant_StreamFrame() {
+	unsigned char data[ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT * 3];
+	Supervisor_State* state = Supervisor_GetState();
+	unsigned char length, beat, ready = 0, sent = 1;
+	
+	LogicAnalyzer_TRACE(TRACE_FRAME);
+	length = ADS1298_ReadFrame(data);
+	
+	/* No channel on, only a channel change can bring frames back */
+	if (length == 0) {
+		if (ADS1298_GetLayoutChange()) { Implant_ChangeLayout(); }
+		LogicAnalyzer_TRACE(TRACE_FRAME | TRACE_EXIT);
+		return;
+	}
+	
+	/* The detector runs on every frame read, a gap repeats the last sample */
+	PROFILER_START(PROFILER_DETECTOR);
+	beat = QrsDetector_AddFrame(data, (length == ADS1298_FRAME_GAP) ? 0 : length / 3);
+	PROFILER_STOP(PROFILER_DETECTOR);
+	if (beat) { Implant_SendBeat(); }
+	
+	if ((encoding != IMPLANT_ENCODING_BEATS) && (length != ADS1298_FRAME_GAP)) {
+		PROFILER_START(PROFILER_DECIMATOR);
+		ready = Decimator_AddFrame(data, length / 3);
+		PROFILER_STOP(PROFILER_DECIMATOR);
+	}
+	
+	if (encoding == IMPLANT_ENCODING_BEATS) {
+		sent = 0; // beats only, the frames are not sent
+	} else if (length == ADS1298_FRAME_GAP) {
+		if (encoding == IMPLANT_ENCODING_CAPTURE) {
+			sent = 0; // the ring only holds frames
+		} else {
+			Implant_SendRecord(IMPLANT_TAG_GAP, data, 0); // keep the sequence numbers aligned
+		}
+		keyNext = 1;
+		Decimator_Reset();
+		FilterBank_Reset();
+		Envelope_Reset();
+	} else if (ready) {
+		PROFILER_START(PROFILER_FILTERS);
+		FilterBank_ProcessFrame(data, length / 3);
+		PROFILER_STOP(PROFILER_FILTERS);
+		if (encoding == IMPLANT_ENCODING_CAPTURE) {
+			Capture_AddFrame(data, length);
+			sent = 0; // sent with the window of a trigger
+		} else if (encoding == IMPLANT_ENCODING_ENVELOPE) {
+			/* The frame keeps its sequence number, the envelope has the last one */
+			if (Envelope_AddFrame(data, length / 3)) { Implant_SendEnvelope(); }
+		} else {
+			Implant_SendFrame(data, length);
+		}
+	} else {
+		sent = 0; // the decimator needs more frames
+	}
+	Implant_SendStatusChanges();
+	if (profileNext < PROFILER_PROBES) { Implant_SendProfile(); }
+	if (sent) { frameSeq = frameSeq + 1; }
+	if (encoding == IMPLANT_ENCODING_CAPTURE) { Implant_UploadCapture(); }
+	
+	/* Step along the quality ladder before the bulk queue overflows */
+	if (Quality_Update(frameSeq, TxQueue_GetCount(TXQUEUE_BULK), TxQueue_GetSize(TXQUEUE_BULK), dropped)) {
+		Implant_ApplyQuality();
+	}
+	dropped = 0;
+	
+	TxQueue_Tick();
+	Arq_Tick();
+	reportTicks = reportTicks + 1;
+	if (reportTicks >= IMPLANT_QUEUE_REPORT) { Implant_SendQueueStats(); }
+	Implant_PumpRadio();
+	
+	/* Tag the first frame read with new channels */
+	if (ADS1298_GetLayoutChange()) { Implant_ChangeLayout(); }
+	
+	state->nextSeq = frameSeq;
+	Supervisor_Checkpoint();
+	LogicAnalyzer_TRACE(TRACE_FRAME | TRACE_EXIT);
+}
+
+void Implant_ChangeLayout() {
+	Supervisor_State* state = Supervisor_GetState();
+	unsigned char i;
+	
+	/* The next frame read is the first one with the new channels */
+	Implant_SendLayout();
+	keyNext = 1;
+	Decimator_Reset();
+	FilterBank_Reset();
+	Envelope_Reset();
+	QrsDetector_Reset();
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) { state->channels[i] = ADS1298_GetChannels(i + 1); }
+	
+	/* The channel count decides whether the frames can be decimated */
+	Quality_SetDecimation((baseFactor <= DECIMATOR_MAX_FACTOR / 2) && (Implant_GetChannelCount() <= DECIMATOR_CHANNELS));
+	Implant_ApplyQuality();
+	
+	Supervisor_Checkpoint();
+}
+
+unsigned char Implant_GetChannelCount() {
+	unsigned char count = 0;
+	unsigned char device, mask;
+	
+	for (device = 1; device <= ADS1298_DEVICE_COUNT; device = device + 1) {
+		for (mask = ADS1298_GetChannels(device); mask != 0; mask = mask >> 1) {
+			count = count + (mask & 0x01);
+		}
+	}
+	
+	return count;
+}
+
+void Implant_SendFrame(unsigned char* data, unsigned char length) {
+	unsigned char coded[2 + RICE_MAX_BYTES];
+	unsigned char i;
+	
+	PROFILER_START(PROFILER_ENCODER);
+	if (encoding == IMPLANT_ENCODING_PACKED) {
+		/* Settings first, so that the relay can unpack the frame */
+		if (Packer_GetChange() || keyNext || ((frameSeq % PACKER_CONFIG_INTERVAL) == 0)) {
+			Implant_SendPacking(length / 3);
+			keyNext = 0;
+		}
+		
+		/* The 24-bit status words are reduced to flags */
+		coded[0] = 0;
+		for (i = 1; i <= ADS1298_DEVICE_COUNT; i = i + 1) {
+			if (ADS1298_GetLeadOff(i)) { coded[0] |= PACKER_FLAG_LEADOFF; }
+		}
+		coded[1] = length / 3;
+		length = Packer_PackFrame(data, coded[1], coded + 2, coded);
+		Implant_SendRecord(IMPLANT_TAG_PACKED, coded, length + 2);
+	} else if ((encoding == IMPLANT_ENCODING_RICE) && !keyNext && ((frameSeq % RICE_KEY_INTERVAL) != 0)) {
+		/* Channel count first, the relay checks it against the key frame */
+		coded[0] = length / 3;
+		length = RiceCoder_EncodeFrame(data, coded[0], coded + 1);
+		Implant_SendRecord(IMPLANT_TAG_RICE, coded, length + 1);
+	} else {
+		/* Key frame, sent raw and restarting the predictor */
+		Implant_SendRecord(IMPLANT_TAG_FRAME, data, length);
+		RiceCoder_Prime(data, length / 3);
+		keyNext = 0;
+	}
+	PROFILER_STOP(PROFILER_ENCODER);
+}
+
+void Implant_StopStreaming() {
+	Supervisor_State* state = Supervisor_GetState();
+	
+	/* Stop converting data and stop reading it, once more if a device did
+	 * not leave RDATAC */
+	if (!ADS1298_StopConversion()) { ADS1298_StopConversion(); }
+	ADS1298_START_PIN = 0;
+	streaming = 0;
+	mode = 0x02;
+	
+	state->streaming = 0;
+	Supervisor_Checkpoint();
+	
+	/* Keep the channels changed while streaming for the next boot */
+	Implant_SaveConfig();
+}
+
+void Implant_Task() {
+	if (streaming) { Implant_StreamFrame(); }
+	
+	/* Out of the frame read, the hot counters only wrap after 255 frames */
+	Stats_Fold();
+	Stats_AddTime(Supervisor_GetTicks());
+}
+
+void Implant_SetEncoding(unsigned char mode) {
+	baseEncoding = mode;
+	uploading = 0;
+	Capture_Reset();
+	
+	/* The relay takes over, back to full quality */
+	Quality_Reset();
+	Implant_ApplyQuality();
+}
+
+unsigned char Implant_SetDecimation(unsigned char factor) {
+	/* The channels after DECIMATOR_CHANNELS would only be downsampled */
+	if ((factor > 1) && (Implant_GetChannelCount() > DECIMATOR_CHANNELS)) { return 0; }
+	if (!Decimator_SetFactor(factor)) { return 0; }
+	baseFactor = factor;
+	Quality_SetDecimation((factor <= DECIMATOR_MAX_FACTOR / 2) && (Implant_GetChannelCount() <= DECIMATOR_CHANNELS));
+	Implant_ApplyQuality();
+	
+	return 1;
+}
+
+unsigned char Implant_SetFilters(unsigned char mains, unsigned char filters) {
+	/* The filters run after decimation, at the rate of the frames sent */
+	keyNext = 1;
+	filterMains = mains;
+	filterSet = filters;
+	return FilterBank_Configure(ADS1298_GetDataRate() / Decimator_GetFactor(), mains, filters);
+}
+
+void Implant_SetQuality(unsigned char enable, unsigned int hold) {
+	Quality_Configure(enable, hold);
+	Implant_ApplyQuality();
+}
+
+void Implant_Acknowledge(unsigned char seq) {
+	Quality_Acknowledge(seq);
+}
+
+void Implant_SetArq(unsigned char enable) {
+	Arq_Configure(enable);
+}
+
+void Implant_ArqAcknowledge(unsigned char* ack) {
+	Arq_Acknowledge(ack[0], ((unsigned int) ack[1] << 8) | ack[2]);
+}
+
+unsigned char Implant_SetFec(unsigned char code) {
+	/* The FILL bytes completing the block must not land inside a record */
+	if (pumpLeft != 0) { return 0; }
+	
+	/* Send what waits in the block with the previous code */
+	if (Fec_Complete()) { Implant_WriteBlock(); }
+	if (!Fec_Configure(code)) { return 0; }
+	
+	/* The code is part of the radio profile */
+	config.radio[CONFIG_RADIO_FEC] = code;
+	Implant_SaveConfig();
+	return 1;
+}
+
+void Implant_ApplyQuality() {
+	unsigned char level = Quality_GetLevel();
+	unsigned char factor = baseFactor;
+	unsigned char event[5];
+	
+	/* The ladder only steps down the streamed encodings */
+	if ((baseEncoding == IMPLANT_ENCODING_BEATS) || (baseEncoding == IMPLANT_ENCODING_CAPTURE)) { level = QUALITY_FULL; }
+	
+	switch (level) {
+		case QUALITY_PACKED:
+			encoding = IMPLANT_ENCODING_PACKED;
+			Packer_Limit(QUALITY_PACKED_BITS);
+			break;
+		case QUALITY_DECIMATED:
+			encoding = IMPLANT_ENCODING_PACKED;
+			Packer_Limit(QUALITY_PACKED_BITS);
+			if (factor <= DECIMATOR_MAX_FACTOR / 2) { factor = factor * 2; }
+			break;
+		case QUALITY_ENVELOPE:
+			encoding = IMPLANT_ENCODING_ENVELOPE;
+			if (factor <= DECIMATOR_MAX_FACTOR / 2) { factor = factor * 2; }
+			break;
+		default:
+			/* The packing of the relay applies again */
+			Packer_Limit(PACKER_MAX_BITS);
+			encoding = baseEncoding;
+			break;
+	}
+	
+	/* More channels than the decimator filters are sent at the full rate,
+	 * the decimation set by the relay applies again with fewer channels */
+	if (Implant_GetChannelCount() > DECIMATOR_CHANNELS) { factor = 1; }
+	
+	/* The filters follow the rate after decimation */
+	if (factor != Decimator_GetFactor()) {
+		Decimator_SetFactor(factor);
+		if (filterSet != 0) { FilterBank_Configure(ADS1298_GetDataRate() / factor, filterMains, filterSet); }
+	}
+	keyNext = 1;
+	Envelope_Reset();
+	
+	/* Mark the change in the stream */
+	if (level != quality) {
+		event[0] = level;
+		event[1] = Quality_GetReason();
+		event[2] = TxQueue_GetCount(TXQUEUE_BULK);
+		event[3] = (unsigned char) (droppedTotal >> 8);
+		event[4] = (unsigned char) droppedTotal;
+		Implant_SendRecord(IMPLANT_TAG_QUALITY, event, sizeof(event));
+	}
+	quality = level;
+}
+
+unsigned char Implant_SetDetector(unsigned char lead, unsigned char shift) {
+	/* The detector sees the frames before decimation */
+	return QrsDetector_Configure(ADS1298_GetDataRate(), lead, shift);
+}
+
+void Implant_SendBeat() {
+	QrsDetector_Beat beat;
+	unsigned char event[7];
+	
+	QrsDetector_GetBeat(&beat);
+	event[0] = (unsigned char) (beat.index >> 24);
+	event[1] = (unsigned char) (beat.index >> 16);
+	event[2] = (unsigned char) (beat.index >> 8);
+	event[3] = (unsigned char) beat.index;
+	event[4] = (unsigned char) (beat.rr >> 8);
+	event[5] = (unsigned char) beat.rr;
+	event[6] = beat.flags;
+	Implant_SendRecord(IMPLANT_TAG_BEAT, event, sizeof(event));
+	
+	if (beat.flags != 0) { Capture_Trigger(CAPTURE_CAUSE_BEAT); }
+}
+
+void Implant_SetCapture(unsigned int pre, unsigned int post, unsigned char triggers) {
+	uploading = 0;
+	Capture_Configure(pre, post, triggers);
+}
+
+unsigned char Implant_SetEnvelope(unsigned char frames) {
+	return Envelope_SetWindow(frames);
+}
+
+void Implant_SendEnvelope() {
+	unsigned char envelope[ENVELOPE_MAX_BYTES];
+	unsigned char length;
+	
+	length = Envelope_GetRecord(envelope);
+	Implant_SendRecord(IMPLANT_TAG_ENVELOPE, envelope, length);
+}
+
+void Implant_TriggerCapture() {
+	Capture_Trigger(CAPTURE_CAUSE_COMMAND);
+}
+
+void Implant_UploadCapture() {
+	unsigned char data[ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT * 3];
+	unsigned char window[9];
+	unsigned char length;
+	
+	if (Capture_GetState() != CAPTURE_UPLOAD) { return; }
+	
+	/* Announce the window, then one frame per frame read */
+	if (!uploading) {
+		Capture_GetWindow(window);
+		Implant_SendRecord(IMPLANT_TAG_TRIGGER, window, sizeof(window));
+		uploading = 1;
+	}
+	length = Capture_ReadFrame(data);
+	if (length != 0) {
+		Implant_SendRecord(IMPLANT_TAG_FRAME, data, length);
+		frameSeq = frameSeq + 1;
+	}
+	if (Capture_GetState() != CAPTURE_UPLOAD) { uploading = 0; }
+}
+
+void Implant_SendPacking(unsigned char channelCount) {
+	unsigned char settings[PACKER_MAX_CHANNELS * 2];
+	unsigned char length;
+	
+	length = Packer_GetSettings(channelCount, settings);
+	Implant_SendRecord(IMPLANT_TAG_PACKING, settings, length);
+}
+
+void Implant_StreamData(unsigned char frameCnt) {
+	unsigned char i;
+	
+	Implant_StartStreaming();
 	
 	/* Iterate through the frames */
 	for (i = 0; i < frameCnt; i = i + 1) {
-		ADS1298_ReadFrame(data);
-		CC110L_TX_WriteBufferMultiple(data);
+		Implant_StreamFrame();
+	}
+	
+	Implant_StopStreaming();
+}
+
+void Implant_Calibrate(unsigned char frameCnt) {
+	unsigned char data[ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT * 3];
+	unsigned char samples[ADS1298_DEVICE_COUNT * 3];
+	unsigned char i, j, length;
+	unsigned char previousMode = mode;
+	unsigned char wasStreaming = streaming;
+	ADS1298_Device* dev;
+	
+	/* The test signal replaces channel 1, the stream resumes after it */
+	if (wasStreaming) { Implant_StopStreaming(); }
+	
+	/* Drive channel 1 of every device with the test signal */
+	ADS1298_EnterCalibration();
+	
+	/* Start converting data and reading it */
+	ADS1298_START_PIN = 1;
+	ADS1298_StartConversion();
+	
+	/* Send channel 1 of every device, the relay measures the skew on the edges */
+	for (i = 0; i < frameCnt; i = i + 1) {
+		length = ADS1298_ReadFrame(data);
+		if (length == ADS1298_FRAME_GAP) {
+			Implant_SendRecord(IMPLANT_TAG_GAP, data, 0);
+		} else {
+			for (j = 0; j < ADS1298_DEVICE_COUNT; j = j + 1) {
+				dev = ADS1298_GetDevice(j + 1);
+				samples[(j * 3) + 0] = data[dev->channelOffset + 0];
+				samples[(j * 3) + 1] = data[dev->channelOffset + 1];
+				samples[(j * 3) + 2] = data[dev->channelOffset + 2];
+			}
+			Implant_SendRecord(IMPLANT_TAG_CALIBRATION, samples, sizeof(samples));
+		}
+		frameSeq = frameSeq + 1;
+		Stats_Fold();
 	}
 	
-	/* Stop converting data and stop reading it */
+	/* Stop converting data and restore the channels */
 	ADS1298_StopConversion();
 	ADS1298_START_PIN = 0;
+	ADS1298_ExitCalibration();
+	
+	if (wasStreaming) {
+		Implant_StartStreaming();
+		mode = previousMode;
+	}
+}
+
+void Implant_SendRecord(unsigned char tag, unsigned char* data, unsigned char length) {
+	unsigned char txClass = TXQUEUE_BULK;
+	
+	/* Events and alarms go ahead of the sample data */
+	switch (tag) {
+		case IMPLANT_TAG_STATUS:
+		case IMPLANT_TAG_BEAT:
+		case IMPLANT_TAG_QUALITY:
+		case IMPLANT_TAG_RESTART:
+		case IMPLANT_TAG_QUEUES:
+		case IMPLANT_TAG_STATS:
+			txClass = TXQUEUE_URGENT;
+			break;
+	}
+	
+	/* A record that does not fit is dropped whole rather than overwriting
+	 * bytes waiting to be sent, the predictor and the packing restart with
+	 * the next frame */
+	LogicAnalyzer_TRACE(TRACE_ENQUEUE);
+	if (!TxQueue_Put(txClass, tag, frameSeq, data, length) && (txClass == TXQUEUE_BULK)) {
+		if (dropped < 0xFF) { dropped = dropped + 1; }
+		droppedTotal = droppedTotal + 1;
+		keyNext = 1;
+	}
+	LogicAnalyzer_TRACE(TRACE_ENQUEUE | TRACE_EXIT);
+}
+
+void Implant_PumpRadio() {
+	unsigned char txClass, size, count, room, bulkRoom, seq;
+	
+	LogicAnalyzer_TRACE(TRACE_PUMP);
+	
+	/* Move whole records to the radio ring, keeping few bulk bytes ahead of
+	 * the next urgent record */
+	while (1) {
+		count = CC110L_TX_GetCount();
+		room = Fec_GetRoom(CC110L_TX_GetFree());
+		
+		/* A record started is finished first */
+		if (pumpLeft != 0) {
+			Implant_PumpRecord(room);
+			if (pumpLeft != 0) { break; }
+			continue;
+		}
+		
+		/* An empty ring takes the next record whatever its size. A record
+		 * larger than the ring, an ENVELOPE with the Hamming code, is written
+		 * as the ring drains */
+		bulkRoom = 0;
+		if (count == 0) {
+			room = 0xFF;
+			bulkRoom = 0xFF;
+		} else if (count < TXQUEUE_BULK_WINDOW) {
+			bulkRoom = Fec_GetRoom(TXQUEUE_BULK_WINDOW - count);
+		}
+		
+		/* Leave room for the ARQ header and check around the record */
+		if (Arq_IsEnabled()) {
+			if (room != 0xFF) { room = (room > IMPLANT_RECORD_OVERHEAD) ? room - IMPLANT_RECORD_OVERHEAD : 0; }
+			if (bulkRoom != 0xFF) { bulkRoom = (bulkRoom > IMPLANT_RECORD_OVERHEAD) ? bulkRoom - IMPLANT_RECORD_OVERHEAD : 0; }
+		}
+		
+		txClass = TxQueue_Select(room, bulkRoom, &size);
+		if (txClass != TXQUEUE_NONE) {
+			pumpSource = txClass;
+			pumpLeft = size;
+			pumpStore = Arq_IsEnabled();
+			pumpWrapped = 0;
+			if (Arq_IsEnabled()) { Implant_WriteArqHeader(Arq_Begin(size), size); }
+			continue;
+		}
+		
+		/* Idle slot: send again what the relay missed, new records first */
+		if (!Arq_IsEnabled() || (TxQueue_GetCount(TXQUEUE_URGENT) != 0) || (TxQueue_GetCount(TXQUEUE_BULK) != 0)) { break; }
+		if (!Arq_SelectRepeat((bulkRoom < room) ? bulkRoom : room, &seq, &size)) { break; }
+		
+		pumpSource = IMPLANT_PUMP_REPEAT;
+		pumpLeft = size;
+		pumpStore = 0;
+		Implant_WriteArqHeader(seq, size);
+	}
+	
+	/* Complete the FEC block before the radio runs out of coded bytes */
+	if ((CC110L_TX_GetCount() < FEC_CODED_SIZE) && Fec_Complete()) { Implant_WriteBlock(); }
+	Stats_SetTxLevel(CC110L_TX_GetCount());
+	LogicAnalyzer_TRACE(TRACE_PUMP | TRACE_EXIT);
+}
+
+void Implant_PumpRecord(unsigned char room) {
+	unsigned char data;
+	
+	while ((pumpLeft != 0) && (room != 0)) {
+		if (pumpWrapped && (pumpLeft == IMPLANT_RECORD_CHECK)) {
+			data = pumpCheck;
+		} else if (pumpSource == IMPLANT_PUMP_REPEAT) {
+			data = Arq_ReadByte();
+		} else {
+			data = TxQueue_ReadByte(pumpSource);
+			if (pumpStore) { Arq_StoreByte(data); }
+		}
+		pumpCheck = TxQueue_Crc8(pumpCheck, data);
+		Implant_WriteRadio(data);
+		pumpLeft = pumpLeft - 1;
+		room = room - 1;
+	}
+	if (pumpLeft == 0) {
+		pumpSource = TXQUEUE_NONE;
+		pumpWrapped = 0;
+	}
+}
+
+void Implant_WriteArqHeader(unsigned char seq, unsigned char size) {
+	Implant_WriteRadio(IMPLANT_RECORD_SYNC);
+	Implant_WriteRadio(IMPLANT_TAG_ARQ);
+	Implant_WriteRadio(seq);
+	Implant_WriteRadio(size);
+	
+	/* The record carried is pumped next, then the check of the ARQ record */
+	pumpCheck = TxQueue_Crc8(TxQueue_Crc8(TxQueue_Crc8(0, IMPLANT_TAG_ARQ), seq), size);
+	pumpWrapped = 1;
+	pumpLeft = pumpLeft + IMPLANT_RECORD_CHECK;
+}
+
+void Implant_WriteRadio(unsigned char data) {
+	if (Fec_GetCode() == FEC_NONE) {
+		CC110L_TX_WriteBuffer(data);
+	} else if (Fec_PutByte(data)) {
+		Implant_WriteBlock();
+	}
+}
+
+void Implant_WriteBlock() {
+	unsigned char* block = Fec_GetBlock();
+	unsigned char i;
+	
+	for (i = 0; i < FEC_CODED_SIZE; i = i + 1) { CC110L_TX_WriteBuffer(block[i]); }
+}
+
+void Implant_SendQueueStats() {
+	TxQueue_Stats stats;
+	unsigned char report[TXQUEUE_CLASSES * 6];
+	unsigned char c;
+	
+	for (c = 0; c < TXQUEUE_CLASSES; c = c + 1) {
+		TxQueue_GetStats(c, &stats);
+		report[(c * 6) + 0] = stats.maxDepth;
+		report[(c * 6) + 1] = stats.maxLatency;
+		report[(c * 6) + 2] = (unsigned char) (stats.dropped >> 8);
+		report[(c * 6) + 3] = (unsigned char) stats.dropped;
+		report[(c * 6) + 4] = (unsigned char) (stats.records >> 8);
+		report[(c * 6) + 5] = (unsigned char) stats.records;
+	}
+	Implant_SendRecord(IMPLANT_TAG_QUEUES, report, sizeof(report));
+	reportTicks = 0;
+}
+
+void Implant_DumpProfile() {
+#ifdef PROFILER_ENABLE
+	profileNext = 0;
+#endif
+}
+
+void Implant_SendProfile() {
+#ifdef PROFILER_ENABLE
+	unsigned char record[PROFILER_RECORD_SIZE];
+	unsigned char length;
+	
+	/* One record per frame, the probes that did not run are skipped */
+	while (profileNext < PROFILER_PROBES) {
+		length = Profiler_GetRecord(profileNext, record);
+		profileNext = profileNext + 1;
+		if (length != 0) {
+			Implant_SendRecord(IMPLANT_TAG_PROFILE, record, length);
+			return;
+		}
+	}
+#endif
+}
+
+void Implant_QueryStats() {
+	Stats_Block* block = Stats_GetBlock();
+	Arq_Stats arq;
+	unsigned char record[STATS_RECORD_SIZE];
+	unsigned char length;
+	
+	/* Counters kept by the other modules, in one record */
+	Arq_GetStats(&arq);
+	block->headerErrors = ADS1298_GetHeaderErrors();
+	block->maxRecovery = ADS1298_GetMaxRecoveryFrames();
+	block->stateMismatches = ADS1298_GetStateMismatches();
+	block->txOverwrites = CC110L_TX_GetOverflows();
+	block->rcErrors = Command_GetErrors();
+	block->arqRejects = arq.rejected;
+	block->retransmits = arq.repeated;
+	block->mode = mode;
+	block->encoding = encoding;
+	block->quality = Quality_GetLevel();
+	
+	length = Stats_GetRecord(record);
+	Implant_SendRecord(IMPLANT_TAG_STATS, record, length);
+	Implant_PumpRadio();
+}
+
+void Implant_ReadCommands() {
+	/* The bytes were stored by the interrupt of the SPI link */
+	while (CC110L_RC_isDataAvailable()) { Command_AddByte(CC110L_RC_ReadBuffer()); }
+}
+
+void Implant_CommandMode(unsigned char* data) {
+	Implant_ChangeMode(data[0], data + 1);
+}
+
+void Implant_CommandEncoding(unsigned char* data) {
+	if (data[0] <= IMPLANT_ENCODING_ENVELOPE) { Implant_SetEncoding(data[0]); }
+}
+
+void Implant_CommandPacking(unsigned char* data) {
+	Packer_SetChannel(data[0], data[1], data[2]);
+}
+
+void Implant_CommandDecimation(unsigned char* data) {
+	Implant_SetDecimation(data[0]);
+}
+
+void Implant_CommandFilters(unsigned char* data) {
+	Implant_SetFilters(data[0], data[1]);
+}
+
+void Implant_CommandDetector(unsigned char* data) {
+	Implant_SetDetector(data[0], data[1]);
+}
+
+void Implant_CommandCapture(unsigned char* data) {
+	Implant_SetCapture(((unsigned int) data[0] << 8) | data[1], ((unsigned int) data[2] << 8) | data[3], data[4]);
+}
+
+void Implant_CommandTrigger(unsigned char* data) {
+	Implant_TriggerCapture();
+}
+
+void Implant_CommandThreshold(unsigned char* data) {
+	Capture_SetThreshold(data[0], ((long) data[1] << 16) | ((long) data[2] << 8) | (long) data[3]);
+}
+
+void Implant_CommandEnvelope(unsigned char* data) {
+	Implant_SetEnvelope(data[0]);
+}
+
+void Implant_CommandQuality(unsigned char* data) {
+	Implant_SetQuality(data[0], ((unsigned int) data[1] << 8) | data[2]);
+}
+
+void Implant_CommandQualityAck(unsigned char* data) {
+	Implant_Acknowledge(data[0]);
+}
+
+void Implant_CommandArq(unsigned char* data) {
+	Implant_SetArq(data[0]);
+}
+
+void Implant_CommandFec(unsigned char* data) {
+	Implant_SetFec(data[0]);
+}
+
+void Implant_CommandProfile(unsigned char* data) {
+	Implant_DumpProfile();
+}
+
+void Implant_CommandStats(unsigned char* data) {
+	Implant_QueryStats();
+}
+
+void Implant_CommandCalibrate(unsigned char* data) {
+	/* The devices must be powered up */
+	if (mode != 0x00) { Implant_Calibrate(data[0]); }
+}
+
+void Implant_SendLayout() {
+	unsigned char masks[ADS1298_DEVICE_COUNT];
+	unsigned char device;
+	
+	/* Sent with the sequence number of the next frame */
+	for (device = 1; device <= ADS1298_DEVICE_COUNT; device = device + 1) {
+		masks[device - 1] = ADS1298_GetChannels(device);
+	}
+	Implant_SendRecord(IMPLANT_TAG_LAYOUT, masks, sizeof(masks));
+}
+
+void Implant_SendStatusChanges() {
+	unsigned char event[1 + ADS1298_STATUS_SIZE];
+	unsigned char changes, device;
+	
+	/* Only forward the devices whose lead-off or GPIO state changed */
+	changes = ADS1298_GetStatusChanges();
+	if (changes != 0) { Capture_Trigger(CAPTURE_CAUSE_LEADOFF); }
+	for (device = 1; changes != 0; device = device + 1) {
+		if (changes & 0x01) {
+			event[0] = device;
+			ADS1298_GetStatus(device, event + 1);
+			Implant_SendRecord(IMPLANT_TAG_STATUS, event, sizeof(event));
+		}
+		changes = changes >> 1;
+	}
 }
 
 unsigned char Implant_ChangeMode(unsigned char cmd, unsigned char* data) {
 	unsigned char status;
-	switch (cmd) {
+	switch (mode) {
 		
 		/* Mode 0x00
 		 * Device is powered OFF.
 		 */
 		case 0x00:
-			if (cmd) {
+			if (cmd == IMPLANT_MODE_NEXT) {
 				status = ADS1298_PowerUp();
 				if (status) mode = 0x01;
-			} else {
-				mode = mode;
 			}
+			break;
 			
 		/* Mode 0x01
 		 * Device is powered ON. All channels are turned off and shorted. Device is idle.
@@ -78,18 +925,17 @@ unsigned char Implant_ChangeMode(unsigned char cmd, unsigned char* data) {
 		case 0x01:
 			switch (cmd) {
 				/* Turn off the device */
-				case 0x00:
+				case IMPLANT_MODE_BACK:
 					mode = 0x00;
+					break;
 					
-				/* Select the channel */
-				case 0x01:
+				/* Select the channels */
+				case IMPLANT_MODE_CHANNELS:
 					ADS1298_SetChannels(data);
-					mode = 0x01;
-					
-				/* No channels selected */
-				default:
-					mode = mode;
+					mode = 0x02;
+					break;
 			}
+			break;
 		
 		/* Mode 0x02
 		 * Device is powered ON. Channel(s) is/are turned on. Device is idle.
@@ -97,47 +943,54 @@ unsigned char Implant_ChangeMode(unsigned char cmd, unsigned char* data) {
 		case 0x02:
 			switch (cmd) {
 				/* Turn off the channels */
-				case 0x00:
+				case IMPLANT_MODE_BACK:
 					ADS1298_SetChannels(data);
 					mode = 0x01;
+					break;
 					
-				/* Start data conversions */
-				case 0x01:
-					mode = 0x03;
+				/* Start data conversions, again after a cold boot */
+				case IMPLANT_MODE_NEXT:
+					config.streaming = 1;
+					Implant_StartStreaming();
+					Implant_SaveConfig();
+					break;
 				
 				/* Select different channels */
-				default:
+				case IMPLANT_MODE_CHANNELS:
 					ADS1298_SetChannels(data);
-					mode = mode;
+					break;
 			}
+			break;
 			
 		/* Mode 0x03
 		 * Device is converting data. Data is being collected.
 		 */
 		case 0x03:
 			switch (cmd) {
-				/* Stop collecting data */
-				case 0x00:
-					mode = 0x02;
+				/* Stop collecting data, the configuration is saved idle */
+				case IMPLANT_MODE_BACK:
+					config.streaming = 0;
+					Implant_StopStreaming();
+					break;
 					
 				/* Send collected data to the relay box */
-				case 0x01:
+				case IMPLANT_MODE_NEXT:
 					mode = 0x04;
+					break;
 				
-				/* Change the channel */
-				default:
-					mode = mode;
+				/* Change the channels without stopping the conversions */
+				case IMPLANT_MODE_CHANNELS:
+					ADS1298_RequestChannels(data);
+					break;
 			}
+			break;
 		
 		/* Mod 0x04
 		 * Device is sending data out. Currently, PIC to PIC communication.
 		 */
 		case 0x04:
-			if (cmd) {
-				mode = 0x03;
-			} else {
-				mode = mode;
-			}
+			if (cmd == IMPLANT_MODE_NEXT) { mode = 0x03; }
+			break;
 	}
 	
 	return mode;
@@ -14,6 +14,60 @@
 #include "CommCC110L.h"
 #include "CC110L.h"
 #include "LogicAnalyzer.h"
+#include "Protocol.h"
+#include "Config.h"
+#include "Supervisor.h"
+#include "RiceCoder.h"
+#include "Packer.h"
+#include "Decimator.h"
+#include "FilterBank.h"
+#include "QrsDetector.h"
+#include "Capture.h"
+#include "Envelope.h"
+#include "Quality.h"
+#include "TxQueue.h"
+#include "Arq.h"
+#include "Fec.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "Command.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* RAM budget of the PIC18F46K22, 3896 bytes. Largest users with the default
+ * build settings, in bytes:
+ *   Capture ring, CAPTURE_BANKS of 256             512
+ *   ARQ copies and window                          560
+ *   QRS detector filters                           460
+ *   FilterBank, FILTERBANK_CHANNELS of 30          240
+ *   Decimator, DECIMATOR_CHANNELS of 52            416
+ *   CC110L transmit and receive rings              224
+ *   Transmit queues                                208
+ *   Rice coder, 16 channels                        208
+ *   Envelope, 16 channels                          192
+ *   Other variables                               ~300
+ *   Software stack, one bank                       256
+ *   Total                                        ~3576
+ * PROFILER_ENABLE adds 224 bytes, every 4 more decimated channels one bank of
+ * 208 bytes and 8 more filtered channels one bank of 240 bytes. Lower
+ * CAPTURE_BANKS by as many banks.
+ */
+
+/* Frames read between two QUEUES records */
+#define IMPLANT_QUEUE_REPORT		2048
+
+/* Source of the record written to the radio ring, besides the TXQUEUE_* classes */
+#define IMPLANT_PUMP_REPEAT			TXQUEUE_CLASSES	// copy kept by the ARQ
+
+/* Encoding of the streamed frames */
+#define IMPLANT_ENCODING_RAW		0x00	// FRAME records only
+#define IMPLANT_ENCODING_RICE		0x01	// lossless RICE records between FRAME key frames
+#define IMPLANT_ENCODING_PACKED		0x02	// PACKED records, bit depth set per channel
+#define IMPLANT_ENCODING_BEATS		0x03	// BEAT records only, no frames
+#define IMPLANT_ENCODING_CAPTURE	0x04	// frames captured, FRAME records only around a trigger
+#define IMPLANT_ENCODING_ENVELOPE	0x05	// ENVELOPE records, one per window of frames
 
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
@@ -21,8 +75,124 @@
 
 unsigned char Implant_Initialize(unsigned char* channels);
 
+void Implant_SaveConfig(void);
+
+unsigned char Implant_IsStreamSaved(void);
+
+void Implant_Resume(void);
+
+void Implant_StartStreaming(void);
+
+void Implant_StreamFrame(void);
+
+void Implant_ChangeLayout(void);
+
+unsigned char Implant_GetChannelCount(void);
+
+void Implant_SendFrame(unsigned char* data, unsigned char length);
+
+void Implant_StopStreaming(void);
+
+void Implant_Task(void);
+
+void Implant_SetEncoding(unsigned char mode);
+
+unsigned char Implant_SetDecimation(unsigned char factor);
+
+unsigned char Implant_SetFilters(unsigned char mains, unsigned char filters);
+
+unsigned char Implant_SetDetector(unsigned char lead, unsigned char shift);
+
+void Implant_SendBeat(void);
+
+void Implant_SetCapture(unsigned int pre, unsigned int post, unsigned char triggers);
+
+void Implant_TriggerCapture(void);
+
+void Implant_UploadCapture(void);
+
+unsigned char Implant_SetEnvelope(unsigned char frames);
+
+void Implant_SendEnvelope(void);
+
+void Implant_SetQuality(unsigned char enable, unsigned int hold);
+
+void Implant_Acknowledge(unsigned char seq);
+
+void Implant_SetArq(unsigned char enable);
+
+void Implant_ArqAcknowledge(unsigned char* ack);
+
+unsigned char Implant_SetFec(unsigned char code);
+
+void Implant_ApplyQuality(void);
+
+void Implant_SendPacking(unsigned char channelCount);
+
 void Implant_StreamData(unsigned char frameCnt);
 
+void Implant_Calibrate(unsigned char frameCnt);
+
+void Implant_SendRecord(unsigned char tag, unsigned char* data, unsigned char length);
+
+void Implant_PumpRadio(void);
+
+void Implant_PumpRecord(unsigned char room);
+
+void Implant_WriteArqHeader(unsigned char seq, unsigned char size);
+
+void Implant_WriteRadio(unsigned char data);
+
+void Implant_WriteBlock(void);
+
+void Implant_SendQueueStats(void);
+
+void Implant_DumpProfile(void);
+
+void Implant_SendProfile(void);
+
+void Implant_QueryStats(void);
+
+void Implant_SendStatusChanges(void);
+
+void Implant_SendLayout(void);
+
 unsigned char Implant_ChangeMode(unsigned char cmd, unsigned char* data);
 
+void Implant_ReadCommands(void);
+
+void Implant_CommandMode(unsigned char* data);
+
+void Implant_CommandEncoding(unsigned char* data);
+
+void Implant_CommandPacking(unsigned char* data);
+
+void Implant_CommandDecimation(unsigned char* data);
+
+void Implant_CommandFilters(unsigned char* data);
+
+void Implant_CommandDetector(unsigned char* data);
+
+void Implant_CommandCapture(unsigned char* data);
+
+void Implant_CommandTrigger(unsigned char* data);
+
+void Implant_CommandThreshold(unsigned char* data);
+
+void Implant_CommandEnvelope(unsigned char* data);
+
+void Implant_CommandQuality(unsigned char* data);
+
+void Implant_CommandQualityAck(unsigned char* data);
+
+void Implant_CommandArq(unsigned char* data);
+
+void Implant_CommandFec(unsigned char* data);
+
+void Implant_CommandProfile(unsigned char* data);
+
+void Implant_CommandStats(unsigned char* data);
+
+void Implant_CommandCalibrate(unsigned char* data);
+
 #endif /* _IMPLANT_H_ */
@@ -18,19 +18,12 @@
 unsigned char LogicAnalyzer_Initialize(){
     
     /* It outputs 1 byte and a clock as follows:
-     * Data bits 0-3  output on Port E 0-2 and Port A 4
-     * Data bits 4-7  output on Port B 4-7
-     * Clock output on Port A 5
+     * Data bits 0-7  output on Port B 0-7
+     * Clock output on Port D 7
      */
-    LogicAnalyzer_BIT7_DIR = 0; // most significant bit (bit 7)
-    LogicAnalyzer_BIT6_DIR = 0; // bit 6
-    LogicAnalyzer_BIT5_DIR = 0; // bit 5
-    LogicAnalyzer_BIT4_DIR = 0; // bit 4
-    LogicAnalyzer_BIT3_DIR = 0; // bit 3
-    LogicAnalyzer_BIT2_DIR = 0; // bit 2
-    LogicAnalyzer_BIT1_DIR = 0; // bit 1
-    LogicAnalyzer_BIT0_DIR = 0; // least significant bit (bit 0)
+    LogicAnalyzer_PORT_DIR = 0x00;
     LogicAnalyzer_CLK_DIR = 0;
+    LogicAnalyzer_CLK = 0;
 	
 	return 1;
 }
@@ -43,17 +36,8 @@ unsigned char LogicAnalyzer_Initialize(){
  * @return None.
 *******************************************************************************/
 void LogicAnalyzer_OutputChar(unsigned char data) {
-    unsigned char i;
-    
-    /* Turn on the appropriate bits */
-    LogicAnalyzer_BIT7 = (data >> 7) & 0x01; // most significant bit (bit 7)
-    LogicAnalyzer_BIT6 = (data >> 6) & 0x01; // bit 6
-    LogicAnalyzer_BIT5 = (data >> 5) & 0x01; // bit 5
-    LogicAnalyzer_BIT4 = (data >> 4) & 0x01; // bit 4
-    LogicAnalyzer_BIT3 = (data >> 3) & 0x01; // bit 3
-    LogicAnalyzer_BIT2 = (data >> 2) & 0x01; // bit 2
-    LogicAnalyzer_BIT1 = (data >> 1) & 0x01; // bit 1
-    LogicAnalyzer_BIT0 = (data >> 0) & 0x01; // least significant bit (bit 0)
+    /* Put the whole byte out at once */
+    LogicAnalyzer_PORT = data;
     
     /* Toggle clock bit */
     LogicAnalyzer_CLK = 1;
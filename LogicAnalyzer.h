@@ -8,52 +8,39 @@
 #define	LOGICANALYZER_H
 
 #include <p18f46k22.h>
+#include "Protocol.h"
 
 /******************************************************************************/
 /* LOGIC ANALYZER PINS  													  */
 /******************************************************************************/
 
-#define LogicAnalyzer_BIT7          LATBbits.LATB7
-#define LogicAnalyzer_BIT7_DIR      TRISBbits.RB7
-
-#define LogicAnalyzer_BIT6          LATBbits.LATB6
-#define LogicAnalyzer_BIT6_DIR      TRISBbits.RB6
-
-#define LogicAnalyzer_BIT5          LATBbits.LATB5
-#define LogicAnalyzer_BIT5_DIR      TRISBbits.RB5
-
-#define LogicAnalyzer_BIT4          LATBbits.LATB4
-#define LogicAnalyzer_BIT4_DIR      TRISBbits.RB4
-
-#define LogicAnalyzer_BIT3          LATBbits.LATB3
-#define LogicAnalyzer_BIT3_DIR      TRISBbits.RB3
-
-#define LogicAnalyzer_BIT2          LATBbits.LATB2
-#define LogicAnalyzer_BIT2_DIR      TRISBbits.RB2
-
-#define LogicAnalyzer_BIT1          LATBbits.LATB1
-#define LogicAnalyzer_BIT1_DIR      TRISBbits.RB1
-
-#define LogicAnalyzer_BIT0          LATBbits.LATB0
-#define LogicAnalyzer_BIT0_DIR      TRISBbits.RB0
+/* The byte is output on the whole of port B, in one store, and latched by
+ * the analyzer on the rising edge of the clock */
+#define LogicAnalyzer_PORT          LATB
+#define LogicAnalyzer_PORT_DIR      TRISB
 
 #define LogicAnalyzer_CLK           LATDbits.LATD7
 #define LogicAnalyzer_CLK_DIR       TRISDbits.RD7
 
-//#define LogicAnalyzer_BIT3          LATAbits.LATA4
-//#define LogicAnalyzer_BIT3_DIR      TRISAbits.RA4
-
-//#define LogicAnalyzer_BIT2          LATEbits.LATE2
-//#define LogicAnalyzer_BIT2_DIR      TRISEbits.RE2
-
-//#define LogicAnalyzer_BIT1          LATEbits.LATE1
-//#define LogicAnalyzer_BIT1_DIR      TRISEbits.RE1
-
-//#define LogicAnalyzer_BIT0          LATEbits.LATE0
-//#define LogicAnalyzer_BIT0_DIR      TRISEbits.RE0
+/******************************************************************************/
+/* TRACE EVENTS																  */
+/******************************************************************************/
 
-//#define LogicAnalyzer_CLK           LATAbits.LATA5
-//#define LogicAnalyzer_CLK_DIR       TRISAbits.RA5
+/* Set to 1 to strobe the TRACE_* events of Protocol.h on the analyzer port.
+ * A marker is a literal store to LATB and the clock pulse, 3 instructions,
+ * the markers compile to nothing otherwise. The ISR markers overwrite the
+ * port, a marker of the main loop interrupted between its store and its
+ * clock reads as the ISR exit.
+ */
+#ifndef LOGICANALYZER_TRACING
+#define LOGICANALYZER_TRACING		0
+#endif
+
+#if LOGICANALYZER_TRACING
+#define LogicAnalyzer_TRACE(event)  { LogicAnalyzer_PORT = (event); LogicAnalyzer_CLK = 1; LogicAnalyzer_CLK = 0; }
+#else
+#define LogicAnalyzer_TRACE(event)
+#endif
 
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
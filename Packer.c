@@ -0,0 +1,196 @@
+/***************************************************************************//**
+ *   @file   Packer.c
+ *   @brief  Implementation of the bit-depth reduction packer of the frames.
+ *           Each channel keeps only the bits it uses, the samples are packed
+ *           with no padding. The packed format is described in Protocol.h.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Packer.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static unsigned char channelBits[PACKER_MAX_CHANNELS] = {24, 24, 24, 24, 24, 24, 24, 24,
+														 24, 24, 24, 24, 24, 24, 24, 24};
+static unsigned char channelShift[PACKER_MAX_CHANNELS];
+static unsigned char limitBits = PACKER_MAX_BITS;	// bits left by the quality ladder
+static unsigned char settingsChanged = 1;
+
+/* Bit writer */
+static unsigned char* outPtr;
+static unsigned int bitBuffer;
+static unsigned char bitCount;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Writes up to 8 bits, MSB first.
+ *
+ * @param	bits - Bits to write, right aligned.
+ * @param	count - Number of bits to write, from 0 to 8.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Packer_PutBits(unsigned char bits, unsigned char count) {
+	bitBuffer = (bitBuffer << count) | bits;
+	bitCount = bitCount + count;
+	
+	if (bitCount >= 8) {
+		bitCount = bitCount - 8;
+		*outPtr++ = (unsigned char) (bitBuffer >> bitCount);
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Gets the packing of a channel within the limit: a channel keeping
+ *          more bits than the limit drops its least significant ones.
+ *
+ * @param	channel - Channel index in the frame, from 0.
+ * @param	bits - Receives the bits kept.
+ * @param	shift - Receives the right shift.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Packer_GetChannel(unsigned char channel, unsigned char* bits, unsigned char* shift) {
+	*bits = channelBits[channel];
+	*shift = channelShift[channel];
+	if (*bits > limitBits) {
+		*shift = *shift + (*bits - limitBits);
+		*bits = limitBits;
+		if (*shift > 23) { *shift = 23; }
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Sets the packing of a channel.
+ *
+ * @param	channel - Channel index in the frame, from 0.
+ * @param	bits - Bits kept, from PACKER_MIN_BITS to PACKER_MAX_BITS.
+ * @param	shift - Right shift applied before keeping the bits, 24 - bits
+ *                  keeps the most significant bits.
+ *
+ * @return	1 - settings accepted, 0 - invalid settings.
+*******************************************************************************/
+unsigned char Packer_SetChannel(unsigned char channel, unsigned char bits, unsigned char shift) {
+	if ((channel >= PACKER_MAX_CHANNELS) || (bits < PACKER_MIN_BITS) ||
+		(bits > PACKER_MAX_BITS) || (shift > 23)) { return 0; }
+	
+	channelBits[channel] = bits;
+	channelShift[channel] = shift;
+	settingsChanged = 1;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Limits the bits kept by every channel, over the packing set by
+ *          the relay, which is kept and applies again once the limit is
+ *          lifted.
+ *
+ * @param	bits - Most bits kept, from PACKER_MIN_BITS to PACKER_MAX_BITS,
+ *                 PACKER_MAX_BITS lifts the limit.
+ *
+ * @return	None.
+*******************************************************************************/
+void Packer_Limit(unsigned char bits) {
+	if ((bits < PACKER_MIN_BITS) || (bits > PACKER_MAX_BITS) || (bits == limitBits)) { return; }
+	
+	limitBits = bits;
+	settingsChanged = 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the packing settings as sent in a PACKING record.
+ *
+ * @param	channelCount - Number of channels in the frame.
+ * @param	out - Buffer receiving bits and shift of every channel.
+ *
+ * @return	Number of bytes written to out.
+*******************************************************************************/
+unsigned char Packer_GetSettings(unsigned char channelCount, unsigned char* out) {
+	unsigned char i;
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		Packer_GetChannel(i, &out[(i * 2) + 0], &out[(i * 2) + 1]);
+	}
+	
+	return channelCount * 2;
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether the settings changed since the last call.
+ *
+ * @param	None.
+ *
+ * @return	1 - settings changed, 0 - settings unchanged.
+*******************************************************************************/
+unsigned char Packer_GetChange() {
+	unsigned char changed = settingsChanged;
+	
+	settingsChanged = 0;
+	return changed;
+}
+
+/***************************************************************************//**
+ * @brief	Packs a frame of 24-bit samples. Each sample is shifted right
+ *          (rounding towards minus infinity like the ADC LSBs it drops),
+ *          saturated to the bits of its channel and written MSB first.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame, at most
+ *                         PACKER_MAX_CHANNELS.
+ * @param	out - Buffer of PACKER_MAX_BYTES receiving the packed samples.
+ * @param	flags - Set to PACKER_FLAG_CLIPPED if a sample was saturated.
+ *
+ * @return	Number of bytes written to out.
+*******************************************************************************/
+unsigned char Packer_PackFrame(unsigned char* frame, unsigned char channelCount,
+							   unsigned char* out, unsigned char* flags) {
+	long sample, limit;
+	unsigned char i, bits, shift, count;
+	
+	outPtr = out;
+	bitBuffer = 0;
+	bitCount = 0;
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		Packer_GetChannel(i, &bits, &shift);
+		
+		/* Sign-extend the 24-bit sample and shift it arithmetically */
+		sample = ((long) frame[i * 3] << 16) | ((long) frame[(i * 3) + 1] << 8) | (long) frame[(i * 3) + 2];
+		if (frame[i * 3] & 0x80) { sample = sample - 0x1000000L; }
+		if (sample < 0) {
+			sample = -((-sample - 1) >> shift) - 1;
+		} else {
+			sample = sample >> shift;
+		}
+		
+		/* Saturate to the range of the packed bits */
+		limit = (long) 0x01 << (bits - 1);
+		if (sample >= limit) {
+			sample = limit - 1;
+			*flags |= PACKER_FLAG_CLIPPED;
+		} else if (sample < -limit) {
+			sample = -limit;
+			*flags |= PACKER_FLAG_CLIPPED;
+		}
+		
+		/* Leading partial byte, then whole bytes */
+		count = bits & 0x07;
+		while (bits > 0) {
+			bits = bits - count;
+			Packer_PutBits((unsigned char) ((unsigned long) sample >> bits) & ((0x01 << count) - 1), count);
+			count = 8;
+		}
+	}
+	
+	/* Pad the last byte with zeros */
+	if (bitCount > 0) { Packer_PutBits(0x00, 8 - bitCount); }
+	
+	return (unsigned char) (outPtr - out);
+}
@@ -0,0 +1,41 @@
+/***************************************************************************//**
+ *   @file   Packer.h
+ *   @brief  Header file of the bit-depth reduction packer of the frames.
+*******************************************************************************/
+#ifndef _PACKER_H_
+#define _PACKER_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define PACKER_MAX_CHANNELS			16		// ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT
+
+/* Size of a packed frame with every channel at 24 bits */
+#define PACKER_MAX_BYTES			(PACKER_MAX_CHANNELS * 3)
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Sets the packing of a channel */
+unsigned char Packer_SetChannel(unsigned char channel, unsigned char bits, unsigned char shift);
+
+/* Limits the bits kept by every channel */
+void Packer_Limit(unsigned char bits);
+
+/* Gets the packing settings as sent in a PACKING record */
+unsigned char Packer_GetSettings(unsigned char channelCount, unsigned char* out);
+
+/* Tells whether the settings changed since the last call */
+unsigned char Packer_GetChange(void);
+
+/* Packs a frame of 24-bit samples */
+unsigned char Packer_PackFrame(unsigned char* frame, unsigned char channelCount,
+							   unsigned char* out, unsigned char* flags);
+
+#endif /* _PACKER_H_ */
@@ -0,0 +1,170 @@
+/***************************************************************************//**
+ *   @file   Profiler.c
+ *   @brief  Implementation of the profiler timing the probes of the firmware
+ *           on a free-running timer. Every probe keeps its count, minimum,
+ *           maximum, mean and a log2 histogram of its times, the time taken
+ *           by the timer reads themselves is taken off.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#if defined(__18CXX)
+#include <p18f46k22.h>
+#else
+#include <time.h>
+#endif
+
+#include "Profiler.h"
+
+#ifdef PROFILER_ENABLE
+
+/*****************************************************************************/
+/* TYPES																	 */
+/*****************************************************************************/
+
+/* Statistics of a probe */
+typedef struct {
+	unsigned int count;
+	unsigned int min, max;
+	unsigned long sum;
+	unsigned char buckets[PROFILER_BUCKETS];
+} Profiler_Probe;
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+unsigned int Profiler_Start[PROFILER_PROBES];
+static Profiler_Probe probes[PROFILER_PROBES];
+static unsigned int overhead = 0;				// ticks between two timer reads
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Clears the statistics of a probe.
+ *
+ * @param	p - Probe to clear.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Profiler_Clear(Profiler_Probe* p) {
+	unsigned char b;
+	
+	p->count = 0;
+	p->min = ~0u;
+	p->max = 0;
+	p->sum = 0;
+	for (b = 0; b < PROFILER_BUCKETS; b = b + 1) { p->buckets[b] = 0; }
+}
+
+/***************************************************************************//**
+ * @brief	Starts the timer, measures the cost of a timer read and clears
+ *          the statistics. Timer1 runs from FOSC/4 without a prescaler and
+ *          reads its 16 bits at once.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Profiler_Initialize() {
+	unsigned int start;
+	unsigned char i;
+	
+#if defined(__18CXX)
+	T1CON = 0b00000011;		// FOSC/4, 1:1, 16-bit reads, on
+#endif
+	
+	start = Profiler_Now();
+	overhead = Profiler_Now() - start;
+	
+	for (i = 0; i < PROFILER_PROBES; i = i + 1) { Profiler_Clear(&probes[i]); }
+}
+
+/***************************************************************************//**
+ * @brief	Reads the timer.
+ *
+ * @param	None.
+ *
+ * @return	Ticks of PROFILER_TICK_NS, wrapping around.
+*******************************************************************************/
+unsigned int Profiler_Now() {
+	unsigned int ticks;
+	
+#if defined(__18CXX)
+	ticks = TMR1L;						// reading TMR1L latches TMR1H
+	ticks = ticks | ((unsigned int) TMR1H << 8);
+#else
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ticks = (unsigned int)((unsigned long) now.tv_sec * 1000000000UL + (unsigned long) now.tv_nsec);
+#endif
+	
+	return ticks;
+}
+
+/***************************************************************************//**
+ * @brief	Counts the time of a probe since it started.
+ *
+ * @param	probe - PROFILER_* probe of Protocol.h.
+ * @param	start - Timer read when the probe started.
+ *
+ * @return	None.
+*******************************************************************************/
+void Profiler_Record(unsigned char probe, unsigned int start) {
+	Profiler_Probe* p = &probes[probe];
+	unsigned int ticks = Profiler_Now() - start;
+	unsigned int rest;
+	unsigned char bucket = 0;
+	
+	ticks = (ticks > overhead) ? ticks - overhead : 0;
+	if (p->count == 0xFFFF) { return; }
+	
+	p->count = p->count + 1;
+	p->sum = p->sum + ticks;
+	if (ticks < p->min) { p->min = ticks; }
+	if (ticks > p->max) { p->max = ticks; }
+	
+	/* The bucket is the position of the highest bit set */
+	for (rest = ticks >> 1; (rest != 0) && (bucket < PROFILER_BUCKETS - 1); rest = rest >> 1) { bucket = bucket + 1; }
+	if (p->buckets[bucket] != 0xFF) { p->buckets[bucket] = p->buckets[bucket] + 1; }
+}
+
+/***************************************************************************//**
+ * @brief	Gets the statistics of a probe as the payload of a PROFILE record
+ *          and clears them.
+ *
+ * @param	probe - PROFILER_* probe of Protocol.h.
+ * @param	record - Receives PROFILER_RECORD_SIZE bytes.
+ *
+ * @return	Number of bytes written, 0 if the probe did not run.
+*******************************************************************************/
+unsigned char Profiler_GetRecord(unsigned char probe, unsigned char* record) {
+	Profiler_Probe* p = &probes[probe];
+	unsigned int field[4];
+	unsigned char b;
+	
+	if (p->count == 0) { return 0; }
+	
+	/* Host times longer than 16 bits are saturated */
+	field[0] = p->count;
+	field[1] = p->min;
+	field[2] = p->max;
+	field[3] = (unsigned int)(p->sum / p->count);
+	record[0] = probe;
+	record[1] = (unsigned char)(PROFILER_TICK_NS >> 8);
+	record[2] = (unsigned char) PROFILER_TICK_NS;
+	for (b = 0; b < 4; b = b + 1) {
+		if (field[b] > 0xFFFF) { field[b] = 0xFFFF; }
+		record[3 + (b * 2)] = (unsigned char)(field[b] >> 8);
+		record[4 + (b * 2)] = (unsigned char) field[b];
+	}
+	for (b = 0; b < PROFILER_BUCKETS; b = b + 1) { record[11 + b] = p->buckets[b]; }
+	
+	Profiler_Clear(p);
+	return PROFILER_RECORD_SIZE;
+}
+
+#endif /* PROFILER_ENABLE */
@@ -0,0 +1,55 @@
+/***************************************************************************//**
+ *   @file   Profiler.h
+ *   @brief  Header file of the profiler timing the probes of the firmware on a
+ *           free-running timer.
+*******************************************************************************/
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Build with PROFILER_ENABLE defined to time the probes, they compile to
+ * nothing otherwise. On the PIC a tick is an instruction cycle of Timer1,
+ * which wraps after 16.4 ms. On the host a tick is a nanosecond of
+ * clock_gettime, so that modules built by the host tools time the same
+ * probes.
+ */
+#if defined(__18CXX)
+#define PROFILER_TICK_NS			250		// FOSC/4 at 16 MHz
+#else
+#define PROFILER_TICK_NS			1
+#endif
+
+#ifdef PROFILER_ENABLE
+extern unsigned int Profiler_Start[PROFILER_PROBES];
+#define PROFILER_START(probe)		Profiler_Start[probe] = Profiler_Now()
+#define PROFILER_STOP(probe)		Profiler_Record(probe, Profiler_Start[probe])
+#else
+#define PROFILER_START(probe)
+#define PROFILER_STOP(probe)
+#endif
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Starts the timer and clears the statistics */
+void Profiler_Initialize(void);
+
+/* Reads the timer */
+unsigned int Profiler_Now(void);
+
+/* Counts the time of a probe since it started */
+void Profiler_Record(unsigned char probe, unsigned int start);
+
+/* Gets the statistics of a probe as a PROFILE record and clears them */
+unsigned char Profiler_GetRecord(unsigned char probe, unsigned char* record);
+
+#endif /* _PROFILER_H_ */
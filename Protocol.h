@@ -0,0 +1,293 @@
+/***************************************************************************//**
+ *   @file   Protocol.h
+ *   @brief  Format of the data stream sent from the implant to the relay.
+ *           Shared by the implant firmware and the host tools, so it must not
+ *           include any device header.
+*******************************************************************************/
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+/******************************************************************************/
+/* STREAM RECORDS															  */
+/******************************************************************************/
+
+/* Every record sent to the relay is: sync, tag, frame sequence number,
+ * payload length, the payload itself and a CRC-8 (polynomial 0x07, initial
+ * value 0) of the tag, sequence number, length and payload. The relay
+ * resynchronizes after corrupted bytes on the next sync whose record checks.
+ */
+#define IMPLANT_RECORD_SYNC			0x5A
+#define IMPLANT_RECORD_HEADER		4		// sync + tag + sequence + length
+#define IMPLANT_RECORD_CHECK		1		// CRC-8 after the payload
+#define IMPLANT_RECORD_OVERHEAD		(IMPLANT_RECORD_HEADER + IMPLANT_RECORD_CHECK)
+#define IMPLANT_RECORD_POLYNOMIAL	0x07
+
+#define IMPLANT_TAG_FRAME			0x01	// channel data of one frame
+#define IMPLANT_TAG_STATUS			0x02	// device, LOFF_STATP, LOFF_STATN, GPIO
+#define IMPLANT_TAG_GAP				0x03	// frame dropped on a corrupted header, no payload
+#define IMPLANT_TAG_CALIBRATION		0x04	// channel 1 test signal sample of every device
+#define IMPLANT_TAG_LAYOUT			0x05	// channel mask of every device, seq is the first frame using it
+#define IMPLANT_TAG_RESTART			0x06	// reset cause, resets, boot time (2 us ticks, MSB first)
+#define IMPLANT_TAG_RICE			0x07	// channel count, then the Rice coded residuals of one frame
+#define IMPLANT_TAG_PACKED			0x08	// flags, channel count, then the bit-packed samples of one frame
+#define IMPLANT_TAG_PACKING			0x09	// bits and shift of every channel used by the PACKED records
+#define IMPLANT_TAG_BEAT			0x0A	// R peak index (4 bytes), RR (2 bytes) in frames, MSB first, flags
+#define IMPLANT_TAG_TRIGGER			0x0B	// cause, pre-trigger frames, post-trigger frames (2 bytes each), trigger frame index (4 bytes), MSB first
+#define IMPLANT_TAG_ENVELOPE		0x0C	// window, channel count, then min, max and mean of every channel
+#define IMPLANT_TAG_QUALITY			0x0D	// level, reason, TX ring occupancy, records dropped (2 bytes, MSB first)
+#define IMPLANT_TAG_QUEUES			0x0E	// per class: max depth, max latency (frames), dropped, sent (2 bytes, MSB first)
+#define IMPLANT_TAG_ARQ				0x0F	// seq is the link sequence number, the payload a whole record, check included
+#define IMPLANT_TAG_FILL			0x00	// single byte between records, completes a FEC block
+#define IMPLANT_TAG_PROFILE			0x10	// probe, tick (ns), count, min, max, mean (ticks), 2 bytes each MSB first, then the histogram
+#define IMPLANT_TAG_STATS			0x11	// statistics block, see STATISTICS
+
+/* STATUS, BEAT, QUALITY, RESTART, QUEUES and STATS records are urgent, they
+ * are sent before the records of sample data queued earlier, so the records
+ * are not in sequence number order.
+ */
+/******************************************************************************/
+/* RELAY COMMANDS															  */
+/******************************************************************************/
+
+/* Every command sent by the relay is: COMMAND_SYNC, opcode, payload length,
+ * the payload and a check byte, the XOR of the opcode, the length and the
+ * payload. A command with a wrong check byte, an unknown opcode or a payload
+ * of another length is dropped whole. Multi-byte fields are MSB first.
+ */
+#define COMMAND_SYNC				0xA5
+#define COMMAND_MAX_PAYLOAD			8
+
+#define COMMAND_MODE				0x01	// mode command (IMPLANT_MODE_*), channel mask of every device
+#define COMMAND_ENCODING			0x02	// encoding of the streamed frames (IMPLANT_ENCODING_*)
+#define COMMAND_PACKING				0x03	// channel, bits and shift of the PACKED samples of the channel
+#define COMMAND_DECIMATION			0x04	// decimation factor of the frames, 1 to DECIMATOR_MAX_FACTOR
+#define COMMAND_FILTERS				0x05	// mains, FILTERBANK_* filters, run at the rate after decimation
+#define COMMAND_DETECTOR			0x06	// lead of the QRS detector (QRS_LEAD_OFF disables it), gain shift
+#define COMMAND_CAPTURE				0x07	// pre and post-trigger frames (MSB first), CAPTURE_TRIGGER_* triggers
+#define COMMAND_TRIGGER				0x08	// triggers a capture, no payload
+#define COMMAND_THRESHOLD			0x09	// channel and absolute level (24 bits, MSB first) of the threshold trigger
+#define COMMAND_ENVELOPE			0x0A	// frames per envelope window, 1 to ENVELOPE_MAX_WINDOW
+#define COMMAND_QUALITY				0x0B	// quality controller on or off, hold updates (MSB first)
+#define COMMAND_QUALITY_ACK			0x0C	// sequence number of the last record received by the relay
+#define COMMAND_ARQ					0x0D	// ARQ of the records on or off
+#define COMMAND_ARQ_ACK				0x0E	// ARQ acknowledgement, ARQ_ACK_SIZE bytes
+#define COMMAND_FEC					0x0F	// FEC code of the radio bytes (FEC_*), saved in the radio profile
+#define COMMAND_PROFILE				0x10	// dumps the profiler probes as PROFILE records, no payload
+#define COMMAND_STATS				0x11	// queries the STATS record, no payload
+#define COMMAND_CALIBRATE			0x12	// frames of the skew calibration, CALIBRATION records of channel 1
+#define COMMAND_OPCODES				0x13	// first opcode not used
+
+/* Mode commands, the implant steps through power off, idle, channels on,
+ * converting and sending */
+#define IMPLANT_MODE_BACK			0x00	// previous mode: stop, turn off
+#define IMPLANT_MODE_NEXT			0x01	// next mode: power up, start, send
+#define IMPLANT_MODE_CHANNELS		0x02	// change the channels, one mask per device
+
+/******************************************************************************/
+/* RICE CODED FRAMES														  */
+/******************************************************************************/
+
+/* Each channel is predicted from its last two samples (2 * x[n-1] - x[n-2]).
+ * The residual is folded to unsigned (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...)
+ * and Rice coded MSB first: q = u >> k ones, a zero, then the k low bits of u.
+ * If q reaches RICE_QMAX, RICE_QMAX ones are followed by u on RICE_RAW_BITS
+ * bits instead. k is the smallest value with (count << k) >= sum, where sum
+ * and count accumulate u per channel and are halved when count reaches
+ * RICE_RESET. The last byte of a record is padded with zeros.
+ *
+ * A FRAME record restarts the predictor: both past samples of every channel
+ * are set to its samples, sum to RICE_SUM_INIT and count to 1. The implant
+ * sends one every RICE_KEY_INTERVAL frames and after a GAP, LAYOUT or
+ * RESTART record, a decoder that missed a record waits for it.
+ */
+#define RICE_QMAX					16
+#define RICE_RAW_BITS				27		// folded residual of a 24-bit sample
+#define RICE_MAX_K					24
+#define RICE_RESET					32
+#define RICE_SUM_INIT				64
+#define RICE_KEY_INTERVAL			128		// frames between two FRAME records
+
+/******************************************************************************/
+/* BIT-PACKED FRAMES														  */
+/******************************************************************************/
+
+/* Every channel n keeps PACKING bits[n] bits of its sample after an
+ * arithmetic right shift by PACKING shift[n], saturated to the range of
+ * bits[n]. The samples are packed MSB first with no padding between them,
+ * only the last byte of the record is padded with zeros. The relay restores
+ * the scale by shifting left by shift[n]. A PACKING record is sent when the
+ * settings change and every PACKER_CONFIG_INTERVAL frames.
+ */
+#define PACKER_FLAG_LEADOFF			0x01	// an electrode is off on one of the devices
+#define PACKER_FLAG_CLIPPED			0x02	// a sample was saturated to its packed range
+#define PACKER_MIN_BITS				2
+#define PACKER_MAX_BITS				24
+#define PACKER_CONFIG_INTERVAL		128
+
+/******************************************************************************/
+/* BEAT EVENTS																  */
+/******************************************************************************/
+
+/* The R peak index counts the frames read from the ADS1298, before
+ * decimation, since streaming started or the last LAYOUT record, so it keeps
+ * time across dropped records. RR is in the same frames, 0 for the first
+ * beat after a restart of the count.
+ */
+#define QRS_FLAG_SEARCHBACK			0x01	// found below the threshold after a missed beat
+#define QRS_FLAG_IRREGULAR			0x02	// RR outside 92-116 % of the average RR
+
+/******************************************************************************/
+/* CAPTURED WINDOWS															  */
+/******************************************************************************/
+
+/* In capture mode the frames only go to a ring on the implant. A trigger
+ * keeps the pre-trigger frames in the ring and the post-trigger frames that
+ * follow, then a TRIGGER record is sent followed by the FRAME records of the
+ * window, oldest first. The frames read while the window is sent are not
+ * captured.
+ */
+#define CAPTURE_CAUSE_COMMAND		0x01	// requested by the relay
+#define CAPTURE_CAUSE_BEAT			0x02	// beat found by search back or irregular RR
+#define CAPTURE_CAUSE_LEADOFF		0x03	// lead-off or GPIO change in a status word
+#define CAPTURE_CAUSE_THRESHOLD		0x04	// sample of the threshold channel over the level
+
+/******************************************************************************/
+/* STREAM QUALITY															  */
+/******************************************************************************/
+
+/* The implant steps down this ladder when the radio backs up and steps back
+ * up with hysteresis. Every change is sent as a QUALITY record whose seq is
+ * the first frame sent at the new level. A record that does not fit in its
+ * transmit queue is dropped whole, the relay sees a gap in the sequence
+ * numbers.
+ */
+#define QUALITY_FULL				0x00	// encoding and decimation set by the relay
+#define QUALITY_PACKED				0x01	// PACKED records, at most QUALITY_PACKED_BITS per sample
+#define QUALITY_DECIMATED			0x02	// PACKED records, decimated twice more, skipped at DECIMATOR_MAX_FACTOR
+#define QUALITY_ENVELOPE			0x03	// ENVELOPE records of the frames decimated twice more
+#define QUALITY_PACKED_BITS			16
+
+#define QUALITY_REASON_RELAY		0x00	// set by the relay
+#define QUALITY_REASON_OCCUPANCY	0x01	// TX ring filling up
+#define QUALITY_REASON_ACK			0x02	// acknowledgements of the relay lagging
+#define QUALITY_REASON_DROP			0x03	// a record did not fit in the TX ring
+#define QUALITY_REASON_CALM			0x04	// link calm for the hold time, stepped up
+
+/******************************************************************************/
+/* SELECTIVE REPEAT															  */
+/******************************************************************************/
+
+/* With the ARQ on, every record is sent inside an ARQ record whose seq is a
+ * link sequence number. The relay acknowledges with the next link sequence
+ * number it expects and a bitmap: bit i set if next + 1 + i was received.
+ * A record missing and sent before a received one, or not acknowledged
+ * after ARQ_TIMEOUT frames, is sent again when the radio is idle. The
+ * implant gives up the oldest record when the window or its copies are
+ * full, the relay skips it once it receives a record ARQ_WINDOW ahead.
+ *
+ * The window is what the copies hold with ARQ_SLOT_SIZE bytes per record, so
+ * that a record is only given up once ARQ_WINDOW newer records were sent.
+ * At one record per frame a copy lives ARQ_WINDOW frames. The time-out is
+ * under half of it, so that a repeat lost again still times out before the
+ * copy is given up. Acknowledgements arriving within ARQ_TIMEOUT - 1 frames
+ * repair the losses with one repeat each, later ones leave the time-out to
+ * repeat every record (RelayTool arqsim). Larger records take more than a
+ * slot and shorten the life of the copies.
+ */
+#define ARQ_BUFFER_SIZE				512		// bytes of copies kept by the implant
+#define ARQ_SLOT_SIZE				64		// bytes per record, a 16-channel FRAME record in an ARQ record
+#define ARQ_WINDOW					(ARQ_BUFFER_SIZE / ARQ_SLOT_SIZE)	// link sequence numbers in flight
+#define ARQ_TIMEOUT					(ARQ_WINDOW / 2 - 1)	// frames read without an acknowledgement
+#define ARQ_ACK_SIZE				3		// next, bitmap (2 bytes, MSB first, ARQ_WINDOW - 1 bits used)
+
+/******************************************************************************/
+/* FORWARD ERROR CORRECTION													  */
+/******************************************************************************/
+
+/* With the Hamming code on, the bytes of the radio ring are coded by blocks
+ * of FEC_DATA_SIZE. Every nibble, low first, is a Hamming(7,4) codeword
+ * p1 p2 d1 p3 d2 d3 d4 from bit 0, which corrects one bit error. The 16
+ * codewords of a block are interleaved by bit: byte 2b holds bit b of
+ * codewords 0 to 7, byte 2b + 1 bit b of codewords 8 to 15, so that a burst
+ * of up to 16 bit errors is corrected. A block is completed with FILL bytes
+ * when the radio would run out of bytes.
+ */
+#define FEC_NONE					0x00
+#define FEC_HAMMING					0x01
+#define FEC_DATA_SIZE				8
+#define FEC_CODED_SIZE				14		// 16 codewords of 7 bits
+
+/******************************************************************************/
+/* TRACE EVENTS																  */
+/******************************************************************************/
+
+/* Not part of the stream: bytes strobed on the logic analyzer port when the
+ * firmware is built with LOGICANALYZER_TRACING. A stage is marked by its
+ * event when it starts and by the event with TRACE_EXIT when it ends, DRDY
+ * is a single marker once per frame.
+ */
+#define TRACE_EXIT					0x01
+#define TRACE_DRDY					0x02	// DRDY_NOT lines of the active devices low
+#define TRACE_READ					0x04	// SPI read of a frame from the devices
+#define TRACE_FRAME					0x06	// processing of a frame, from the read to the checkpoint
+#define TRACE_ENQUEUE				0x08	// record queued for the radio
+#define TRACE_PUMP					0x0A	// records moved to the radio ring
+#define TRACE_ISR					0x0C	// high priority interrupt
+#define TRACE_EVENTS				0x0E	// first value not used
+
+/******************************************************************************/
+/* PROFILER PROBES															  */
+/******************************************************************************/
+
+/* Code timed by the PROFILER_START / PROFILER_STOP probes when the firmware
+ * is built with PROFILER_ENABLE. Bucket b of the histogram counts the times
+ * of 2^b to 2^(b+1) - 1 ticks, bucket 0 also counts 0, and saturates at 255.
+ */
+#define PROFILER_COMM_READ			0		// CommADS1298_Read
+#define PROFILER_READ_FRAME			1		// ADS1298_ReadFrame, DRDY wait included
+#define PROFILER_TX_WRITE			2		// CC110L_TX_WriteBuffer
+#define PROFILER_DECIMATOR			3		// Decimator_AddFrame
+#define PROFILER_FILTERS			4		// FilterBank_ProcessFrame
+#define PROFILER_DETECTOR			5		// QrsDetector_AddFrame
+#define PROFILER_ENCODER			6		// Implant_SendFrame
+#define PROFILER_ISR				7		// InterruptHigh
+#define PROFILER_PROBES				8
+#define PROFILER_BUCKETS			16
+#define PROFILER_RECORD_SIZE		(11 + PROFILER_BUCKETS)
+
+/******************************************************************************/
+/* STATISTICS																  */
+/******************************************************************************/
+
+/* Payload of a STATS record, sent when the relay asks for it. The counters
+ * run from the reset and wrap around, the relay takes their differences
+ * between two queries. Multi-byte fields are MSB first.
+ */
+#define STATS_OFFSET_FRAMES			0		// 4 bytes, frames read from the devices
+#define STATS_OFFSET_UPTIME			4		// 4 bytes, seconds since the reset
+#define STATS_OFFSET_DRDY_MISSES	8		// 2 bytes, reads started with DRDY already low, a sample may be lost
+#define STATS_OFFSET_HEADER_ERRORS	10		// 2 bytes, status headers out of sync
+#define STATS_OFFSET_TX_OVERWRITES	12		// 2 bytes, bytes overwritten in the TX ring
+#define STATS_OFFSET_RC_ERRORS		14		// 2 bytes, RC ring overruns and commands rejected
+#define STATS_OFFSET_RETRANSMITS	16		// 2 bytes, records sent again by the ARQ
+#define STATS_OFFSET_TX_HIGH_WATER	18		// bytes in the TX ring at most since the last query
+#define STATS_OFFSET_MODE			19
+#define STATS_OFFSET_ENCODING		20
+#define STATS_OFFSET_QUALITY		21
+#define STATS_OFFSET_ARQ_REJECTS	22		// 2 bytes, ARQ acknowledgements older than the window
+#define STATS_OFFSET_MAX_RECOVERY	24		// frames lost in the longest resynchronization after a header error
+#define STATS_OFFSET_STATE_MISMATCHES	25	// broadcasts after which the devices disagreed, retried once
+#define STATS_RECORD_SIZE			26
+
+/******************************************************************************/
+/* ENVELOPES																  */
+/******************************************************************************/
+
+/* In envelope mode an ENVELOPE record replaces a window of frames: the
+ * minimum, maximum and mean (rounded towards zero) of every channel, 3 bytes
+ * each, MSB first. The frames keep their sequence numbers, the seq of the
+ * record is the one of the last frame of the window, so that the envelopes
+ * line up with the FRAME records when the relay switches modes.
+ */
+
+#endif /* _PROTOCOL_H_ */
@@ -0,0 +1,357 @@
+/***************************************************************************//**
+ *   @file   QrsDetector.c
+ *   @brief  Implementation of the integer Pan-Tompkins QRS detector. One lead
+ *           is averaged down to about 250 SPS, then band-passed (triangular
+ *           low-pass and moving average high-pass), differentiated, squared
+ *           and integrated over 150 ms. The peaks of the integrated signal
+ *           are compared to thresholds adapted to the signal and noise peaks,
+ *           with a search back for the beats missed under the threshold.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "QrsDetector.h"
+#include "FixedPoint.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static unsigned char lead = QRS_LEAD_OFF;
+static unsigned char gainShift = 0;		// right shift of the lead, keeps the slopes under QRS_SLOPE_MAX
+static unsigned char rateShift = 0;		// log2 of the frames averaged per sample
+static unsigned int  rate = 0;			// sample rate of the filters
+
+/* Window lengths and their Q15 reciprocals */
+static unsigned char lpLength, hpLength, mwiLength;
+static int lpScale, hpScale, mwiScale;
+static unsigned char delay;				// samples from the R peak to the integrated peak
+
+/* Filters */
+static long input, average;				// last frame sample and sum of the frames averaged
+static unsigned char averaged;
+static long lpIn[QRS_LP_MAX], lpMid[QRS_LP_MAX];
+static long lpSum1, lpSum2;
+static unsigned char lpIndex;
+static long hpIn[QRS_HP_MAX];
+static long hpSum;
+static unsigned char hpIndex;
+static long slope[4];					// last high-pass outputs, newest first
+static unsigned int mwiIn[QRS_MWI_MAX];
+static unsigned long mwiSum;
+static unsigned char mwiIndex;
+
+/* Peak detection, in samples of the filters */
+static unsigned long sample;
+static unsigned int peak;
+static unsigned long peakSample;
+static unsigned int signalLevel, noiseLevel;	// SPKI and NPKI
+static unsigned int threshold1, threshold2;
+static unsigned long learnEnd;
+static unsigned int learnMax;
+static unsigned long learnSum;
+static unsigned int learnCount;
+static unsigned int refractory;
+static unsigned int backPeak;			// largest noise peak over threshold2 since the last beat
+static unsigned long backSample;
+
+/* Beats */
+static unsigned char hasBeat;
+static unsigned long beatSample;
+static unsigned int rrHistory[QRS_RR_HISTORY];
+static unsigned char rrIndex, rrCount;
+static unsigned long rrSum;
+static QrsDetector_Beat beat;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Selects the lead and sizes the filters for the frame rate, then
+ *          resets the detector.
+ *
+ * @param	frameRate - Rate of the frames, in SPS.
+ * @param	newLead - Channel of the frame used, QRS_LEAD_OFF disables the
+ *                    detector.
+ * @param	shift - Right shift of the lead samples, set from the gain so that
+ *                  the QRS slopes stay under QRS_SLOPE_MAX.
+ *
+ * @return	1 - detector set, 0 - frame rate under QRS_RATE_MIN.
+*******************************************************************************/
+unsigned char QrsDetector_Configure(unsigned int frameRate, unsigned char newLead, unsigned char shift) {
+	lead = QRS_LEAD_OFF;
+	if (newLead == QRS_LEAD_OFF) { return 1; }
+	if (frameRate < QRS_RATE_MIN) { return 0; }
+	
+	/* Average the frames down to less than twice QRS_RATE_MIN */
+	rateShift = 0;
+	while ((frameRate >> (rateShift + 1)) >= QRS_RATE_MIN) { rateShift = rateShift + 1; }
+	rate = frameRate >> rateShift;
+	
+	lpLength = (unsigned char) (((unsigned long) rate * 30) / 1000);
+	hpLength = (unsigned char) (((unsigned long) rate * 160) / 1000);
+	mwiLength = (unsigned char) (((unsigned long) rate * 150) / 1000);
+	lpScale = (int) (32767 / ((unsigned int) lpLength * lpLength));
+	hpScale = (int) (32767 / hpLength);
+	mwiScale = (int) (32767 / mwiLength);
+	delay = (lpLength - 1) + ((hpLength - 1) / 2) + 2 + (mwiLength / 2) + (rate / 40); // the integration peaks 25 ms after the QRS center
+	refractory = rate / 5;				// 200 ms
+	
+	lead = newLead;
+	gainShift = shift;
+	QrsDetector_Reset();
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Clears the filters, the thresholds and the beat history. The
+ *          thresholds are learnt again over the next 2 seconds.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void QrsDetector_Reset() {
+	unsigned char i;
+	
+	input = 0;
+	average = 0;
+	averaged = 0;
+	for (i = 0; i < QRS_LP_MAX; i = i + 1) { lpIn[i] = 0; lpMid[i] = 0; }
+	for (i = 0; i < QRS_HP_MAX; i = i + 1) { hpIn[i] = 0; }
+	for (i = 0; i < QRS_MWI_MAX; i = i + 1) { mwiIn[i] = 0; }
+	for (i = 0; i < 4; i = i + 1) { slope[i] = 0; }
+	lpSum1 = 0;
+	lpSum2 = 0;
+	hpSum = 0;
+	mwiSum = 0;
+	lpIndex = 0;
+	hpIndex = 0;
+	mwiIndex = 0;
+	
+	sample = 0;
+	peak = 0;
+	signalLevel = 0;
+	noiseLevel = 0;
+	threshold1 = 0;
+	threshold2 = 0;
+	learnEnd = (unsigned long) rate * 2;
+	learnMax = 0;
+	learnSum = 0;
+	learnCount = 0;
+	backPeak = 0;
+	
+	hasBeat = 0;
+	rrIndex = 0;
+	rrCount = 0;
+	rrSum = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Records a beat at a sample of the filters and updates the RR
+ *          average.
+ *
+ * @param	at - Sample of the peak of the integrated signal.
+ * @param	flags - QRS_FLAG_SEARCHBACK if found by the search back.
+ *
+ * @return	None.
+*******************************************************************************/
+static void QrsDetector_AddBeat(unsigned long at, unsigned char flags) {
+	unsigned int rr = 0;
+	unsigned int mean;
+	
+	if (hasBeat) {
+		rr = (unsigned int) (at - beatSample);
+		
+		/* Flag the RR intervals away from the average before adding them */
+		if (rrCount != 0) {
+			mean = (unsigned int) (rrSum / rrCount);
+			if (((unsigned long) rr * 100 < (unsigned long) mean * 92) ||
+				((unsigned long) rr * 100 > (unsigned long) mean * 116)) { flags |= QRS_FLAG_IRREGULAR; }
+		}
+		if (rrCount == QRS_RR_HISTORY) { rrSum = rrSum - rrHistory[rrIndex]; } else { rrCount = rrCount + 1; }
+		rrHistory[rrIndex] = rr;
+		rrSum = rrSum + rr;
+		rrIndex = (rrIndex + 1) % QRS_RR_HISTORY;
+	}
+	hasBeat = 1;
+	beatSample = at;
+	backPeak = 0;
+	
+	/* Back to frames, the R peak is ahead of the integrated peak */
+	beat.index = (at > delay) ? ((at - delay) << rateShift) : 0;
+	beat.rr = rr << rateShift;
+	beat.flags = flags;
+}
+
+/***************************************************************************//**
+ * @brief	Sets the thresholds a quarter of the way from the noise level to
+ *          the signal level.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+static void QrsDetector_UpdateThresholds() {
+	threshold1 = noiseLevel;
+	if (signalLevel > noiseLevel) { threshold1 = threshold1 + ((signalLevel - noiseLevel) >> 2); }
+	threshold2 = threshold1 >> 1;
+}
+
+/***************************************************************************//**
+ * @brief	Classifies a peak of the integrated signal as a beat or as noise
+ *          and adapts the thresholds.
+ *
+ * @param	None.
+ *
+ * @return	1 - the peak is a beat, 0 - noise.
+*******************************************************************************/
+static unsigned char QrsDetector_AddPeak() {
+	unsigned char found = 0;
+	
+	if ((peak >= threshold1) && (!hasBeat || (peakSample - beatSample > refractory))) {
+		signalLevel = signalLevel - (signalLevel >> 3) + (peak >> 3);
+		QrsDetector_AddBeat(peakSample, 0);
+		found = 1;
+	} else {
+		noiseLevel = noiseLevel - (noiseLevel >> 3) + (peak >> 3);
+		
+		/* Keep the candidate for a search back */
+		if ((peak >= threshold2) && (peak > backPeak) &&
+			(!hasBeat || (peakSample - beatSample > refractory))) {
+			backPeak = peak;
+			backSample = peakSample;
+		}
+	}
+	QrsDetector_UpdateThresholds();
+	
+	return found;
+}
+
+/***************************************************************************//**
+ * @brief	Runs one sample of the lead through the filters and the peak
+ *          detection.
+ *
+ * @param	x - Lead sample, averaged down to the rate of the filters.
+ *
+ * @return	1 - a beat was found, 0 - no beat.
+*******************************************************************************/
+static unsigned char QrsDetector_AddSample(long x) {
+	unsigned char found = 0;
+	unsigned char i;
+	long lp, hp, d;
+	unsigned int squared, mwi;
+	
+	/* Low-pass: two moving sums of lpLength samples, a triangular window */
+	lpSum1 = lpSum1 + x - lpIn[lpIndex];
+	lpIn[lpIndex] = x;
+	lpSum2 = lpSum2 + lpSum1 - lpMid[lpIndex];
+	lpMid[lpIndex] = lpSum1;
+	lpIndex = (lpIndex + 1 == lpLength) ? 0 : lpIndex + 1;
+	lp = FixedPoint_Mul(lpSum2, lpScale, 15);
+	
+	/* High-pass: the middle sample minus the moving average */
+	hpSum = hpSum + lp - hpIn[hpIndex];
+	hpIn[hpIndex] = lp;
+	hpIndex = (hpIndex + 1 == hpLength) ? 0 : hpIndex + 1;
+	i = hpIndex + ((hpLength - 1) / 2);
+	if (i >= hpLength) { i = i - hpLength; }
+	hp = hpIn[i] - FixedPoint_Mul(hpSum, hpScale, 15);
+	
+	/* Five point derivative, clamped and squared */
+	d = ((2 * hp) + slope[0] - slope[2] - (2 * slope[3])) / 8;
+	slope[3] = slope[2];
+	slope[2] = slope[1];
+	slope[1] = slope[0];
+	slope[0] = hp;
+	if (d > QRS_SLOPE_MAX) { d = QRS_SLOPE_MAX; }
+	if (d < -QRS_SLOPE_MAX) { d = -QRS_SLOPE_MAX; }
+	squared = (unsigned int) ((d * d) >> 4);
+	
+	/* Moving window integration */
+	mwiSum = mwiSum + squared - mwiIn[mwiIndex];
+	mwiIn[mwiIndex] = squared;
+	mwiIndex = (mwiIndex + 1 == mwiLength) ? 0 : mwiIndex + 1;
+	mwi = (unsigned int) FixedPoint_Mul((long) mwiSum, mwiScale, 15);
+	
+	/* Learn the levels of the signal and the noise over 2 seconds */
+	sample = sample + 1;
+	if (sample <= learnEnd) {
+		if (mwi > learnMax) { learnMax = mwi; }
+		learnSum = learnSum + mwi;
+		learnCount = learnCount + 1;
+		if (sample == learnEnd) {
+			signalLevel = learnMax / 3;
+			noiseLevel = (unsigned int) ((learnSum / learnCount) / 2);
+			QrsDetector_UpdateThresholds();
+		}
+		return 0;
+	}
+	
+	/* A peak is taken once the signal falls under half of it, the tail of a
+	 * peak from the learning period is skipped */
+	if (mwi > peak) {
+		peak = mwi;
+		peakSample = sample;
+	} else if ((peak != 0) && (mwi < (peak >> 1))) {
+		if (peakSample > learnEnd + 1) { found = QrsDetector_AddPeak(); }
+		peak = 0;
+	}
+	
+	/* Search back for a beat missed after 166 % of the average RR */
+	if (!found && hasBeat && (backPeak != 0) && (rrCount != 0) &&
+		((sample - beatSample) * 100 > (rrSum / rrCount) * 166)) {
+		signalLevel = signalLevel - (signalLevel >> 2) + (backPeak >> 2);
+		QrsDetector_UpdateThresholds();
+		QrsDetector_AddBeat(backSample, QRS_FLAG_SEARCHBACK);
+		found = 1;
+	}
+	
+	return found;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a frame and tells whether a beat was found. A frame without
+ *          the lead (gap) repeats the previous sample to keep the time.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame, 0 for a gap.
+ *
+ * @return	1 - a beat was found, read it with QrsDetector_GetBeat, 0 - no
+ *          beat.
+*******************************************************************************/
+unsigned char QrsDetector_AddFrame(unsigned char* frame, unsigned char channelCount) {
+	unsigned char* bytes;
+	long x;
+	
+	if (lead == QRS_LEAD_OFF) { return 0; }
+	
+	if (lead < channelCount) {
+		bytes = frame + (lead * 3);
+		input = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+		if (bytes[0] & 0x80) { input = input - 0x1000000L; }
+	}
+	
+	/* Average the frames down to the rate of the filters */
+	average = average + input;
+	averaged = averaged + 1;
+	if (averaged < (1 << rateShift)) { return 0; }
+	x = FixedPoint_Shift(average, rateShift + gainShift);
+	average = 0;
+	averaged = 0;
+	
+	return QrsDetector_AddSample(x);
+}
+
+/***************************************************************************//**
+ * @brief	Gets the last beat found.
+ *
+ * @param	copy - Receives the beat.
+ *
+ * @return	None.
+*******************************************************************************/
+void QrsDetector_GetBeat(QrsDetector_Beat* copy) {
+	*copy = beat;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ *   @file   QrsDetector.h
+ *   @brief  Header file of the integer Pan-Tompkins QRS detector.
+*******************************************************************************/
+#ifndef _QRSDETECTOR_H_
+#define _QRSDETECTOR_H_
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define QRS_LEAD_OFF				0xFF	// lead value disabling the detector
+
+/* The lead is averaged down by a power of two to a rate between
+ * QRS_RATE_MIN and 2 * QRS_RATE_MIN, the windows are sized for it.
+ */
+#define QRS_RATE_MIN				180
+#define QRS_LP_MAX					11		// 30 ms, half of the triangular low-pass
+#define QRS_HP_MAX					58		// 160 ms, moving average removed by the high-pass
+#define QRS_MWI_MAX					54		// 150 ms, moving window integration
+#define QRS_SLOPE_MAX				1023	// derivative clamp before squaring
+#define QRS_RR_HISTORY				8		// RR intervals averaged
+
+/* Beat found by the detector */
+typedef struct {
+	unsigned long index;		// estimated R peak, in frames since the reset
+	unsigned int rr;			// frames since the previous beat, 0 for the first one
+	unsigned char flags;		// QRS_FLAG_*
+} QrsDetector_Beat;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Selects the lead and sizes the filters for the frame rate */
+unsigned char QrsDetector_Configure(unsigned int rate, unsigned char lead, unsigned char shift);
+
+/* Clears the filters, the thresholds and the beat history */
+void QrsDetector_Reset(void);
+
+/* Adds a frame and tells whether a beat was found */
+unsigned char QrsDetector_AddFrame(unsigned char* frame, unsigned char channelCount);
+
+/* Gets the last beat found */
+void QrsDetector_GetBeat(QrsDetector_Beat* beat);
+
+#endif /* _QRSDETECTOR_H_ */
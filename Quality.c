@@ -0,0 +1,186 @@
+/***************************************************************************//**
+ *   @file   Quality.c
+ *   @brief  Implementation of the stream quality controller. The TX ring of
+ *           the radio and the acknowledgements of the relay tell when the
+ *           link backs up, the stream then steps down a ladder of cheaper
+ *           encodings before the ring overflows, and steps back up once the
+ *           link stayed calm for a while.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Quality.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static unsigned char enabled = 0;
+static unsigned char level = QUALITY_FULL;
+static unsigned char reason = QUALITY_REASON_RELAY;
+static unsigned int holdUpdates = QUALITY_HOLD_UPDATES;
+static unsigned int hold = QUALITY_HOLD_UPDATES;	// doubled after a failed step up
+static unsigned int sinceUp = 0xFFFF;	// updates since the last step up
+static unsigned char highCount = 0;		// consecutive updates over QUALITY_HIGH_PERCENT
+static unsigned char settleCount = 0;	// updates left before the next step down
+static unsigned int calmCount = 0;		// consecutive calm updates
+static unsigned char acknowledged = 0;	// an acknowledgement was received
+static unsigned char lastAck = 0;
+static unsigned char decimation = 1;	// QUALITY_DECIMATED decimates more than QUALITY_PACKED
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Enables the controller and sets the hold time of a step up, then
+ *          goes back to full quality.
+ *
+ * @param	enable - 1 enables the controller, 0 keeps full quality.
+ * @param	calm - Calm updates (frames read) before a step up, 0 for
+ *                 QUALITY_HOLD_UPDATES.
+ *
+ * @return	None.
+*******************************************************************************/
+void Quality_Configure(unsigned char enable, unsigned int calm) {
+	enabled = enable;
+	holdUpdates = (calm != 0) ? calm : QUALITY_HOLD_UPDATES;
+	acknowledged = 0;
+	Quality_Reset();
+}
+
+/***************************************************************************//**
+ * @brief	Goes back to full quality, as when the relay sets the encoding.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Quality_Reset() {
+	level = QUALITY_FULL;
+	reason = QUALITY_REASON_RELAY;
+	highCount = 0;
+	settleCount = 0;
+	calmCount = 0;
+	hold = holdUpdates;
+	sinceUp = 0xFFFF;
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether the frames can be decimated twice more. When they
+ *          cannot, QUALITY_DECIMATED would send the same stream as
+ *          QUALITY_PACKED, so the ladder skips it.
+ *
+ * @param	available - 1 if the decimation factor can be doubled.
+ *
+ * @return	None.
+*******************************************************************************/
+void Quality_SetDecimation(unsigned char available) {
+	decimation = available;
+	if (!decimation && (level == QUALITY_DECIMATED)) { level = QUALITY_PACKED; }
+}
+
+/***************************************************************************//**
+ * @brief	Takes an acknowledgement of the relay. The relay acknowledges the
+ *          sequence number of the last record received, the lag of the
+ *          acknowledgements is only checked once one was received.
+ *
+ * @param	seq - Sequence number acknowledged.
+ *
+ * @return	None.
+*******************************************************************************/
+void Quality_Acknowledge(unsigned char seq) {
+	acknowledged = 1;
+	lastAck = seq;
+}
+
+/***************************************************************************//**
+ * @brief	Updates the controller once per frame read. A dropped record or a
+ *          lagging relay steps down at once, a TX ring over
+ *          QUALITY_HIGH_PERCENT for QUALITY_DOWN_UPDATES updates too. A step
+ *          up needs the ring under QUALITY_LOW_PERCENT, nothing dropped and
+ *          the relay in step for the hold time. A step up that does not
+ *          last the hold time doubles it, one that lasts halves it, so a
+ *          link just under the next level is not probed over and over.
+ *
+ * @param	seq - Sequence number of the next record.
+ * @param	occupancy - Bytes waiting in the TX ring.
+ * @param	capacity - Size of the TX ring.
+ * @param	dropped - Records dropped since the last update.
+ *
+ * @return	1 - the level changed, 0 - same level.
+*******************************************************************************/
+unsigned char Quality_Update(unsigned char seq, unsigned char occupancy, unsigned char capacity,
+							 unsigned char dropped) {
+	unsigned char congested = 0;
+	unsigned char cause = QUALITY_REASON_RELAY;
+	unsigned char lag = seq - lastAck;
+	
+	if (!enabled) { return 0; }
+	
+	/* Look for the signs of congestion */
+	if ((unsigned int) occupancy * 100 > (unsigned int) capacity * QUALITY_HIGH_PERCENT) {
+		if (highCount < QUALITY_DOWN_UPDATES) { highCount = highCount + 1; }
+		if (highCount == QUALITY_DOWN_UPDATES) { congested = 1; cause = QUALITY_REASON_OCCUPANCY; }
+	} else {
+		highCount = 0;
+	}
+	if (acknowledged && (lag > QUALITY_MAX_LAG)) { congested = 1; cause = QUALITY_REASON_ACK; }
+	if (dropped != 0) { congested = 1; cause = QUALITY_REASON_DROP; }
+	if (settleCount != 0) { settleCount = settleCount - 1; }
+	if (sinceUp != 0xFFFF) { sinceUp = sinceUp + 1; }
+	if ((sinceUp == hold) && (hold > holdUpdates)) { hold = hold / 2; }
+	
+	/* Step down, then give the cheaper encoding time to drain the ring */
+	if (congested) {
+		calmCount = 0;
+		if ((level == QUALITY_ENVELOPE) || ((settleCount != 0) && (dropped == 0))) { return 0; }
+		level = level + 1;
+		if ((level == QUALITY_DECIMATED) && !decimation) { level = level + 1; }
+		reason = cause;
+		if ((sinceUp < hold) && (hold < QUALITY_HOLD_MAX)) { hold = hold * 2; }
+		sinceUp = 0xFFFF;
+		highCount = 0;
+		settleCount = QUALITY_SETTLE_UPDATES;
+		return 1;
+	}
+	
+	/* Step up after the hold time */
+	if ((unsigned int) occupancy * 100 >= (unsigned int) capacity * QUALITY_LOW_PERCENT) {
+		calmCount = 0;
+		return 0;
+	}
+	if (level == QUALITY_FULL) { return 0; }
+	calmCount = calmCount + 1;
+	if (calmCount < hold) { return 0; }
+	
+	level = level - 1;
+	if ((level == QUALITY_DECIMATED) && !decimation) { level = level - 1; }
+	reason = QUALITY_REASON_CALM;
+	calmCount = 0;
+	sinceUp = 0;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the level of the ladder.
+ *
+ * @param	None.
+ *
+ * @return	QUALITY_FULL, QUALITY_PACKED, QUALITY_DECIMATED or
+ *          QUALITY_ENVELOPE.
+*******************************************************************************/
+unsigned char Quality_GetLevel() {
+	return level;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the reason of the last change of level.
+ *
+ * @param	None.
+ *
+ * @return	QUALITY_REASON_*.
+*******************************************************************************/
+unsigned char Quality_GetReason() {
+	return reason;
+}
@@ -0,0 +1,52 @@
+/***************************************************************************//**
+ *   @file   Quality.h
+ *   @brief  Header file of the stream quality controller.
+*******************************************************************************/
+#ifndef _QUALITY_H_
+#define _QUALITY_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Congestion seen by the controller */
+#define QUALITY_HIGH_PERCENT		75		// TX ring occupancy stepping down
+#define QUALITY_LOW_PERCENT			25		// TX ring occupancy allowing a step up
+#define QUALITY_DOWN_UPDATES		2		// updates over QUALITY_HIGH_PERCENT before a step down
+#define QUALITY_SETTLE_UPDATES		32		// updates after a step down before the next one
+#define QUALITY_MAX_LAG				64		// frames sent and not acknowledged by the relay
+#define QUALITY_HOLD_UPDATES		512		// default calm updates before a step up
+#define QUALITY_HOLD_MAX			16384	// hold after repeated failed step ups
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Enables the controller and sets the hold time of a step up */
+void Quality_Configure(unsigned char enable, unsigned int calm);
+
+/* Goes back to full quality */
+void Quality_Reset(void);
+
+/* Tells whether the frames can be decimated twice more */
+void Quality_SetDecimation(unsigned char available);
+
+/* Takes an acknowledgement of the relay */
+void Quality_Acknowledge(unsigned char seq);
+
+/* Updates the controller once per frame and tells whether the level changed */
+unsigned char Quality_Update(unsigned char seq, unsigned char occupancy, unsigned char capacity,
+							 unsigned char dropped);
+
+/* Gets the level of the ladder */
+unsigned char Quality_GetLevel(void);
+
+/* Gets the reason of the last change of level */
+unsigned char Quality_GetReason(void);
+
+#endif /* _QUALITY_H_ */
@@ -0,0 +1,164 @@
+/***************************************************************************//**
+ *   @file   RiceCoder.c
+ *   @brief  Implementation of the lossless delta + Rice coder of the frames.
+ *           Integer only and free of device registers, the coded format is
+ *           described in Protocol.h. The bits are packed through a 16-bit
+ *           accumulator, at most 8 bits at a time, to keep the PIC loops short.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "RiceCoder.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static RiceCoder_Channel channels[RICE_MAX_CHANNELS];
+
+/* Bit writer */
+static unsigned char* outPtr;
+static unsigned int bitBuffer;
+static unsigned char bitCount;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Writes up to 8 bits, MSB first.
+ *
+ * @param	bits - Bits to write, right aligned.
+ * @param	count - Number of bits to write, from 0 to 8.
+ *
+ * @return	None.
+*******************************************************************************/
+static void RiceCoder_PutBits(unsigned char bits, unsigned char count) {
+	bitBuffer = (bitBuffer << count) | bits;
+	bitCount = bitCount + count;
+	
+	if (bitCount >= 8) {
+		bitCount = bitCount - 8;
+		*outPtr++ = (unsigned char) (bitBuffer >> bitCount);
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Writes the count low bits of a value, MSB first.
+ *
+ * @param	value - Bits to write, right aligned.
+ * @param	count - Number of bits to write, up to 32.
+ *
+ * @return	None.
+*******************************************************************************/
+static void RiceCoder_PutLong(unsigned long value, unsigned char count) {
+	unsigned char chunk;
+	
+	/* Leading partial byte, then whole bytes */
+	chunk = count & 0x07;
+	while (count > 0) {
+		count = count - chunk;
+		RiceCoder_PutBits((unsigned char) (value >> count) & ((0x01 << chunk) - 1), chunk);
+		chunk = 8;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Converts a big-endian 24-bit two's complement sample.
+ *
+ * @param	bytes - Pointer to the 3 bytes of the sample, MSB first.
+ *
+ * @return	Sign-extended sample.
+*******************************************************************************/
+static long RiceCoder_Sample(unsigned char* bytes) {
+	long sample;
+	
+	sample = ((long) bytes[0] << 16) | ((long) bytes[1] << 8) | (long) bytes[2];
+	if (bytes[0] & 0x80) { sample = sample - 0x1000000L; }
+	
+	return sample;
+}
+
+/***************************************************************************//**
+ * @brief	Restarts the predictor of every channel from a frame sent raw.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame.
+ *
+ * @return	None.
+*******************************************************************************/
+void RiceCoder_Prime(unsigned char* frame, unsigned char channelCount) {
+	unsigned char i;
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		channels[i].x1 = RiceCoder_Sample(frame + (i * 3));
+		channels[i].x2 = channels[i].x1;
+		channels[i].sum = RICE_SUM_INIT;
+		channels[i].count = 1;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Codes a frame of 24-bit samples. Every channel is predicted from
+ *          its last two samples and the residual is Rice coded with a
+ *          parameter that follows the mean residual of the channel.
+ *
+ * @param	frame - Channel data of the frame, 3 bytes per channel.
+ * @param	channelCount - Number of channels in the frame, at most
+ *                         RICE_MAX_CHANNELS.
+ * @param	out - Buffer of RICE_MAX_BYTES receiving the coded frame.
+ *
+ * @return	Number of bytes written to out.
+*******************************************************************************/
+unsigned char RiceCoder_EncodeFrame(unsigned char* frame, unsigned char channelCount, unsigned char* out) {
+	RiceCoder_Channel* ch;
+	long x, residual;
+	unsigned long u, q;
+	unsigned char i, k;
+	
+	outPtr = out;
+	bitBuffer = 0;
+	bitCount = 0;
+	
+	for (i = 0; i < channelCount; i = i + 1) {
+		ch = &channels[i];
+		x = RiceCoder_Sample(frame + (i * 3));
+		
+		/* Second order prediction, folded residual */
+		residual = x - ((ch->x1 << 1) - ch->x2);
+		if (residual >= 0) {
+			u = (unsigned long) residual << 1;
+		} else {
+			u = ((unsigned long) (-residual) << 1) - 1;
+		}
+		
+		/* Rice parameter from the mean residual */
+		for (k = 0; (k < RICE_MAX_K) && (((unsigned long) ch->count << k) < ch->sum); k = k + 1);
+		
+		/* Unary quotient, then the k low bits, or an escape */
+		q = u >> k;
+		if (q < RICE_QMAX) {
+			while (q >= 8) { RiceCoder_PutBits(0xFF, 8); q = q - 8; }
+			RiceCoder_PutBits((unsigned char) (((0x01 << q) - 1) << 1), (unsigned char) q + 1);
+			RiceCoder_PutLong(u, k);
+		} else {
+			for (q = 0; q < RICE_QMAX; q = q + 8) { RiceCoder_PutBits(0xFF, 8); } // RICE_QMAX is a multiple of 8
+			RiceCoder_PutLong(u, RICE_RAW_BITS);
+		}
+		
+		/* Update the channel state */
+		ch->sum = ch->sum + u;
+		ch->count = ch->count + 1;
+		if (ch->count == RICE_RESET) {
+			ch->sum = ch->sum >> 1;
+			ch->count = ch->count >> 1;
+		}
+		ch->x2 = ch->x1;
+		ch->x1 = x;
+	}
+	
+	/* Pad the last byte with zeros */
+	if (bitCount > 0) { RiceCoder_PutBits(0x00, 8 - bitCount); }
+	
+	return (unsigned char) (outPtr - out);
+}
@@ -0,0 +1,39 @@
+/***************************************************************************//**
+ *   @file   RiceCoder.h
+ *   @brief  Header file of the lossless delta + Rice coder of the frames.
+*******************************************************************************/
+#ifndef _RICECODER_H_
+#define _RICECODER_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define RICE_MAX_CHANNELS			16		// ADS1298_DEVICE_COUNT * ADS1298_CHANNEL_COUNT
+
+/* Worst case coded size of a frame: every channel escaped */
+#define RICE_MAX_BYTES				(((RICE_MAX_CHANNELS * (RICE_QMAX + RICE_RAW_BITS)) + 7) / 8)
+
+/* Prediction and Rice parameter state of a channel */
+typedef struct {
+	long x1;				// last sample
+	long x2;				// sample before the last one
+	unsigned long sum;		// sum of the folded residuals
+	unsigned char count;	// number of residuals in sum
+} RiceCoder_Channel;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Restarts the predictor of every channel from a frame */
+void RiceCoder_Prime(unsigned char* frame, unsigned char channelCount);
+
+/* Codes a frame of 24-bit samples */
+unsigned char RiceCoder_EncodeFrame(unsigned char* frame, unsigned char channelCount, unsigned char* out);
+
+#endif /* _RICECODER_H_ */
@@ -0,0 +1,144 @@
+/***************************************************************************//**
+ *   @file   Stats.c
+ *   @brief  Implementation of the runtime statistics of the implant. The hot
+ *           path only bumps byte counters, they are folded into the block of
+ *           wide counters out of the hot path and the block is sent in one
+ *           record when the relay asks for it.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Stats.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+#if defined(__18CXX)
+#pragma udata access StatsHot
+#endif
+STATS_NEAR unsigned char Stats_Hot[STATS_HOT_COUNT];
+#if defined(__18CXX)
+#pragma udata
+#endif
+
+static unsigned char seen[STATS_HOT_COUNT];		// hot counters at the last fold
+static unsigned int rcOverruns = 0;				// folded, the other RC errors are added when sent
+static unsigned long lastTicks = 0;
+static unsigned long partial = 0;				// ticks of the second under way
+static Stats_Block block;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Adds what the hot counters moved by since the last fold to the
+ *          block.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Stats_Fold() {
+	unsigned char delta[STATS_HOT_COUNT];
+	unsigned char i;
+	
+	for (i = 0; i < STATS_HOT_COUNT; i = i + 1) {
+		delta[i] = Stats_Hot[i] - seen[i];
+		seen[i] = seen[i] + delta[i];
+	}
+	
+	block.frames = block.frames + delta[STATS_FRAMES];
+	block.drdyMisses = block.drdyMisses + delta[STATS_DRDY_MISSES];
+	rcOverruns = rcOverruns + delta[STATS_RC_OVERRUNS];
+}
+
+/***************************************************************************//**
+ * @brief	Counts the uptime from a free-running timer, which must not wrap
+ *          between two calls (Supervisor_GetTicks).
+ *
+ * @param	ticks - Timer read, STATS_TICKS_PER_SECOND per second.
+ *
+ * @return	None.
+*******************************************************************************/
+void Stats_AddTime(unsigned long ticks) {
+	partial = partial + (ticks - lastTicks);
+	lastTicks = ticks;
+	
+	while (partial >= STATS_TICKS_PER_SECOND) {
+		partial = partial - STATS_TICKS_PER_SECOND;
+		block.uptime = block.uptime + 1;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Keeps the highest level of the TX ring since the last query.
+ *
+ * @param	count - Bytes in the TX ring.
+ *
+ * @return	None.
+*******************************************************************************/
+void Stats_SetTxLevel(unsigned char count) {
+	if (count > block.txHighWater) { block.txHighWater = count; }
+}
+
+/***************************************************************************//**
+ * @brief	Gets the block, the fields kept by the other modules are written
+ *          in it before it is sent.
+ *
+ * @param	None.
+ *
+ * @return	Pointer to the block.
+*******************************************************************************/
+Stats_Block* Stats_GetBlock() {
+	return &block;
+}
+
+/***************************************************************************//**
+ * @brief	Writes a field MSB first.
+ *
+ * @param	record - Payload written.
+ * @param	offset - STATS_OFFSET_* of the field.
+ * @param	value - Value of the field.
+ * @param	size - Bytes of the field.
+ *
+ * @return	None.
+*******************************************************************************/
+static void Stats_Put(unsigned char* record, unsigned char offset, unsigned long value, unsigned char size) {
+	while (size > 0) {
+		size = size - 1;
+		record[offset + size] = (unsigned char) value;
+		value = value >> 8;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Gets the block as the payload of a STATS record and restarts the
+ *          high-water mark of the TX ring.
+ *
+ * @param	record - Receives STATS_RECORD_SIZE bytes.
+ *
+ * @return	Number of bytes written.
+*******************************************************************************/
+unsigned char Stats_GetRecord(unsigned char* record) {
+	Stats_Fold();
+	
+	Stats_Put(record, STATS_OFFSET_FRAMES, block.frames, 4);
+	Stats_Put(record, STATS_OFFSET_UPTIME, block.uptime, 4);
+	Stats_Put(record, STATS_OFFSET_DRDY_MISSES, block.drdyMisses, 2);
+	Stats_Put(record, STATS_OFFSET_HEADER_ERRORS, block.headerErrors, 2);
+	Stats_Put(record, STATS_OFFSET_TX_OVERWRITES, block.txOverwrites, 2);
+	Stats_Put(record, STATS_OFFSET_RC_ERRORS, block.rcErrors + rcOverruns, 2);
+	Stats_Put(record, STATS_OFFSET_RETRANSMITS, block.retransmits, 2);
+	record[STATS_OFFSET_TX_HIGH_WATER] = block.txHighWater;
+	record[STATS_OFFSET_MODE] = block.mode;
+	record[STATS_OFFSET_ENCODING] = block.encoding;
+	record[STATS_OFFSET_QUALITY] = block.quality;
+	Stats_Put(record, STATS_OFFSET_ARQ_REJECTS, block.arqRejects, 2);
+	record[STATS_OFFSET_MAX_RECOVERY] = block.maxRecovery;
+	record[STATS_OFFSET_STATE_MISMATCHES] = block.stateMismatches;
+	
+	block.txHighWater = 0;
+	return STATS_RECORD_SIZE;
+}
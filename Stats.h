@@ -0,0 +1,75 @@
+/***************************************************************************//**
+ *   @file   Stats.h
+ *   @brief  Header file of the runtime statistics of the implant.
+*******************************************************************************/
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Counters of the hot path, one byte each in the access bank so that
+ * STATS_COUNT is a single INCF. Every counter has one writer, Stats_Fold
+ * only reads them and adds what they moved by to the block, so they can be
+ * counted from an ISR. Fold at least every 255 counts.
+ */
+#define STATS_FRAMES				0
+#define STATS_DRDY_MISSES			1
+#define STATS_RC_OVERRUNS			2
+#define STATS_HOT_COUNT				3
+
+#if defined(__18CXX)
+#define STATS_NEAR					near
+#else
+#define STATS_NEAR
+#endif
+
+extern STATS_NEAR unsigned char Stats_Hot[STATS_HOT_COUNT];
+#define STATS_COUNT(counter)		Stats_Hot[counter] = Stats_Hot[counter] + 1
+
+#define STATS_TICKS_PER_SECOND		500000UL	// SUPERVISOR_BOOT_TICK_US of 2 us
+
+/* Statistics sent in a STATS record */
+typedef struct {
+	unsigned long frames;
+	unsigned long uptime;			// seconds
+	unsigned int drdyMisses;
+	unsigned int headerErrors;
+	unsigned int txOverwrites;
+	unsigned int rcErrors;
+	unsigned int retransmits;
+	unsigned char txHighWater;
+	unsigned char mode;
+	unsigned char encoding;
+	unsigned char quality;
+	unsigned int arqRejects;
+	unsigned char maxRecovery;		// frames
+	unsigned char stateMismatches;
+} Stats_Block;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Adds the hot counters to the block */
+void Stats_Fold(void);
+
+/* Counts the uptime from a free-running timer */
+void Stats_AddTime(unsigned long ticks);
+
+/* Keeps the highest level of the TX ring */
+void Stats_SetTxLevel(unsigned char count);
+
+/* Gets the block, for the fields taken from the other modules */
+Stats_Block* Stats_GetBlock(void);
+
+/* Gets the block as the payload of a STATS record */
+unsigned char Stats_GetRecord(unsigned char* record);
+
+#endif /* _STATS_H_ */
@@ -0,0 +1,253 @@
+/***************************************************************************//**
+ *   @file   Supervisor.c
+ *   @brief  Implementation of the watchdog supervisor and task scheduler. The
+ *           watchdog is only cleared by the scheduler once every task returned,
+ *           so a hang in any busy-wait (SPI buffer, DRDY) resets the PIC. The
+ *           retained state lets the implant resume streaming after the reset.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Supervisor.h"
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+
+/* The C18 startup code only initializes idata, this section keeps its value
+ * across a reset. It is validated with the magic number and the checksum.
+ */
+#pragma udata SupervisorNoInit
+static Supervisor_State retained;
+#pragma udata
+
+static Supervisor_Task tasks[SUPERVISOR_MAX_TASKS];
+static unsigned char taskCount = 0;
+static unsigned char cause = SUPERVISOR_CAUSE_POWER_ON;
+static unsigned int stallCount = 0;
+static unsigned int overflows = 0;		// Timer3 wraps counted by Supervisor_GetTicks
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Computes the checksum of the retained state.
+ *
+ * @param	None.
+ *
+ * @return	Two's complement of the sum of every byte except the checksum.
+*******************************************************************************/
+static unsigned char Supervisor_Checksum() {
+	unsigned char* bytes = (unsigned char*) &retained;
+	unsigned char sum = 0;
+	unsigned char i;
+	
+	for (i = 0; i < sizeof(Supervisor_State) - 1; i = i + 1) {
+		sum = sum + bytes[i];
+	}
+	
+	return (unsigned char) (0 - sum);
+}
+
+/***************************************************************************//**
+ * @brief	Finds the cause of the reset and validates the retained state. Must
+ *          be called first in main, before RCON is changed. Timer3 is started
+ *          to measure the boot time.
+ *
+ * @param	None.
+ *
+ * @return	1 - restart after a watchdog reset with a valid retained state,
+ *          0 - cold start, the retained state is cleared.
+*******************************************************************************/
+unsigned char Supervisor_Initialize() {
+	unsigned char i;
+	
+	/* Start measuring the boot time: FOSC/4, 1:8 prescaler */
+	T3CON = 0b00110001;
+	TMR3H = 0;
+	TMR3L = 0;
+	PIR2bits.TMR3IF = 0;
+	overflows = 0;
+	
+	/* TO is cleared by a watchdog time-out, POR and BOR by a power failure */
+	if (!RCONbits.POR || !RCONbits.BOR) {
+		cause = SUPERVISOR_CAUSE_POWER_ON;
+	} else if (!RCONbits.TO) {
+		cause = SUPERVISOR_CAUSE_WATCHDOG;
+	} else {
+		cause = SUPERVISOR_CAUSE_OTHER;
+	}
+	RCONbits.POR = 1; // set again so that the next reset can be told apart
+	RCONbits.BOR = 1;
+	
+	stallCount = 0;
+	taskCount = 0;
+	
+	/* Keep the retained state only if the watchdog reset the implant */
+	if ((cause == SUPERVISOR_CAUSE_WATCHDOG) &&
+		(retained.magic == SUPERVISOR_MAGIC) &&
+		(retained.checksum == Supervisor_Checksum())) {
+		retained.resets = retained.resets + 1;
+		Supervisor_Checkpoint();
+		return 1;
+	}
+	
+	retained.magic = SUPERVISOR_MAGIC;
+	retained.streaming = 0;
+	retained.nextSeq = 0;
+	for (i = 0; i < ADS1298_DEVICE_COUNT; i = i + 1) { retained.channels[i] = 0; }
+	retained.resets = 0;
+	Supervisor_Checkpoint();
+	
+	if (cause == SUPERVISOR_CAUSE_WATCHDOG) { cause = SUPERVISOR_CAUSE_OTHER; } // state was lost
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether the implant restarted after a watchdog reset with a
+ *          valid retained state.
+ *
+ * @param	None.
+ *
+ * @return	1 - restart, 0 - cold start.
+*******************************************************************************/
+unsigned char Supervisor_IsRestart() {
+	return (cause == SUPERVISOR_CAUSE_WATCHDOG);
+}
+
+/***************************************************************************//**
+ * @brief	Gets the cause of the last reset.
+ *
+ * @param	None.
+ *
+ * @return	SUPERVISOR_CAUSE_POWER_ON, SUPERVISOR_CAUSE_WATCHDOG or
+ *          SUPERVISOR_CAUSE_OTHER.
+*******************************************************************************/
+unsigned char Supervisor_GetCause() {
+	return cause;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the state kept across a watchdog reset. Call
+ *          Supervisor_Checkpoint after changing it.
+ *
+ * @param	None.
+ *
+ * @return	Pointer to the retained state.
+*******************************************************************************/
+Supervisor_State* Supervisor_GetState() {
+	return &retained;
+}
+
+/***************************************************************************//**
+ * @brief	Seals the retained state with its checksum, a reset before the next
+ *          checkpoint restores the state as of this call.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Supervisor_Checkpoint() {
+	retained.checksum = Supervisor_Checksum();
+}
+
+/***************************************************************************//**
+ * @brief	Gets the time since the reset. Timer3 wraps after 131 ms.
+ *
+ * @param	None.
+ *
+ * @return	Timer3 ticks of SUPERVISOR_BOOT_TICK_US since Supervisor_Initialize.
+*******************************************************************************/
+unsigned int Supervisor_GetBootTicks() {
+	unsigned int ticks;
+	
+	ticks = TMR3L;						// reading TMR3L latches TMR3H
+	ticks = ticks | ((unsigned int) TMR3H << 8);
+	
+	return ticks;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the time since the reset without the 131 ms wrap. The wraps
+ *          of Timer3 are counted from its overflow flag, which only keeps
+ *          one, so it must be called at least every 262 ms. Once per round of
+ *          the scheduler is enough: a longer round trips the watchdog.
+ *
+ * @param	None.
+ *
+ * @return	Timer3 ticks of SUPERVISOR_BOOT_TICK_US since Supervisor_Initialize.
+*******************************************************************************/
+unsigned long Supervisor_GetTicks() {
+	unsigned int ticks;
+	
+	if (PIR2bits.TMR3IF) {
+		PIR2bits.TMR3IF = 0;
+		overflows = overflows + 1;
+	}
+	ticks = Supervisor_GetBootTicks();
+	
+	/* Wrapped since the flag was checked, the read may be before or after */
+	if (PIR2bits.TMR3IF) {
+		PIR2bits.TMR3IF = 0;
+		overflows = overflows + 1;
+		ticks = Supervisor_GetBootTicks();
+	}
+	
+	return ((unsigned long) overflows << 16) | ticks;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a task to the scheduler.
+ *
+ * @param	task - Function run once per round.
+ *
+ * @return	1 - task added, 0 - task table full.
+*******************************************************************************/
+unsigned char Supervisor_AddTask(Supervisor_Task task) {
+	if (taskCount == SUPERVISOR_MAX_TASKS) { return 0; }
+	
+	tasks[taskCount] = task;
+	taskCount = taskCount + 1;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Enables the watchdog and runs the tasks forever. The watchdog is
+ *          cleared here only, after every task of the round returned.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void Supervisor_Run() {
+	unsigned char i;
+	
+	ClrWdt();
+	WDTCONbits.SWDTEN = 1; // WDTEN = SWON lets the firmware enable the watchdog
+	
+	while (1) {
+		for (i = 0; i < taskCount; i = i + 1) {
+			tasks[i]();
+		}
+		ClrWdt();
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Tells whether an injected SPI stall is due. Only used when the
+ *          firmware is built with SUPERVISOR_INJECT_STALLS.
+ *
+ * @param	None.
+ *
+ * @return	1 - hang the transfer now, 0 - carry on.
+*******************************************************************************/
+unsigned char Supervisor_InjectStall() {
+	stallCount = stallCount + 1;
+	if (stallCount < SUPERVISOR_STALL_PERIOD) { return 0; }
+	
+	stallCount = 0;
+	return 1;
+}
@@ -0,0 +1,91 @@
+/***************************************************************************//**
+ *   @file   Supervisor.h
+ *   @brief  Header file of the watchdog supervisor and task scheduler.
+*******************************************************************************/
+#ifndef _SUPERVISOR_H_
+#define _SUPERVISOR_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include <p18f46k22.h>
+#include "ADS1298.h"
+
+/******************************************************************************/
+/* SUPERVISOR SETTINGS														  */
+/******************************************************************************/
+
+/* The watchdog runs from the 31 kHz LFINTOSC, 4 ms per count before the
+ * postscaler set by WDTPS in main.c. A round of the scheduler must complete
+ * within the time-out.
+ */
+#define SUPERVISOR_WDT_TIMEOUT_MS	256		// WDTPS = 64
+#define SUPERVISOR_MAX_TASKS		4
+#define SUPERVISOR_MAGIC			0x5AA5	// marks a retained state written by this firmware
+
+/* Reset causes reported after a restart */
+#define SUPERVISOR_CAUSE_POWER_ON	0x00
+#define SUPERVISOR_CAUSE_WATCHDOG	0x01
+#define SUPERVISOR_CAUSE_OTHER		0x02
+
+/* Boot time is measured with Timer3 at FOSC/4/8, 2 us per tick at 16 MHz */
+#define SUPERVISOR_BOOT_TICK_US		2
+
+/* Fault injection, build with SUPERVISOR_INJECT_STALLS defined to hang the SPI
+ * every SUPERVISOR_STALL_PERIOD transfers and exercise the watchdog restart.
+ */
+#define SUPERVISOR_STALL_PERIOD		20000u
+#ifdef SUPERVISOR_INJECT_STALLS
+#define SUPERVISOR_STALL_POINT()	if (Supervisor_InjectStall()) { while (1); }
+#else
+#define SUPERVISOR_STALL_POINT()
+#endif
+
+/* State kept across a watchdog reset */
+typedef struct {
+	unsigned int magic;
+	unsigned char streaming;						// implant was streaming when it reset
+	unsigned char nextSeq;							// sequence number of the next frame
+	unsigned char channels[ADS1298_DEVICE_COUNT];	// channel mask of each device
+	unsigned char resets;							// watchdog resets since power-on
+	unsigned char checksum;
+} Supervisor_State;
+
+/* Task run by the scheduler, it must return within the watchdog time-out */
+typedef void (*Supervisor_Task)(void);
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Finds the cause of the reset and validates the retained state */
+unsigned char Supervisor_Initialize(void);
+
+/* Tells whether the implant restarted after a watchdog reset */
+unsigned char Supervisor_IsRestart(void);
+
+/* Gets the cause of the last reset */
+unsigned char Supervisor_GetCause(void);
+
+/* Gets the state kept across a watchdog reset */
+Supervisor_State* Supervisor_GetState(void);
+
+/* Saves the state kept across a watchdog reset */
+void Supervisor_Checkpoint(void);
+
+/* Gets the time since the reset in Timer3 ticks */
+unsigned int Supervisor_GetBootTicks(void);
+
+/* Gets the time since the reset in Timer3 ticks, past the wrap of Timer3 */
+unsigned long Supervisor_GetTicks(void);
+
+/* Adds a task to the scheduler */
+unsigned char Supervisor_AddTask(Supervisor_Task task);
+
+/* Runs the tasks forever, kicking the watchdog after every round */
+void Supervisor_Run(void);
+
+/* Tells whether an injected SPI stall is due */
+unsigned char Supervisor_InjectStall(void);
+
+#endif /* _SUPERVISOR_H_ */
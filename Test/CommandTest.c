@@ -0,0 +1,212 @@
+/***************************************************************************//**
+ *   @file   CommandTest.c
+ *   @brief  Host test of the relay commands reaching the ARQ. ARQ
+ *           acknowledgements are framed as the relay sends them and decoded
+ *           byte by byte by Command_AddByte, the records they report missing
+ *           must be the ones Arq_SelectRepeat sends again. The skew
+ *           calibration must reach its handler with the frame count.
+ *
+ *           gcc -Wall -Wno-unknown-pragmas -I. -o CommandTest Test/CommandTest.c Command.c Arq.c
+ *           ./CommandTest
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+
+#include "Command.h"
+#include "Arq.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define TEST_RECORD_SIZE			4
+#define TEST_RECORDS				5
+
+#define TEST_CHECK(condition) Test_Check((condition), #condition, __LINE__)
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static int failures = 0;
+static int acks = 0;
+static int calibrations = 0;
+static unsigned char calibrationFrames = 0;
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a failed check.
+ *
+ * @param condition - Result of the check.
+ * @param text - Check as written.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* text, int line) {
+	if (condition) { return; }
+	printf("line %d: %s failed\n", line, text);
+	failures = failures + 1;
+}
+
+/***************************************************************************//**
+ * @brief Handler of COMMAND_ARQ_ACK, as Implant_ArqAcknowledge.
+ *
+ * @param ack - Next sequence number expected and bitmap (MSB first).
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_ArqAcknowledge(unsigned char* ack) {
+	acks = acks + 1;
+	Arq_Acknowledge(ack[0], ((unsigned int) ack[1] << 8) | ack[2]);
+}
+
+/***************************************************************************//**
+ * @brief Handler of COMMAND_CALIBRATE, as Implant_CommandCalibrate.
+ *
+ * @param data - Frames of the calibration.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Calibrate(unsigned char* data) {
+	calibrations = calibrations + 1;
+	calibrationFrames = data[0];
+}
+
+/***************************************************************************//**
+ * @brief Frames a command and feeds it to the decoder.
+ *
+ * @param opcode - Opcode of the command.
+ * @param payload - Payload of the command.
+ * @param length - Bytes of payload.
+ *
+ * @return Commands run by the decoder, 1 for a valid frame.
+*******************************************************************************/
+static int Test_SendCommand(unsigned char opcode, const unsigned char* payload, unsigned char length) {
+	unsigned char check, i;
+	int ran = 0;
+
+	check = opcode ^ length;
+	ran = ran + Command_AddByte(COMMAND_SYNC);
+	ran = ran + Command_AddByte(opcode);
+	ran = ran + Command_AddByte(length);
+	for (i = 0; i < length; i = i + 1) {
+		check = check ^ payload[i];
+		ran = ran + Command_AddByte(payload[i]);
+	}
+	ran = ran + Command_AddByte(check);
+	return ran;
+}
+
+/***************************************************************************//**
+ * @brief Frames an ARQ acknowledgement and feeds it to the decoder.
+ *
+ * @param expected - Next sequence number expected by the relay.
+ * @param received - Records received after it, bit i for expected + 1 + i.
+ * @param corrupt - Flips a bit of the payload after the check is computed.
+ *
+ * @return Commands run by the decoder, 1 for a valid frame.
+*******************************************************************************/
+static int Test_SendAck(unsigned char expected, unsigned int received, unsigned char corrupt) {
+	unsigned char frame[4 + ARQ_ACK_SIZE];
+	unsigned char i, check;
+	int ran = 0;
+
+	frame[0] = COMMAND_SYNC;
+	frame[1] = COMMAND_ARQ_ACK;
+	frame[2] = ARQ_ACK_SIZE;
+	frame[3] = expected;
+	frame[4] = (unsigned char) (received >> 8);
+	frame[5] = (unsigned char) received;
+	check = 0;
+	for (i = 1; i < 6; i = i + 1) { check = check ^ frame[i]; }
+	frame[6] = check;
+	if (corrupt) { frame[5] = frame[5] ^ 0x04; }
+
+	for (i = 0; i < sizeof(frame); i = i + 1) { ran = ran + Command_AddByte(frame[i]); }
+	return ran;
+}
+
+/***************************************************************************//**
+ * @brief Sends the records through the ARQ, the bytes of record n are
+ *        n * 16 + i.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_SendRecords() {
+	unsigned char n, i, seq;
+
+	for (n = 0; n < TEST_RECORDS; n = n + 1) {
+		seq = Arq_Begin(TEST_RECORD_SIZE);
+		TEST_CHECK(seq == n);
+		for (i = 0; i < TEST_RECORD_SIZE; i = i + 1) { Arq_StoreByte((n << 4) + i); }
+	}
+}
+
+/***************************************************************************//**
+ * @brief Runs the test.
+ *
+ * @param None.
+ *
+ * @return 0 if every check passed.
+*******************************************************************************/
+int main() {
+	const unsigned char noise[] = {0x00, 0x5A, COMMAND_SYNC, 0x7F, 0x00, 0x00};
+	const unsigned char frames[] = {200, 0};
+	Arq_Stats stats;
+	unsigned char seq, size, i;
+
+	Command_Initialize();
+	TEST_CHECK(Command_SetHandler(COMMAND_ARQ_ACK, ARQ_ACK_SIZE, Test_ArqAcknowledge));
+	TEST_CHECK(Command_SetHandler(COMMAND_CALIBRATE, 1, Test_Calibrate));
+	Arq_Configure(1);
+	Test_SendRecords();
+
+	/* Nothing is missing before an acknowledgement */
+	TEST_CHECK(!Arq_SelectRepeat(255, &seq, &size));
+
+	/* Noise, then an unknown opcode, resynchronized on the next sync */
+	for (i = 0; i < sizeof(noise); i = i + 1) { TEST_CHECK(!Command_AddByte(noise[i])); }
+	TEST_CHECK(Command_GetErrors() == 1);
+
+	/* A corrupted acknowledgement is dropped whole */
+	TEST_CHECK(Test_SendAck(2, 0x0003, 1) == 0);
+	TEST_CHECK(Command_GetErrors() == 2);
+	TEST_CHECK(acks == 0);
+	TEST_CHECK(!Arq_SelectRepeat(255, &seq, &size));
+
+	/* The relay has 0, 1, 3 and 4, record 2 is sent again */
+	TEST_CHECK(Test_SendAck(2, 0x0003, 0) == 1);
+	TEST_CHECK(acks == 1);
+	TEST_CHECK(Arq_SelectRepeat(255, &seq, &size));
+	TEST_CHECK(seq == 2);
+	TEST_CHECK(size == TEST_RECORD_SIZE);
+	for (i = 0; i < TEST_RECORD_SIZE; i = i + 1) { TEST_CHECK(Arq_ReadByte() == (0x20 + i)); }
+	TEST_CHECK(!Arq_SelectRepeat(255, &seq, &size));
+
+	/* Everything received, then an acknowledgement older than the window */
+	TEST_CHECK(Test_SendAck(TEST_RECORDS, 0x0000, 0) == 1);
+	TEST_CHECK(Test_SendAck(1, 0x0000, 0) == 1);
+	Arq_GetStats(&stats);
+	TEST_CHECK(stats.sent == TEST_RECORDS);
+	TEST_CHECK(stats.repeated == 1);
+	TEST_CHECK(stats.lost == 0);
+	TEST_CHECK(stats.rejected == 1);
+	TEST_CHECK(Command_GetErrors() == 2);
+
+	/* The calibration runs with its frame count, a frame of the wrong length is dropped */
+	TEST_CHECK(Test_SendCommand(COMMAND_CALIBRATE, frames, 2) == 0);
+	TEST_CHECK(Command_GetErrors() == 3);
+	TEST_CHECK(Test_SendCommand(COMMAND_CALIBRATE, frames, 1) == 1);
+	TEST_CHECK(calibrations == 1);
+	TEST_CHECK(calibrationFrames == 200);
+
+	printf("%s, %d failure(s)\n", (failures == 0) ? "PASS" : "FAIL", failures);
+	return (failures == 0) ? 0 : 1;
+}
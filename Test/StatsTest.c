@@ -0,0 +1,101 @@
+/***************************************************************************//**
+ *   @file   StatsTest.c
+ *   @brief  Host test of the STATS record. The hot counters are folded into
+ *           the block across their wrap. The counters kept by the ADS1298
+ *           driver (header errors, longest recovery, state mismatches),
+ *           written in the block as Implant_QueryStats writes them, must be
+ *           reported at their offsets.
+ *
+ *           gcc -Wall -Wno-unknown-pragmas -I. -o StatsTest Test/StatsTest.c Stats.c
+ *           ./StatsTest
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+
+#include "Stats.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define TEST_FRAMES					600		// more than a hot counter holds between two folds
+
+#define TEST_CHECK(condition) Test_Check((condition), #condition, __LINE__)
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static int failures = 0;
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a failed check.
+ *
+ * @param condition - Result of the check.
+ * @param text - Check as written.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* text, int line) {
+	if (condition) { return; }
+	printf("line %d: %s failed\n", line, text);
+	failures = failures + 1;
+}
+
+/***************************************************************************//**
+ * @brief Reads a field of a STATS record, MSB first.
+ *
+ * @param record - Payload of the record.
+ * @param offset - STATS_OFFSET_* of the field.
+ * @param size - Bytes of the field.
+ *
+ * @return Value of the field.
+*******************************************************************************/
+static unsigned long Test_Field(const unsigned char* record, unsigned char offset, unsigned char size) {
+	unsigned long value = 0;
+	unsigned char i;
+
+	for (i = 0; i < size; i = i + 1) { value = (value << 8) | record[offset + i]; }
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief Runs the test.
+ *
+ * @param None.
+ *
+ * @return 0 if every check passed.
+*******************************************************************************/
+int main() {
+	unsigned char record[STATS_RECORD_SIZE];
+	Stats_Block* block = Stats_GetBlock();
+	int i;
+
+	/* Frames counted by the hot path, folded once per frame */
+	for (i = 0; i < TEST_FRAMES; i = i + 1) {
+		STATS_COUNT(STATS_FRAMES);
+		if (i % 100 == 0) { STATS_COUNT(STATS_DRDY_MISSES); }
+		Stats_Fold();
+	}
+
+	/* Counters kept by the ADS1298 driver */
+	block->headerErrors = 0x0102;
+	block->maxRecovery = 7;
+	block->stateMismatches = 2;
+
+	TEST_CHECK(Stats_GetRecord(record) == STATS_RECORD_SIZE);
+	TEST_CHECK(Test_Field(record, STATS_OFFSET_FRAMES, 4) == TEST_FRAMES);
+	TEST_CHECK(Test_Field(record, STATS_OFFSET_DRDY_MISSES, 2) == TEST_FRAMES / 100);
+	TEST_CHECK(Test_Field(record, STATS_OFFSET_HEADER_ERRORS, 2) == 0x0102);
+	TEST_CHECK(record[STATS_OFFSET_MAX_RECOVERY] == 7);
+	TEST_CHECK(record[STATS_OFFSET_STATE_MISMATCHES] == 2);
+
+	printf("%s, %d failure(s)\n", (failures == 0) ? "PASS" : "FAIL", failures);
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+/***************************************************************************//**
+ *   @file   TxQueue.c
+ *   @brief  Implementation of the priority queues of the records sent to the
+ *           relay. Records are queued whole by class and moved whole to the
+ *           radio ring, urgent ones first, so that an event never waits
+ *           behind the sample data or gets overwritten by it.
+*******************************************************************************/
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "TxQueue.h"
+
+/*****************************************************************************/
+/* TYPES																	 */
+/*****************************************************************************/
+
+/* Ring of records of a class: enqueue tick, then the record as sent */
+typedef struct {
+	unsigned char* buffer;
+	unsigned char size;
+	unsigned char head, tail, count;
+	TxQueue_Stats stats;
+} TxQueue_Class;
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static unsigned char urgentBuffer[TXQUEUE_URGENT_SIZE];
+static unsigned char bulkBuffer[TXQUEUE_BULK_SIZE];
+static TxQueue_Class queues[TXQUEUE_CLASSES];
+static unsigned char ticks = 0;
+
+/*****************************************************************************/
+/* FUNCTIONS																 */
+/*****************************************************************************/
+
+/***************************************************************************//**
+ * @brief	Empties the queues and clears the counters.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void TxQueue_Initialize() {
+	TxQueue_Class* q;
+	unsigned char c;
+	
+	queues[TXQUEUE_URGENT].buffer = urgentBuffer;
+	queues[TXQUEUE_URGENT].size = TXQUEUE_URGENT_SIZE;
+	queues[TXQUEUE_BULK].buffer = bulkBuffer;
+	queues[TXQUEUE_BULK].size = TXQUEUE_BULK_SIZE;
+	for (c = 0; c < TXQUEUE_CLASSES; c = c + 1) {
+		q = &queues[c];
+		q->head = 0;
+		q->tail = 0;
+		q->count = 0;
+		q->stats.records = 0;
+		q->stats.dropped = 0;
+		q->stats.maxDepth = 0;
+		q->stats.maxLatency = 0;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Counts the time for the latency of the records, called once per
+ *          frame read.
+ *
+ * @param	None.
+ *
+ * @return	None.
+*******************************************************************************/
+void TxQueue_Tick() {
+	ticks = ticks + 1;
+}
+
+/***************************************************************************//**
+ * @brief	Writes a byte at the head of a queue.
+ *
+ * @param	q - Queue written.
+ * @param	data - Byte to write.
+ *
+ * @return	None.
+*******************************************************************************/
+static void TxQueue_PutByte(TxQueue_Class* q, unsigned char data) {
+	q->buffer[q->head] = data;
+	q->head = (q->head + 1 == q->size) ? 0 : q->head + 1;
+	q->count = q->count + 1;
+}
+
+/***************************************************************************//**
+ * @brief	Adds a byte to the CRC-8 of a record. The byte is multiplied by
+ *          x^8 modulo the polynomial x^8 + x^2 + x + 1 with shifts, the two
+ *          bits above the byte are reduced once more, so no table is kept in
+ *          RAM.
+ *
+ * @param	crc - CRC of the bytes before.
+ * @param	data - Byte added.
+ *
+ * @return	CRC of the bytes up to data.
+*******************************************************************************/
+unsigned char TxQueue_Crc8(unsigned char crc, unsigned char data) {
+	unsigned int t = crc ^ data;
+	unsigned char high;
+	
+	t = t ^ (t << 1) ^ (t << 2);
+	high = (unsigned char) (t >> 8);
+	return (unsigned char) t ^ high ^ (high << 1) ^ (high << 2);
+}
+
+/***************************************************************************//**
+ * @brief	Queues a whole record, or drops it whole if the queue is full.
+ *
+ * @param	txClass - TXQUEUE_URGENT or TXQUEUE_BULK.
+ * @param	tag - Tag of the record.
+ * @param	seq - Sequence number of the record.
+ * @param	data - Payload of the record.
+ * @param	length - Number of bytes in the payload.
+ *
+ * @return	1 - record queued, 0 - record dropped.
+*******************************************************************************/
+unsigned char TxQueue_Put(unsigned char txClass, unsigned char tag, unsigned char seq,
+						  unsigned char* data, unsigned char length) {
+	TxQueue_Class* q = &queues[txClass];
+	unsigned char i, crc;
+	
+	if ((unsigned int) q->count + 1 + IMPLANT_RECORD_OVERHEAD + length > q->size) {
+		q->stats.dropped = q->stats.dropped + 1;
+		return 0;
+	}
+	
+	TxQueue_PutByte(q, ticks);
+	TxQueue_PutByte(q, IMPLANT_RECORD_SYNC);
+	TxQueue_PutByte(q, tag);
+	TxQueue_PutByte(q, seq);
+	TxQueue_PutByte(q, length);
+	crc = TxQueue_Crc8(TxQueue_Crc8(TxQueue_Crc8(0, tag), seq), length);
+	for (i = 0; i < length; i = i + 1) {
+		TxQueue_PutByte(q, data[i]);
+		crc = TxQueue_Crc8(crc, data[i]);
+	}
+	TxQueue_PutByte(q, crc);
+	if (q->count > q->stats.maxDepth) { q->stats.maxDepth = q->count; }
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Reads the byte at the tail of a queue.
+ *
+ * @param	q - Queue read.
+ *
+ * @return	Byte read.
+*******************************************************************************/
+static unsigned char TxQueue_GetByte(TxQueue_Class* q) {
+	unsigned char data = q->buffer[q->tail];
+	
+	q->tail = (q->tail + 1 == q->size) ? 0 : q->tail + 1;
+	q->count = q->count - 1;
+	
+	return data;
+}
+
+/***************************************************************************//**
+ * @brief	Selects the next record to send, strictly by priority: an urgent
+ *          record if it fits in the radio ring, else a bulk record if it fits
+ *          in the bulk window. Its bytes are then read with
+ *          TxQueue_ReadByte.
+ *
+ * @param	room - Free bytes in the radio ring.
+ * @param	bulkRoom - Bulk bytes allowed in the radio ring, 255 when the ring
+ *                     is empty so that any record can go.
+ * @param	size - Receives the number of bytes of the record.
+ *
+ * @return	Class of the record, TXQUEUE_NONE if none can be sent.
+*******************************************************************************/
+unsigned char TxQueue_Select(unsigned char room, unsigned char bulkRoom, unsigned char* size) {
+	TxQueue_Class* q;
+	unsigned char c, length, latency;
+	
+	for (c = 0; c < TXQUEUE_CLASSES; c = c + 1) {
+		q = &queues[c];
+		if (q->count == 0) { continue; }
+		
+		/* The length byte follows the tick, the sync, the tag and the seq */
+		length = q->buffer[(q->tail + 4) % q->size];
+		*size = IMPLANT_RECORD_OVERHEAD + length;
+		if ((*size > room) || ((c == TXQUEUE_BULK) && (*size > bulkRoom))) { return TXQUEUE_NONE; }
+		
+		latency = ticks - TxQueue_GetByte(q);
+		if (latency > q->stats.maxLatency) { q->stats.maxLatency = latency; }
+		q->stats.records = q->stats.records + 1;
+		return c;
+	}
+	
+	return TXQUEUE_NONE;
+}
+
+/***************************************************************************//**
+ * @brief	Reads the next byte of the record selected.
+ *
+ * @param	txClass - Class returned by TxQueue_Select.
+ *
+ * @return	Byte of the record.
+*******************************************************************************/
+unsigned char TxQueue_ReadByte(unsigned char txClass) {
+	return TxQueue_GetByte(&queues[txClass]);
+}
+
+/***************************************************************************//**
+ * @brief	Gets the bytes waiting in a queue.
+ *
+ * @param	txClass - TXQUEUE_URGENT or TXQUEUE_BULK.
+ *
+ * @return	Bytes queued, enqueue ticks included.
+*******************************************************************************/
+unsigned char TxQueue_GetCount(unsigned char txClass) {
+	return queues[txClass].count;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the size of a queue.
+ *
+ * @param	txClass - TXQUEUE_URGENT or TXQUEUE_BULK.
+ *
+ * @return	Bytes the queue holds.
+*******************************************************************************/
+unsigned char TxQueue_GetSize(unsigned char txClass) {
+	return queues[txClass].size;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the counters of a class and restarts the maxima.
+ *
+ * @param	txClass - TXQUEUE_URGENT or TXQUEUE_BULK.
+ * @param	stats - Receives the counters.
+ *
+ * @return	None.
+*******************************************************************************/
+void TxQueue_GetStats(unsigned char txClass, TxQueue_Stats* stats) {
+	TxQueue_Class* q = &queues[txClass];
+	
+	*stats = q->stats;
+	q->stats.maxDepth = q->count;
+	q->stats.maxLatency = 0;
+}
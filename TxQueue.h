@@ -0,0 +1,73 @@
+/***************************************************************************//**
+ *   @file   TxQueue.h
+ *   @brief  Header file of the priority queues of the records sent to the
+ *           relay.
+*******************************************************************************/
+#ifndef _TXQUEUE_H_
+#define _TXQUEUE_H_
+
+/*****************************************************************************/
+/* INCLUDE FILES															 */
+/*****************************************************************************/
+#include "Protocol.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Transmit classes, drained in this order */
+#define TXQUEUE_URGENT				0x00	// events and alarms
+#define TXQUEUE_BULK				0x01	// sample data
+#define TXQUEUE_CLASSES				2
+#define TXQUEUE_NONE				0xFF
+
+/* Queue sizes, each record takes one more byte for its enqueue tick */
+#define TXQUEUE_URGENT_SIZE			48
+#define TXQUEUE_BULK_SIZE			160		// holds an ENVELOPE record of 16 channels
+
+/* Bulk bytes allowed ahead in the radio ring. An urgent record waits for at
+ * most this window plus the largest bulk record.
+ */
+#define TXQUEUE_BULK_WINDOW			64
+
+/* Counters of a class */
+typedef struct {
+	unsigned int records;			// records sent
+	unsigned int dropped;			// records that did not fit in the queue
+	unsigned char maxDepth;			// bytes, since the last report
+	unsigned char maxLatency;		// ticks from the enqueue to the radio ring, since the last report
+} TxQueue_Stats;
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Empties the queues and clears the counters */
+void TxQueue_Initialize(void);
+
+/* Counts the time for the latency of the records */
+void TxQueue_Tick(void);
+
+/* Adds a byte to the CRC-8 of a record */
+unsigned char TxQueue_Crc8(unsigned char crc, unsigned char data);
+
+/* Queues a whole record */
+unsigned char TxQueue_Put(unsigned char txClass, unsigned char tag, unsigned char seq,
+						  unsigned char* data, unsigned char length);
+
+/* Selects the next record to send */
+unsigned char TxQueue_Select(unsigned char room, unsigned char bulkRoom, unsigned char* size);
+
+/* Reads the next byte of the record selected */
+unsigned char TxQueue_ReadByte(unsigned char txClass);
+
+/* Gets the bytes waiting in a queue */
+unsigned char TxQueue_GetCount(unsigned char txClass);
+
+/* Gets the size of a queue */
+unsigned char TxQueue_GetSize(unsigned char txClass);
+
+/* Gets the counters of a class and restarts the maxima */
+void TxQueue_GetStats(unsigned char txClass, TxQueue_Stats* stats);
+
+#endif /* _TXQUEUE_H_ */
@@ -3,12 +3,15 @@
 /******************************************************************************/
 
 /* Configuration settings */
-#pragma config WDTEN = OFF
+#pragma config WDTEN = SWON		// watchdog enabled by Supervisor_Run (SWDTEN)
+#pragma config WDTPS = 64		// 64 x 4 ms = 256 ms time-out
 #pragma config FOSC  = INTIO67
 #pragma config XINST = OFF
 
-/* Configure the interrupt settings */
-#pragma interrupt InterruptHigh
+/* Configure the interrupt settings, the ISR calls CC110L_ISR (and the
+ * profiler when enabled) so the temporary data of the compiler has to be
+ * saved */
+#pragma interrupt InterruptHigh save=section(".tmpdata"), PROD
 #pragma code InterruptVectorHigh = 0x08
 
 /******************************************************************************/
@@ -24,6 +27,7 @@
 #include "CC110L.h"
 #include "Implant.h"
 #include "LogicAnalyzer.h"
+#include "Supervisor.h"
 
 /******************************************************************************/
 /* INTERRUPTS																  */
@@ -35,16 +39,20 @@ void InterruptVectorHigh() {
 }
 
 void InterruptHigh() {
-    //CC110L_ISR();
+	LogicAnalyzer_TRACE(TRACE_ISR);
+	PROFILER_START(PROFILER_ISR);
+	CC110L_ISR();
+	PROFILER_STOP(PROFILER_ISR);
+	LogicAnalyzer_TRACE(TRACE_ISR | TRACE_EXIT);
 }
 
 /******************************************************************************/
 /* MAIN FUNCTION															  */
 /******************************************************************************/
 void main() {
-	unsigned char status, i;
+	unsigned char status, restart, i;
     unsigned char dummy[100];
-    unsigned char channels[2] = {0, 0};
+    unsigned char channels[ADS1298_DEVICE_COUNT] = {0, 0};
     
 	/* Set the PIC clock frequency */
 	/* bit 7   (IDLEN):  0   = Device enter Sleep mode on SLEEP instruction
@@ -55,10 +63,29 @@ void main() {
 	 */
     OSCCON = 0b01110110; // set clock to 16 MHz
 	
-    /* Initialize the implant */
+	/* Find out whether the watchdog reset the implant, before touching RCON */
+	restart = Supervisor_Initialize();
+	
+    /* Initialize the implant, defaults are only used without a saved configuration */
 	channels[0] = 0b10000000; // device 1 channels
 	channels[1] = 0b00000000; // device 2 channels
-    Implant_Initialize(channels);
+    status = Implant_Initialize(channels);
+    
+	/* Pick the stream up where the watchdog reset left it, a cold boot only
+	 * streams if the relay left the saved configuration streaming */
+	if (status) {
+		if (restart) {
+			Implant_Resume();
+		} else if (Implant_IsStreamSaved()) {
+			Implant_StartStreaming();
+		}
+		
+		/* The watchdog is only cleared by the scheduler from now on */
+		Supervisor_AddTask(Implant_Task);
+		Supervisor_AddTask(Implant_PumpRadio);
+		Supervisor_AddTask(Implant_ReadCommands);
+		Supervisor_Run();
+	}
     
 	/* Keep reading these registers */
 	if (status) {